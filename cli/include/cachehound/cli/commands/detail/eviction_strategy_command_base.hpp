@@ -23,6 +23,8 @@ private:
 
     static constexpr std::size_t local_pollution_fail_threshold = 5;
     static constexpr std::size_t global_pollution_fail_threshold = 3;
+    // Consecutive targets drawn from eviction sets after which a growable memory grows
+    static constexpr std::size_t stale_targets_before_growth = 1024;
 
     std::size_t is_eviction_set_repetitions_;
 
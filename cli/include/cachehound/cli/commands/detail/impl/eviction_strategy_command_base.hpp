@@ -5,12 +5,15 @@
 
 #include "cachehound/algo/is_eviction_set.hpp"
 #include "cachehound/algo/locate_eviction_set.hpp"
+#include "cachehound/concepts/growable_memory.hpp"
 #include "cachehound/concepts/instrumented_memory.hpp"
+#include "cachehound/concepts/prng_memory.hpp"
 #include "cachehound/util/blacklisted_address_distribution.hpp"
 #include "cachehound/util/uniform_address_distribution.hpp"
 
 #include <cachehound/cachehound.hpp>
 #include <spdlog/spdlog.h>
+#include <array>
 #include <utility>
 
 int cachehound::cli::detail::eviction_strategy_command_base::provide_eviction_set_strategy(instrumented_memory auto& memory, auto&& func) const {
@@ -32,18 +35,26 @@ int cachehound::cli::detail::eviction_strategy_command_base::provide_eviction_se
         std::unordered_set<std::uintptr_t> seen_addresses;
 
         std::size_t switch_channel_counter = 0;
+        std::size_t seen_targets = 0;
 
         std::size_t sets = (1 << memory.index_bits(0))
                 , ways = memory.ways(0);
 
+        if constexpr(channel_placement_memory<decltype(memory)>) {
+            // Same hypothesis as the ordering of the eviction sets below
+            memory.set_channel_placement({modular_placement_policy{memory.offset_bits(), sets}});
+        }
+
         while(evsets.size() < sets) {
-            if(++switch_channel_counter == 10) {
-                if constexpr(switch_channel_memory<decltype(memory)>) {
-                    spdlog::debug("Switching channel");
-                    memory.switch_channel();
-                    spdlog::info("Switched channels");
+            if constexpr(!channel_placement_memory<decltype(memory)>) {
+                if(++switch_channel_counter == 10) {
+                    if constexpr(switch_channel_memory<decltype(memory)>) {
+                        spdlog::debug("Switching channel");
+                        memory.switch_channel();
+                        spdlog::info("Switched channels");
+                    }
+                    switch_channel_counter = 0;
                 }
-                switch_channel_counter = 0;
             }
 
             std::uintptr_t target;
@@ -53,8 +64,23 @@ int cachehound::cli::detail::eviction_strategy_command_base::provide_eviction_se
 
             if(seen_addresses.contains(target)) {
                 spdlog::trace("target already seen");
+                if constexpr(growable_memory<std::remove_cvref_t<decltype(memory)>>) {
+                    // Most lines of the memory are part of an eviction set already
+                    if(++seen_targets == stale_targets_before_growth) {
+                        auto grown = memory.grow(memory_size(memory));
+                        distribution.update(memory);
+                        spdlog::info("Grew memory by {} bytes to {} bytes", grown, memory_size(memory));
+                        seen_targets = 0;
+                    }
+                }
                 continue;
             }
+            seen_targets = 0;
+
+            if constexpr(channel_placement_memory<decltype(memory)>) {
+                // The agent must not evict the target through its own channel
+                memory.avoid_channel_conflicts(std::array{target});
+            }
 
             auto it = locate_eviction_set(
                 std::forward<decltype(is_eviction_set)>(is_eviction_set),
@@ -122,6 +148,10 @@ int cachehound::cli::detail::eviction_strategy_command_base::provide_is_eviction
         std::unordered_set<std::uintptr_t> blacklist(addresses.begin(), addresses.end());
         blacklist.emplace(target);
 
+        if constexpr(prng_memory<decltype(memory)>) {
+            memory.random_access_blacklist(std::vector<std::uintptr_t>(blacklist.begin(), blacklist.end()));
+        }
+
         std::optional<bool> result;
         std::size_t local_pollution_fail_counter = 0;
         do {
@@ -132,17 +162,22 @@ int cachehound::cli::detail::eviction_strategy_command_base::provide_is_eviction
             }
 
             // Cache pollution
-            for(std::size_t i = 0; i < is_eviction_set_pollution_;) {
-                auto address = dist(urbg);
-                if(blacklist.contains(address)) continue;
-                memory.access(address);
-                i++;
+            if constexpr(prng_memory<decltype(memory)>) {
+                memory.seed(urbg());
+                memory.random_accesses(is_eviction_set_pollution_);
+            } else {
+                for(std::size_t i = 0; i < is_eviction_set_pollution_;) {
+                    auto address = dist(urbg);
+                    if(blacklist.contains(address)) continue;
+                    memory.access(address);
+                    i++;
+                }
             }
 
             result = safe_is_eviction_set(memory, target, addresses);
             if(!result.has_value()) {
                 local_pollution_fail_counter++;
-                spdlog::trace("Repeating is_eviction_set due to insufficient cache pollution ({} attempts thus far)", local_pollution_fail_counter);
+                spdlog::trace("Repeating is_eviction_set due to insufficient cache pollution or interrupts ({} attempts thus far)", local_pollution_fail_counter);
 
                 if(local_pollution_fail_counter == local_pollution_fail_threshold) {
                     global_pollution_fail_counter++;
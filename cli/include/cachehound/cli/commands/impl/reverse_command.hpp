@@ -3,14 +3,30 @@
 
 #include "../reverse_command.hpp"
 
+#include "cachehound/algo/calibrate_latency.hpp"
+#include "cachehound/algo/calibrate_serialization.hpp"
+#include "cachehound/algo/measure_eviction_noise.hpp"
 #include "cachehound/adapters/armv8_bypass_adapter.hpp"
+#include "cachehound/adapters/latency_adapter.hpp"
 #include "cachehound/adapters/physical_adapter.hpp"
 #include "cachehound/backends/kernel_memory.hpp"
+#include "cachehound/backends/userspace_agent_memory.hpp"
 #include "cachehound/concepts/instrumented_memory.hpp"
 #include "cachehound/concepts/physically_indexable_memory.hpp"
+#include "cachehound/concepts/serialization_memory.hpp"
 #include "cachehound/policies/placement/modular_placement_policy.hpp"
+#include "cachehound/profiles/pmu_profiles.hpp"
 
 #include <argparse/argparse.hpp>
+#include <sys/mman.h>
+#include <linux/mman.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <random>
 #include <cachehound/cachehound.hpp>
 #include <cachehound/sim/sim.hpp>
 #include <stdexcept>
@@ -65,13 +81,157 @@ int cachehound::cli::reverse_command::provide_memory(auto&& func, unsigned level
                 };
                 return std::forward<decltype(func)>(func)(memory);
             } else {
-                kernel_memory memory{memory_size_, cpu_, pmu_events_, pmu_handler_, isolation_};
-                return std::forward<decltype(func)>(func)(memory);
+                // The profile's type decodes the results of the memory
+                auto start_agent = [&](static_pmu_profile auto profile) -> int {
+                    if(userspace_) {
+                        userspace_agent_memory memory{memory_size_, cpu_, profile, agent_wait_, wait_, hugetlb_page_size_};
+                        if(physical_ && !memory.physical_addresses_available()) {
+                            spdlog::error("Physical addresses are unavailable, reading them from /proc/self/pagemap requires CAP_SYS_ADMIN and locking the memory within RLIMIT_MEMLOCK");
+                            return 1;
+                        }
+                        memory.set_pmu_profile(decltype(profile)::profile());
+                        setup_serialization(memory);
+                        memory.set_interrupt_gap(interrupt_gap_);
+                        if(!memory.counters_available() && !latency_) {
+                            spdlog::warn("Performance counters unavailable, all accesses are reported as misses (consider --latency)");
+                        }
+                        return classify_by_latency(memory, std::forward<decltype(func)>(func));
+                    } else {
+                        std::size_t hugetlb_size = (memory_size_ + hugetlb_page_size_ - 1) / std::max<std::size_t>(hugetlb_page_size_, 1) * hugetlb_page_size_;
+                        auto unmap = [hugetlb_size](std::byte* buffer) { munmap(buffer, hugetlb_size); };
+                        std::unique_ptr<std::byte, decltype(unmap)> hugetlb_buffer{nullptr, unmap};
+                        if(hugetlb_page_size_) {
+                            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (hugetlb_page_size_ == (std::size_t{1} << 30) ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+                            void* buffer = mmap(nullptr, hugetlb_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+                            if(buffer == MAP_FAILED) {
+                                throw std::runtime_error(std::string("Failed to map huge pages (are enough of them reserved?): ") + strerror(errno));
+                            }
+                            hugetlb_buffer.reset(static_cast<std::byte*>(buffer));
+                            spdlog::info("Pinning {} bytes of huge pages", hugetlb_size);
+                        }
+                        kernel_memory memory = hugetlb_buffer
+                            ? kernel_memory{std::span{hugetlb_buffer.get(), hugetlb_size}, cpu_, profile, isolation_, agent_wait_, wait_}
+                            : kernel_memory{memory_size_, cpu_, profile, isolation_, agent_wait_, wait_};
+                        // The kernel keeps the pages pinned
+                        hugetlb_buffer.reset();
+                        std::size_t remote_size = 0;
+                        for(auto& region : memory.regions()) {
+                            if(region.node() != memory.node()) remote_size += region.size();
+                        }
+                        if(remote_size) {
+                            spdlog::warn("{} bytes reside on other NUMA nodes than node {} of CPU {}", remote_size, memory.node(), cpu_);
+                        }
+                        memory.set_pmu_profile(decltype(profile)::profile());
+                        setup_serialization(memory);
+                        memory.set_interrupt_gap(interrupt_gap_);
+                        setup_quiescing(memory);
+                        return classify_by_latency(memory, std::forward<decltype(func)>(func));
+                    }
+                };
+                int result = 1;
+                for_each_pmu_profile([&]<static_pmu_profile P>() {
+                    if(P::name == pmu_) {
+                        result = start_agent(P{});
+                    }
+                });
+                return result;
             }
         }
     }
 }
 
+void cachehound::cli::reverse_command::setup_serialization(serialization_memory auto& memory) const {
+    using enum kernel_memory::serialization_profile;
+    auto profile_name = [](kernel_memory::serialization_profile profile) {
+        switch(profile) {
+            case fence:      return "fence";
+            case load_fence: return "load-fence";
+            case dependency: return "dependency";
+            default:         return "strict";
+        }
+    };
+
+    if(serialization_) {
+        memory.set_serialization(*serialization_);
+        return;
+    }
+
+    spdlog::info("Calibrating serialization");
+    std::random_device rnd;
+    std::mt19937 mtwister{rnd()};
+    auto calibrations = calibrate_serialization(memory, std::array{strict, fence, load_fence, dependency}, mtwister);
+    for(auto& calibration : calibrations) {
+        spdlog::info("Serialization {:<10} {:>10} ns, stability {:.3f}",
+            profile_name(calibration.profile), calibration.duration.count(), calibration.stability);
+    }
+
+    auto profile = select_serialization(calibrations);
+    memory.set_serialization(profile);
+    spdlog::info("Selected serialization {}", profile_name(profile));
+}
+
+void cachehound::cli::reverse_command::setup_quiescing(kernel_agent& memory) const {
+    if(!quiesce_siblings_) {
+        return;
+    }
+
+    // Noise is measured at the level under test, with sets as large as it has ways
+    std::random_device rnd;
+    std::mt19937 mtwister{rnd()};
+    auto ways = memory.ways(level_);
+
+    spdlog::info("Measuring eviction noise with SMT siblings running");
+    auto running = measure_eviction_noise(memory, mtwister, ways);
+    auto parked = memory.quiesce_siblings(true);
+    if(!parked) {
+        spdlog::warn("No SMT sibling of CPU {} to park", cpu_);
+        return;
+    }
+    spdlog::info("Parked {} SMT siblings of CPU {}, measuring eviction noise again", parked, cpu_);
+    auto quiet = measure_eviction_noise(memory, mtwister, ways);
+
+    auto report = [](const char* label, const eviction_noise& noise) {
+        spdlog::info("Unsafe is_eviction_set results {:<8} {:.2f}% ({} discarded, {} inconsistent of {})",
+            label, 100 * noise.unsafe_rate(), noise.discarded, noise.inconsistent, noise.probes);
+    };
+    report("running", running);
+    report("parked", quiet);
+    if(running.unsafe_rate() > 0) {
+        spdlog::info("Parking reduced unsafe results by {:.1f}%", 100 * (1 - quiet.unsafe_rate() / running.unsafe_rate()));
+    }
+}
+
+int cachehound::cli::reverse_command::classify_by_latency(auto& memory, auto&& func) const {
+    if(!latency_) {
+        return std::forward<decltype(func)>(func)(memory);
+    }
+
+    if(memory_size(memory) < latency_calibration_size(memory)) {
+        spdlog::warn("The memory is smaller than the {} bytes needed to evict lines from all levels, latencies of deeper levels will be mixed up",
+            latency_calibration_size(memory));
+    }
+
+    spdlog::info("Calibrating latency thresholds");
+    std::random_device rnd;
+    std::mt19937 mtwister{rnd()};
+    latency_adapter adapter{memory, latency_classifier{calibrate_latency(memory, mtwister)}};
+    auto report = [&]() {
+        auto& classifier = adapter.classifier();
+        for(unsigned level = 0; level < classifier.levels(); level++) {
+            spdlog::info("L{} latency {:>8.1f} cycles, threshold {}", level + 1, classifier.modes()[level], classifier.thresholds()[level]);
+        }
+        spdlog::info("Memory latency {:>8.1f} cycles", classifier.modes().back());
+    };
+    report();
+
+    auto result = std::forward<decltype(func)>(func)(adapter);
+    if(auto recalibrations = adapter.classifier().recalibrations()) {
+        spdlog::info("Latency thresholds drifted and were recalibrated {} times, final thresholds:", recalibrations);
+        report();
+    }
+    return result;
+}
+
 int cachehound::cli::reverse_command::adapt_indexing(memory auto& memory, auto&& func) const {
     if constexpr(physically_indexable_memory<decltype(memory)>) {
         if(physical_) {
@@ -100,28 +260,57 @@ void cachehound::cli::reverse_command::reverse_command::setup_arguments(argparse
         .default_value(false)
         .implicit_value(true);
     args.add_argument("--memory-size", "-m")
-        .help("Specify the memory size")
+        .help("Specify the initial memory size, kernel and user space memory grow once it runs short of lines")
         .default_value(std::size_t{1} << 20)
         .scan<'d', std::size_t>();
+    args.add_argument("--hugetlb")
+        .help("Back the memory with huge pages of the given size, pinned by the kernel module or mapped by the user space agent")
+        .choices("2M", "1G");
     auto& backend = args.add_mutually_exclusive_group();
     args.add_argument("--kernel")
         .help("Allocate memory in kernel space (default)")
         .flag();
     args.add_argument("--kernel-cpu")
-        .help("Specify the operating CPU when allocating memory in the kernel (using the --kernel flag)")
+        .help("Specify the operating CPU of the agent (using the --kernel or --userspace flag)")
         .scan<'d', unsigned>();
     args.add_argument("--kernel-isolation")
         .help("Specify the isolation level when allocating memory in the kernel (using the --kernel flag)")
         .default_value("no-preempt")
         .choices("off", "no-preempt", "disable-irq");
+    args.add_argument("--agent-wait")
+        .help("Specify how the agent waits for submitted accesses (sleep requires --kernel-isolation off)")
+        .default_value("spin")
+        .choices("spin", "monitor", "sleep");
+    args.add_argument("--serialization")
+        .help("Specify how the agent serializes accesses, calibrate picks the cheapest profile that keeps measurements stable")
+        .default_value("strict")
+        .choices("strict", "fence", "load-fence", "dependency", "calibrate");
+    args.add_argument("--interrupt-gap")
+        .help("Specify the cycles after which an instrumented access counts as interrupted, its measurement is repeated (0 disables)")
+        .default_value(std::size_t{0})
+        .scan<'d', std::size_t>();
+    args.add_argument("--quiesce-siblings")
+        .help("Park the SMT siblings of the kernel CPU while measuring and report the reduction of unsafe is_eviction_set results")
+        .flag();
+    args.add_argument("--latency")
+        .help("Classify accesses by their latency instead of the PMU, with thresholds calibrated at start and tracked during the run")
+        .flag();
+    args.add_argument("--wait")
+        .help("Specify how the process waits for the agent to complete accesses")
+        .default_value("sleep")
+        .choices("spin", "monitor", "sleep");
     backend.add_argument("--simulate")
         .help("Simulate a cache hierarchy (useful for testing purposes)")
         .flag();
+    backend.add_argument("--userspace")
+        .help("Execute accesses by a pinned user space thread instead of the kernel module (no root required)")
+        .flag();
 
-    // TODO: Generalize this
-    args.add_argument("--pmu")
-        .help("Specify the method of utilizing the PMU in the kernel memory")
-        .choices("intel", "amd-zen2", "rpi5", "a64fx");
+    auto& pmu = args.add_argument("--pmu")
+        .help("Specify the method of utilizing the PMU in the kernel or user space memory");
+    for(auto& name : get_pmu_profiles()) {
+        pmu.choices(name);
+    }
 }
 
 void cachehound::cli::reverse_command::parse_arguments(argparse::ArgumentParser& args) {
@@ -137,8 +326,13 @@ void cachehound::cli::reverse_command::parse_arguments(argparse::ArgumentParser&
         physical_ = args.get<bool>("--physical");
 
         memory_size_ = args.get<std::size_t>("--memory-size");
+        hugetlb_page_size_ = 0;
+        if(auto hugetlb = args.present<std::string>("--hugetlb")) {
+            hugetlb_page_size_ = *hugetlb == "1G" ? std::size_t{1} << 30 : std::size_t{1} << 21;
+        }
 
         simulate_ = args.get<bool>("--simulate");
+        userspace_ = args.get<bool>("--userspace");
 
         if(!simulate_) {
             // Read kernel CPU core
@@ -150,142 +344,37 @@ void cachehound::cli::reverse_command::parse_arguments(argparse::ArgumentParser&
             else if(isolation_str == "no-preempt") isolation_ = kernel_memory::isolation_level::no_preempt;
             else isolation_ = kernel_memory::isolation_level::disable_irq;
 
-            // PMU
-
-            auto add_x86_pmu_event = [this](
-                unsigned char event_select,
-                unsigned char unit_mask,
-                unsigned char counter_mask,
-                bool edge_detect
-            ){
-                unsigned long val = 0;
-
-                val |= (unsigned long)(event_select);
-                val |= (((unsigned long)unit_mask) << 8);
-                // user mode = 1
-                val |= (1UL << 16);
-                // os mode = 1
-                val |= (1UL << 17);
-                val |= (((unsigned long)edge_detect) << 18);
-                // enable = 1
-                val |= (1UL << 22);
-                val |= (((unsigned long)counter_mask) << 24);
-
-                pmu_events_.push_back(val);
+            // Read wait policies
+            auto parse_wait_policy = [](const std::string& policy_str) {
+                if(policy_str == "spin") return kernel_memory::wait_policy::spin;
+                if(policy_str == "monitor") return kernel_memory::wait_policy::monitor;
+                return kernel_memory::wait_policy::sleep;
             };
+            agent_wait_ = parse_wait_policy(args.get<std::string>("--agent-wait"));
+            wait_ = parse_wait_policy(args.get<std::string>("--wait"));
 
-            auto pmu_str = args.get<std::string>("--pmu");
-            if (pmu_str == "intel") {
-                add_x86_pmu_event(0xD1, 0x01, 0x00, true);
-                add_x86_pmu_event(0xD1, 0x02, 0x00, true);
-                add_x86_pmu_event(0xD1, 0x04, 0x00, true);
-
-                pmu_handler_ = [](
-                    std::uint64_t l1_hits_before, std::uint64_t l2_hits_before, std::uint64_t l3_hits_before,
-                    std::uint64_t l1_hits_after, std::uint64_t l2_hits_after, std::uint64_t l3_hits_after
-                ) {
-                    auto l1_hits = l1_hits_after - l1_hits_before;
-                    auto l2_hits = l2_hits_after - l2_hits_before;
-                    auto l3_hits = l3_hits_after - l3_hits_before;
-
-                    // Note: Any inconsistencies in hit counters can probably be explained by interrupts during execution.
-                    // Thus, try setting a higher isolation level.
-                    // if(l1_hits > 1)
-                    //     throw std::runtime_error(std::string{"Too many L1 hits per access: " + std::to_string(l1_hits)});
-                    // if(l2_hits > 1)
-                    //     throw std::runtime_error(std::string{"Too many L2 hits per access: " + std::to_string(l2_hits)});
-                    // if(l3_hits > 1)
-                    //     throw std::runtime_error(std::string{"Too many L3 hits per access: " + std::to_string(l3_hits)});
-
-                    // if(l1_hits + l2_hits + l3_hits > 1)
-                    //     throw std::runtime_error(std::string{"Sum of hit counters >1: L1=" + std::to_string(l1_hits) + ", L2=" + std::to_string(l2_hits) + ", L3=" + std::to_string(l3_hits)});
-
-                    if(l1_hits) return 0;
-                    if(l2_hits) return 1;
-                    if(l3_hits) return 2;
-                    return 3; // memory response
-                };
-            } else if(pmu_str == "amd-zen2") {
-                add_x86_pmu_event(0x60, 0xC8, 0x00, false); // l2_cache_accesses_from_dc_misses -> L1D Misses
-                add_x86_pmu_event(0x64, 0x40, 0x00, false); // l2_cache_req_stat.ls_rd_blk_l_hit_x -> L2 Hit
-
-                pmu_handler_ = [](
-                    std::uint64_t l1_misses_before, std::uint64_t l2_hits_before, std::uint64_t,
-                    std::uint64_t l1_misses_after, std::uint64_t l2_hits_after, std::uint64_t
-                ) {
-                    auto l1_misses = l1_misses_after - l1_misses_before;
-                    auto l2_hits = l2_hits_after - l2_hits_before;
-
-                    if(l1_misses == 0) return 0;
-                    if(l2_hits) return 1;
-                    return 2; // memory response
-                };
-            } else if(pmu_str == "rpi5") {
-                // arm64 architectural standard events
-                pmu_events_.push_back(0x42); // L1D_CACHE_REFILL_RD
-                pmu_events_.push_back(0x52); // L2D_CACHE_REFILL_RD
-                pmu_events_.push_back(0x2A); // L3D_CACHE_REFILL
-                // pmu_events_.push_back(0xA2); // L3D_CACHE_REFILL_RD (only on DynamIQ Shared Unit)
-                // pmu_events_.push_back(0x37); // LL_CACHE_MISS_RD
-
-                pmu_handler_ = [](
-                    std::uint64_t l1_misses_before, std::uint64_t l2_misses_before, std::uint64_t l3_misses_before,
-                    std::uint64_t l1_misses_after, std::uint64_t l2_misses_after, std::uint64_t l3_misses_after
-                ) {
-                    auto l1_misses = l1_misses_after - l1_misses_before;
-                    auto l2_misses = l2_misses_after - l2_misses_before;
-                    auto l3_misses = l3_misses_after - l3_misses_before;
-
-                    // spdlog::info("{} {} {}", l1_misses, l2_misses, l3_misses);
-
-                    if (l3_misses)
-                        return 3;
-                    if (l2_misses)
-                        return 2;
-                    if (l1_misses)
-                        return 1;
-                    return 0;
-                };
-            } else {
-                assert(pmu_str == "a64fx");
-
-                pmu_events_.push_back(0x0003); // L1D_CACHE_REFILL
-                pmu_events_.push_back(0x0017); // L2D_CACHE_REFILL (or L2_MISS_COUNT 0x0309 ??)
-
-                // NOTE: A64FX PMU Events Errata
-                // 0x0017, L2D_CACHE_REFILL
-                // 0x0059, L2D_CACHE_REFILL_PRF
-                // 0x0300, L2D_CACHE_REFILL_DM
-                // 0x0309, L2_MISS_COUNT
-                // These events count more than they occur actually when the time distance between the demand request and the prefetch request is close.
-                //
-                // They can be corrected as follows:
-                // L2D_CACHE_REFILL := L2D_CACHE_REFILL – L2D_SWAP_DM – L2D_CACHE_MIBMCH_PRF
-                // L2D_CACHE_REFILL_DM := L2D_CACHE_REFILL_DM - L2D_SWAP_DM
-                // L2D_CACHE_REFILL_PRF := L2D_CACHE_REFILL_PRF - L2D_CACHE_MIBMCH_PRF 
-                // L2_MISS_COUNT := L2_MISS_COUNT - L2D_CACHE_SWAP_LOCAL - L2_PIPE_COMP_PF_L2MIB_MCH
-
-                pmu_handler_ = [](
-                    std::uint64_t l1_misses_before, std::uint64_t l2_misses_before, std::uint64_t,
-                    std::uint64_t l1_misses_after, std::uint64_t l2_misses_after, std::uint64_t
-                ) {
-                    auto l1_misses = l1_misses_after - l1_misses_before;
-                    auto l2_misses = l2_misses_after - l2_misses_before;
-
-                    if (l2_misses)
-                        return 2;
-                    if (l1_misses)
-                        return 1;
-                    return 0;
-                };
-            }
+            // Read serialization profile
+            auto serialization_str = args.get<std::string>("--serialization");
+            if(serialization_str == "strict") serialization_ = kernel_memory::serialization_profile::strict;
+            else if(serialization_str == "fence") serialization_ = kernel_memory::serialization_profile::fence;
+            else if(serialization_str == "load-fence") serialization_ = kernel_memory::serialization_profile::load_fence;
+            else if(serialization_str == "dependency") serialization_ = kernel_memory::serialization_profile::dependency;
+            else serialization_.reset();
+
+            interrupt_gap_ = args.get<std::size_t>("--interrupt-gap");
+            quiesce_siblings_ = args.get<bool>("--quiesce-siblings");
+            latency_ = args.get<bool>("--latency");
+
+            // PMU
+
+            pmu_ = args.get<std::string>("--pmu");
         }
     }
 }
 
 int cachehound::cli::reverse_command::run_subcommand(auto &subcommand) const {
     return provide_memory([&](instrumented_memory auto& memory){
-        return adapt_indexing(memory, [&](instrumented_memory auto& memory) mutable {
+        int res = adapt_indexing(memory, [&](instrumented_memory auto& memory) mutable {
             spdlog::info("Allocated memory of size {}", memory_size(memory));
             size_t region_index = 0;
             for(auto& region : memory.regions()) {
@@ -302,10 +391,51 @@ int cachehound::cli::reverse_command::run_subcommand(auto &subcommand) const {
                 spdlog::info("Instrumented accesses: {}", stats.instrumented_accesses);
                 spdlog::info("Flushes:               {}", stats.flushes);
                 spdlog::info("Channel switches:      {}", stats.channel_switches);
+                if constexpr(requires { stats.channel_collisions; }) {
+                    spdlog::info("Channel collisions:    {} ({} unavoidable)", stats.channel_collisions, stats.unavoidable_channel_collisions);
+                    spdlog::info("Skipped slots:         {} ring, {} results", stats.skipped_entries, stats.skipped_results);
+                }
+                if constexpr(requires { stats.waits; stats.agent_waits; }) {
+                    auto average = [](std::size_t sum, std::size_t count) { return count ? sum / count : 0; };
+                    spdlog::info("Waits:                 {} ({} sleeps, wake-up latency avg {} / max {} cycles)",
+                        stats.waits, stats.wait_sleeps,
+                        average(stats.wait_latency_sum, stats.waits), stats.wait_latency_max);
+                    spdlog::info("Agent waits:           {} ({} sleeps, wake-up latency avg {} / max {} cycles)",
+                        stats.agent_waits, stats.agent_wait_sleeps,
+                        average(stats.agent_wait_latency_sum, stats.agent_waits), stats.agent_wait_latency_max);
+                }
+                if constexpr(requires { stats.overlap_cycles; }) {
+                    spdlog::info("Overlap:               {} of {} cycles preparing submissions ({} flushes while the agent was busy)",
+                        stats.overlap_cycles, stats.fill_cycles, stats.overlapped_flushes);
+                }
             }
 
             return res;
         });
+
+        if constexpr(requires { memory.agent_stats(); }) {
+            auto stats = memory.agent_stats();
+            auto average = [](std::uint64_t sum, std::uint64_t count) { return count ? sum / count : 0; };
+            spdlog::info("Agent stats (cycles):");
+            spdlog::info("Idle:                  {}", stats.idle_cycles);
+            spdlog::info("Batches:               {} ({} entries, avg {} cycles)",
+                stats.batches, stats.batch_entries, average(stats.batch_cycles, stats.batches));
+            spdlog::info("Cache maintenance:     {} (avg {} cycles)",
+                stats.maintenance, average(stats.maintenance_cycles, stats.maintenance));
+            spdlog::info("Channel switches:      {} (avg {} cycles)",
+                stats.channel_switches, average(stats.channel_switch_cycles, stats.channel_switches));
+            if(stats.invalid_entries) {
+                spdlog::warn("Invalid entries:       {} (skipped by the agent)", stats.invalid_entries);
+            }
+            for(unsigned bucket = 0; bucket < CH_STATS_BUCKETS; bucket++) {
+                if(stats.batch_sizes[bucket] || stats.round_trip_cycles[bucket]) {
+                    spdlog::info("[2^{:<2}, 2^{:<2}):         {} batches, {} round trips",
+                        bucket, bucket + 1, stats.batch_sizes[bucket], stats.round_trip_cycles[bucket]);
+                }
+            }
+        }
+
+        return res;
     }, level_);
 }
 
@@ -55,6 +55,10 @@ int cachehound::cli::reverse_replacement_command::main(Memory& memory) const {
     auto candidates = get_replacement_policies(ways);
     std::size_t local_pollution_fail_counter = 0;
 
+    if constexpr(prng_memory<Memory>) {
+        memory.random_access_blacklist(addresses);
+    }
+
     while(candidates.size() > 1 || rounds < minimum_rounds_) {
         auto seq = generate_sequence(length_, std::min(2 * ways, addresses.size()), mtwister);
         spdlog::debug("Sequence: {}", fmt::join(seq, ", "));
@@ -68,16 +72,21 @@ int cachehound::cli::reverse_replacement_command::main(Memory& memory) const {
             }
 
             // Cache pollution
-            for(std::size_t i = 0; i < pollution_;) {
-                auto address = uad(rnd);
-                if(blacklist.contains(address)) continue;
-                memory.access(address);
-                i++;
+            if constexpr(prng_memory<Memory>) {
+                memory.seed(mtwister());
+                memory.random_accesses(pollution_);
+            } else {
+                for(std::size_t i = 0; i < pollution_;) {
+                    auto address = uad(rnd);
+                    if(blacklist.contains(address)) continue;
+                    memory.access(address);
+                    i++;
+                }
             }
 
             auto measured_hit_counter = safe_measure_sequence(memory, seq, addresses);
             if(!measured_hit_counter.has_value()) {
-                spdlog::trace("Repeating measure_sequence due to insufficient cache pollution ({} attempts thus far)", local_pollution_fail_counter++);
+                spdlog::trace("Repeating measure_sequence due to insufficient cache pollution or interrupts ({} attempts thus far)", local_pollution_fail_counter++);
                 continue;
             }
             local_pollution_fail_counter = 0;
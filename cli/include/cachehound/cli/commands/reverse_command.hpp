@@ -11,7 +11,11 @@
 #include "./reverse_playground_command.hpp"
 #endif
 
+#include "cachehound/concepts/serialization_memory.hpp"
+
 #include <argparse/argparse.hpp>
+#include <optional>
+#include <string>
 
 namespace cachehound::cli {
 
@@ -30,16 +34,30 @@ public:
 private:
     unsigned level_;
     std::size_t memory_size_;
+    // Page size of the hugetlbfs buffer pinned instead of kernel allocations (0 if none)
+    std::size_t hugetlb_page_size_;
     bool simulate_;
+    bool userspace_;
     unsigned cpu_;
-    std::vector<std::uint64_t> pmu_events_;
-    std::function<kernel_memory::pmu_handler_type> pmu_handler_;
+    // Name of the static PMU profile (see pmu_profiles)
+    std::string pmu_;
     kernel_memory::isolation_level isolation_;
+    kernel_memory::wait_policy agent_wait_;
+    kernel_memory::wait_policy wait_;
+    // Calibrated on the memory if unset
+    std::optional<kernel_memory::serialization_profile> serialization_;
+    std::size_t interrupt_gap_;
+    bool quiesce_siblings_;
+    // Classify accesses by calibrated latency thresholds instead of the PMU
+    bool latency_;
     bool physical_;
 
     template<std::size_t MaxDepth = 4>
     int provide_memory(auto&& func, unsigned levels_remaining) const;
     int adapt_indexing(memory auto&, auto&& func) const;
+    void setup_serialization(serialization_memory auto& memory) const;
+    void setup_quiescing(kernel_agent& memory) const;
+    int classify_by_latency(auto& memory, auto&& func) const;
 
 public:
     void setup_arguments(argparse::ArgumentParser& args);
@@ -23,6 +23,9 @@ public:
         if constexpr(switch_channel_memory<decltype(memory)>) {
             features.emplace_back("switch-channel");
         }
+        if constexpr(channel_placement_memory<decltype(memory)>) {
+            features.emplace_back("channel-placement");
+        }
         if constexpr(x86_memory<decltype(memory)>) {
             features.emplace_back("clflush");
             features.emplace_back("wbinvd");
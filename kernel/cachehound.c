@@ -1,5 +1,7 @@
+#include "ch_agent.h"
 #include "ch_channel.h"
 #include "ch_ioc.h"
+#include "ch_ops.h"
 #include "ch_pmc.h"
 #include "ch_plat.h"
 #include "ch_cache_info.h"
@@ -19,98 +21,287 @@
 #include <linux/slab.h>
 #include <linux/io.h>
 #include <linux/mutex.h>
+#include <linux/log2.h>
+#include <linux/cpumask.h>
+#include <linux/topology.h>
 
 #define CH_AGENT_NAME "kcachehound"
 
-struct ch_state {
-    atomic_t ref_counter;
+#define CH_CHANNEL_COUNT (PAGE_SIZE / sizeof(struct ch_channel))
+#define CH_RING_ENTRIES  ((PAGE_SIZE << CH_RING_ORDER) / sizeof(uint64_t))
+#define CH_RESULT_ENTRIES ((PAGE_SIZE << CH_RESULTS_ORDER) / sizeof(struct ch_result))
+#define CH_PROGRAM_ENTRIES ((PAGE_SIZE << CH_PROGRAM_ORDER) / sizeof(uint64_t))
+#define CH_LEVEL_ENTRIES   (PAGE_SIZE << CH_LEVELS_ORDER)
+
+/* Pauses of a parked sibling between two polls of its agent's state */
+#define CH_QUIESCE_SPINS 4096
+
+/* Largest order the buddy allocator hands out */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+#define CH_MAX_ALLOC_ORDER MAX_PAGE_ORDER
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0)
+#define CH_MAX_ALLOC_ORDER MAX_ORDER
+#else
+#define CH_MAX_ALLOC_ORDER (MAX_ORDER - 1)
+#endif
+
+/*
+ * A published line set together with its ranges. Sets are retired rather
+ * than freed, the agent may use any of them until it adopts the newest.
+ */
+struct ch_line_set_node {
+    struct ch_line_set set;
+    struct ch_line_set_node* previous;
+    struct ch_line_range ranges[];
+};
+
+/*
+ * Resources of one agent, indexed by the agent number handed out by
+ * CH_IOC_START_AGENT. They are freed together with the state.
+ */
+struct ch_agent_state {
+    struct ch_state* state;
+    unsigned index;
+    unsigned cpu;
+    int started;
+    /* Set under state->lock once the agent left its loop, siblings are no longer parked then */
+    int exited;
+    /* Set while the SMT siblings of cpu are parked, cleared once the agent exited */
+    int quiescing;
+    unsigned parked;
+    atomic_t parked_running;
 
     struct page* channels_page;
     struct ch_channel* channels;
     size_t active_channel;
 
-    atomic_t started;
+    struct page* ring_page;
+    uint64_t* ring;
+
+    struct page* results_page;
+    struct ch_result* results;
+
+    struct page* program_page;
+    uint64_t* program;
+
+    struct page* levels_page;
+    uint8_t* levels;
+
+    /* Newest first, the head is published through published_lines */
+    struct ch_line_set_node* line_sets;
+    const struct ch_line_set* published_lines;
+
     unsigned isolation_level;
-    unsigned long long evts[3];
+    unsigned wait_policy;
+    unsigned long long evts[CH_RESULT_COUNTERS];
+    unsigned counters;
 
-    struct ch_memory_region* regions_head;
-    struct ch_memory_region* regions_tail;
+    /* Written by the agent, read by CH_IOC_AGENT_STATS */
+    struct ch_agent_stats stats;
+};
+
+/* Singly linked regions, e.g., those of one request until it succeeded */
+struct ch_region_list {
+    struct ch_memory_region* head;
+    struct ch_memory_region* tail;
+    size_t count;
+};
+
+struct ch_state {
+    atomic_t ref_counter;
+
+    /* Serializes allocations of regions and agents */
+    struct mutex lock;
+    /* Serializes agent starts, which copy to user space without lock held */
+    struct mutex start_lock;
+    struct ch_agent_state* agents[CH_MAX_AGENTS];
+    unsigned agent_count;
+
+    struct ch_region_list regions;
 };
 
 struct ch_memory_region {
     void* base;
     struct page* page;
+    size_t size;
     unsigned order;
+    /* Pages of a user buffer (CH_IOC_PIN_MEMORY) rather than of the allocator */
+    int pinned;
 
     struct ch_memory_region* next;
 };
 
-struct ch_state* alloc_ch_state(void) {
-    struct page* channels_page;
-    struct ch_channel* channels;
-    struct ch_state* state;
+/*
+ * NUMA node of the CPU, NUMA_NO_NODE (i.e., any node) for negative CPUs.
+ */
+static int ch_cpu_node(int cpu) {
+    return cpu < 0 ? NUMA_NO_NODE : cpu_to_node(cpu);
+}
+
+/*
+ * Allocates 2^order zeroed pages on the node (preferably) that are shared
+ * with the user process.
+ */
+static struct page* alloc_shared_pages(int node, unsigned order, void** mapping, const char* name) {
+    struct page* page;
+
+    page = alloc_pages_node(node, GFP_KERNEL, order);
+    if(!page) {
+        pr_alert("Failed to allocate pages for %s\n", name);
+        return NULL;
+    }
 
-    channels_page = alloc_page(GFP_KERNEL);
-    if(!channels_page) {
-        pr_alert("Failed to allocate page for channels\n");
+    *mapping = memremap(page_to_pfn(page) << PAGE_SHIFT, PAGE_SIZE << order, MEMREMAP_WB);
+    if(!*mapping) {
+        __free_pages(page, order);
+        pr_alert("Failed to map %s into kernel address space\n", name);
         return NULL;
     }
+    memset(*mapping, 0, PAGE_SIZE << order);
+
+    return page;
+}
+
+static void free_shared_pages(struct page* page, void* mapping, unsigned order) {
+    memunmap(mapping);
+    __free_pages(page, order);
+}
+
+struct ch_agent_state* alloc_ch_agent_state(struct ch_state* state, unsigned index, int node) {
+    struct ch_agent_state* agent_state;
 
-    channels = memremap(page_to_pfn(channels_page) << PAGE_SHIFT, PAGE_SIZE, MEMREMAP_WB);
-    if(!channels) {
-        __free_page(channels_page);
-        pr_alert("Failed to map channels page into kernel address space\n");
+    agent_state = kzalloc(sizeof(struct ch_agent_state), GFP_KERNEL);
+    if(!agent_state) {
+        pr_alert("Failed to kmalloc agent state\n");
         return NULL;
     }
-    memset(channels, 0, PAGE_SIZE);
 
-    state = kmalloc(sizeof(struct ch_state), GFP_KERNEL);
+    agent_state->channels_page = alloc_shared_pages(node, 0, (void**)&agent_state->channels, "channels");
+    if(!agent_state->channels_page) {
+        goto free_agent_state;
+    }
+
+    agent_state->ring_page = alloc_shared_pages(node, CH_RING_ORDER, (void**)&agent_state->ring, "submission ring");
+    if(!agent_state->ring_page) {
+        goto free_channels;
+    }
+
+    agent_state->results_page = alloc_shared_pages(node, CH_RESULTS_ORDER, (void**)&agent_state->results, "results");
+    if(!agent_state->results_page) {
+        goto free_ring;
+    }
+
+    agent_state->program_page = alloc_shared_pages(node, CH_PROGRAM_ORDER, (void**)&agent_state->program, "program area");
+    if(!agent_state->program_page) {
+        goto free_results;
+    }
+
+    agent_state->levels_page = alloc_shared_pages(node, CH_LEVELS_ORDER, (void**)&agent_state->levels, "levels area");
+    if(!agent_state->levels_page) {
+        goto free_program;
+    }
+
+    agent_state->state = state;
+    agent_state->index = index;
+    agent_state->isolation_level = CH_ISOLATION_OFF;
+    agent_state->wait_policy = CH_WAIT_SPIN;
+    atomic_set(&agent_state->parked_running, 0);
+
+    return agent_state;
+
+free_program:
+    free_shared_pages(agent_state->program_page, agent_state->program, CH_PROGRAM_ORDER);
+free_results:
+    free_shared_pages(agent_state->results_page, agent_state->results, CH_RESULTS_ORDER);
+free_ring:
+    free_shared_pages(agent_state->ring_page, agent_state->ring, CH_RING_ORDER);
+free_channels:
+    free_shared_pages(agent_state->channels_page, agent_state->channels, 0);
+free_agent_state:
+    kfree(agent_state);
+    return NULL;
+}
+
+void ch_agent_state_free(struct ch_agent_state* agent_state) {
+    struct ch_line_set_node* line_set;
+
+    while((line_set = agent_state->line_sets)) {
+        agent_state->line_sets = line_set->previous;
+        kvfree(line_set);
+    }
+    free_shared_pages(agent_state->levels_page, agent_state->levels, CH_LEVELS_ORDER);
+    free_shared_pages(agent_state->program_page, agent_state->program, CH_PROGRAM_ORDER);
+    free_shared_pages(agent_state->results_page, agent_state->results, CH_RESULTS_ORDER);
+    free_shared_pages(agent_state->ring_page, agent_state->ring, CH_RING_ORDER);
+    free_shared_pages(agent_state->channels_page, agent_state->channels, 0);
+    kfree(agent_state);
+}
+
+struct ch_state* alloc_ch_state(void) {
+    struct ch_state* state;
+
+    state = kzalloc(sizeof(struct ch_state), GFP_KERNEL);
     if(!state) {
-        memunmap(channels);
-        __free_page(channels_page);
         pr_alert("Failed to kmalloc cachehound state\n");
         return NULL;
     }
 
     atomic_set(&state->ref_counter, 1);
-    state->channels_page = channels_page;
-    state->channels = channels;
-    state->active_channel = 0;
-    atomic_set(&state->started, 0);
-    state->isolation_level = CH_ISOLATION_OFF;
-    state->regions_head = NULL;
-    state->regions_tail = NULL;
+    mutex_init(&state->lock);
+    mutex_init(&state->start_lock);
+    state->agent_count = 0;
+    state->regions.head = NULL;
+    state->regions.tail = NULL;
+    state->regions.count = 0;
 
     pr_info("Cachehound state allocated\n");
     return state;
 }
 
-void ch_state_free(struct ch_state* state) {
-    /* state->ref_count is 0 */
-    void* region_base;
-    struct page* region_page;
-    unsigned region_order;
-    struct page* channels_page = state->channels_page;
-    struct ch_channel* channels = state->channels;
-    struct ch_memory_region *region_it = state->regions_head, *prev_region;
+/*
+ * Releases the pages of a region, which is unlinked already.
+ */
+static void ch_memory_region_free(struct ch_memory_region* region) {
+    unsigned long pfn = page_to_pfn(region->page), i;
 
-    while(region_it) {
-        region_base = region_it->base;
-        region_page = region_it->page;
-        region_order = region_it->order;
+    memunmap(region->base);
+    if(region->pinned) {
+        for(i = 0; i < region->size >> PAGE_SHIFT; i++) {
+            unpin_user_page(pfn_to_page(pfn + i));
+        }
+    } else {
+        __free_pages(region->page, region->order);
+    }
+    kfree(region);
+}
+
+/*
+ * Releases all regions of the list, e.g., those of a failed request.
+ */
+static void ch_region_list_free(struct ch_region_list* list) {
+    struct ch_memory_region *region_it = list->head, *prev_region;
 
+    while(region_it) {
         prev_region = region_it;
         region_it = region_it->next;
-        kfree(prev_region);
+        ch_memory_region_free(prev_region);
+    }
+    list->head = list->tail = NULL;
+    list->count = 0;
+}
 
-        memunmap(region_base);
-        __free_pages(region_page, region_order);
+void ch_state_free(struct ch_state* state) {
+    /* state->ref_count is 0 */
+    unsigned i;
+
+    for(i = 0; i < state->agent_count; i++) {
+        ch_agent_state_free(state->agents[i]);
     }
+
+    ch_region_list_free(&state->regions);
     pr_info("All cachehound kernel memory regions freed");
 
     kfree(state);
-    memunmap(channels);
-    __free_page(channels_page);
 
     pr_info("Cachehound state freed");
 }
@@ -137,70 +328,391 @@ void ch_state_put(struct ch_state* state) {
     }
 }
 
-int ch_state_try_start(struct ch_state* state) {
-    return atomic_cmpxchg_acquire(&state->started, 0, 1) == 0;
+/*
+ * Publishes the lines of all regions allocated thus far for random accesses
+ * and chains. A running agent adopts them upon CH_COMMAND_RELOAD_LINES.
+ * Must be called with state->lock held.
+ */
+static void ch_agent_state_publish_lines(struct ch_agent_state* agent_state, unsigned offset_bits) {
+    struct ch_state* state = agent_state->state;
+    struct ch_memory_region* region_it;
+    struct ch_line_set_node* line_set;
+    size_t i = 0;
+
+    if(!state->regions.count) {
+        return;
+    }
+
+    line_set = kvmalloc(struct_size(line_set, ranges, state->regions.count), GFP_KERNEL);
+    if(!line_set) {
+        pr_alert("Failed to allocate line ranges, agent %u keeps its previous ones\n", agent_state->index);
+        return;
+    }
+
+    line_set->set.lines = 0;
+    for(region_it = state->regions.head; region_it; region_it = region_it->next) {
+        line_set->ranges[i].base = (uintptr_t)region_it->base;
+        line_set->ranges[i].first_line = line_set->set.lines;
+        line_set->set.lines += region_it->size >> offset_bits;
+        i++;
+    }
+    line_set->set.ranges = line_set->ranges;
+    line_set->set.range_count = i;
+
+    line_set->previous = agent_state->line_sets;
+    agent_state->line_sets = line_set;
+    smp_store_release(&agent_state->published_lines, &line_set->set);
 }
 
-void ch_state_stop(struct ch_state* state) {
-    atomic_set_release(&state->started, 0);
+/*
+ * Publishes the lines of all regions to the agents started thus far, e.g.,
+ * after regions were added. Must be called with state->lock held.
+ */
+static void ch_state_publish_lines(struct ch_state* state) {
+    unsigned i;
+
+    for(i = 0; i < state->agent_count; i++) {
+        ch_agent_state_publish_lines(state->agents[i], ch_cache_offset_bits());
+    }
 }
 
-int ch_state_alloc_memory(struct ch_state* state, unsigned order) {
-    struct page* page;
+/*
+ * Maps size bytes of physically contiguous pages starting at page into the
+ * kernel and appends them as a region to the list. Neither frees nor unpins
+ * the pages on failure.
+ */
+static int ch_region_list_add(struct ch_region_list* list, struct page* page, size_t size, unsigned order, int pinned) {
     void* base;
     struct ch_memory_region* region;
 
-    page = alloc_pages(GFP_KERNEL, order);
-    if(!page) {
-        pr_info("Allocation of kernel page of order %u failed\n", order);
-        return -ENOMEM;
-    }
-
-    base = memremap(page_to_pfn(page) << PAGE_SHIFT, PAGE_SIZE, MEMREMAP_WB);
+    base = memremap(page_to_pfn(page) << PAGE_SHIFT, size, MEMREMAP_WB);
     if(!base) {
-        __free_pages(page, order);
-        pr_alert("Failed to map kernel hugepage into kernel address space\n");
+        pr_alert("Failed to map kernel memory region into kernel address space\n");
         return -EIO;
     }
 
     region = kmalloc(sizeof(struct ch_memory_region), GFP_KERNEL);
     if(!region) {
         memunmap(base);
-        __free_pages(page, order);
         pr_alert("Failed to kmalloc cachehound memory region\n");
         return -ENOMEM;
     }
 
     region->page = page;
     region->base = base;
+    region->size = size;
     region->order = order;
+    region->pinned = pinned;
     region->next = NULL;
 
-    if(!state->regions_head) {
-        state->regions_head = state->regions_tail = region;
+    if(!list->head) {
+        list->head = list->tail = region;
+    } else {
+        list->tail->next = region;
+        list->tail = region;
+    }
+    list->count++;
+
+    return 0;
+}
+
+/*
+ * Moves the regions of a successful request from the list to the state and
+ * publishes their lines to the agents. Must be called with state->lock held.
+ */
+static void ch_state_append_regions(struct ch_state* state, struct ch_region_list* list) {
+    if(!list->head) {
+        return;
+    }
+
+    if(!state->regions.head) {
+        state->regions.head = list->head;
     } else {
-        state->regions_tail->next = region;
-        state->regions_tail = region;
+        state->regions.tail->next = list->head;
+    }
+    state->regions.tail = list->tail;
+    state->regions.count += list->count;
+    list->head = list->tail = NULL;
+    list->count = 0;
+
+    ch_state_publish_lines(state);
+}
+
+/*
+ * Allocates a region of 2^order pages, preferably on the node, and appends
+ * it to the list.
+ */
+int ch_region_list_alloc(struct ch_region_list* list, unsigned order, gfp_t gfp, int node) {
+    struct page* page;
+    int err;
+
+    /* Zeroed so that chases end at lines that were never linked */
+    page = alloc_pages_node(node, gfp | __GFP_ZERO, order);
+    if(!page) {
+        return -ENOMEM;
+    }
+
+    err = ch_region_list_add(list, page, PAGE_SIZE << order, order, 0);
+    if(err < 0) {
+        __free_pages(page, order);
+    }
+    return err;
+}
+
+/*
+ * End (exclusive) of the run of physically contiguous pages on one NUMA node
+ * that starts at pages[first].
+ */
+static unsigned long ch_pinned_run_end(struct page** pages, unsigned long first, unsigned long count) {
+    unsigned long pfn = page_to_pfn(pages[first]), i = first + 1;
+    int node = page_to_nid(pages[first]);
+
+    while(i < count && page_to_pfn(pages[i]) == pfn + (i - first) && page_to_nid(pages[i]) == node) {
+        i++;
+    }
+    return i;
+}
+
+/*
+ * Pins the user buffer described by config (long-term, so that neither
+ * migration nor compaction moves it) and appends one region per physically
+ * contiguous run of it. A 1 GiB hugetlbfs page thereby becomes one region.
+ * Nothing is pinned if config->max_regions does not suffice, region_count
+ * then reports the number of regions required. No region is kept if the
+ * call fails otherwise. The process keeps its own writable mapping of the
+ * runs, so the agent must not trust anything stored in them
+ * (ch_agent_chase() checks every pointer it follows).
+ */
+static int ch_state_pin_memory(struct ch_state* state, struct ch_ioc_pin_config* config, struct ch_ioc_pin_config __user* user_config) {
+    struct ch_ioc_region region, __user *regions = (struct ch_ioc_region __user*)config->regions;
+    struct ch_region_list list = {0};
+    struct page** pages;
+    unsigned long page_count, pinned = 0, i = 0, end;
+    long ret;
+    int err = 0;
+
+    if(!config->size || !PAGE_ALIGNED(config->user_base) || !PAGE_ALIGNED(config->size)) {
+        pr_alert("User buffer to pin is empty or not page aligned\n");
+        return -EINVAL;
+    }
+
+    page_count = config->size >> PAGE_SHIFT;
+    pages = kvmalloc_array(page_count, sizeof(struct page*), GFP_KERNEL);
+    if(!pages) {
+        return -ENOMEM;
+    }
+
+    while(pinned < page_count) {
+        ret = pin_user_pages_fast(config->user_base + (pinned << PAGE_SHIFT),
+                                  min_t(unsigned long, page_count - pinned, INT_MAX),
+                                  FOLL_WRITE | FOLL_LONGTERM, pages + pinned);
+        if(ret <= 0) {
+            pr_alert("Failed to pin user buffer at 0x%lx (%ld)\n", config->user_base + (pinned << PAGE_SHIFT), ret);
+            err = ret ? ret : -EFAULT;
+            goto unpin;
+        }
+        pinned += ret;
+    }
+
+    config->region_count = 0;
+    for(end = 0; end < page_count; config->region_count++) {
+        end = ch_pinned_run_end(pages, end, page_count);
+    }
+    if(config->region_count > config->max_regions) {
+        /* Reports the regions required */
+        err = copy_to_user(user_config, config, sizeof(*config)) ? -EFAULT : -ENOSPC;
+        goto unpin;
+    }
+
+    while(i < page_count) {
+        end = ch_pinned_run_end(pages, i, page_count);
+        err = ch_region_list_add(&list, pages[i], (end - i) << PAGE_SHIFT, 0, 1);
+        if(err < 0) {
+            goto unpin;
+        }
+
+        /* Zeroed so that chases end at lines that were never linked */
+        memset(list.tail->base, 0, (end - i) << PAGE_SHIFT);
+
+        region.virtual_base = (uintptr_t)list.tail->base;
+        region.physical_base = page_to_pfn(pages[i]) << PAGE_SHIFT;
+        region.size = (end - i) << PAGE_SHIFT;
+        region.node = page_to_nid(pages[i]);
+        i = end;
+
+        if(copy_to_user(regions + list.count - 1, &region, sizeof(region))) {
+            err = -EFAULT;
+            goto unpin;
+        }
+    }
+
+    if(copy_to_user(user_config, config, sizeof(*config))) {
+        err = -EFAULT;
+        goto unpin;
+    }
+
+    mutex_lock(&state->lock);
+    ch_state_append_regions(state, &list);
+    mutex_unlock(&state->lock);
+
+    pr_info("Pinned %zu bytes of user memory in %zu regions\n", config->size, config->region_count);
+
+unpin:
+    /* The regions unpin their pages, those moved to the state when it is freed */
+    ch_region_list_free(&list);
+    if(i < pinned) {
+        unpin_user_pages(pages + i, pinned - i);
     }
+    kvfree(pages);
+    return err;
+}
+
+/*
+ * Allocates regions of at least config->size bytes in total, taking the
+ * largest blocks the buddy allocator hands out and falling back to smaller
+ * ones only when those run out. Physically adjacent blocks are reported as
+ * one region. Stops early once config->max_regions regions are reported,
+ * the caller then requests the remainder with another call. No region is
+ * kept if the regions or config cannot be reported to user space.
+ */
+static int ch_state_alloc_memory_bulk(struct ch_state* state, struct ch_ioc_bulk_alloc_config* config, struct ch_ioc_bulk_alloc_config __user* user_config) {
+    struct ch_ioc_region region = {0}, __user *regions = (struct ch_ioc_region __user*)config->regions;
+    struct ch_region_list list = {0};
+    size_t remaining = config->size, size;
+    unsigned order = min_t(unsigned, config->max_order, CH_MAX_ALLOC_ORDER), orders_used = 0;
+    uintptr_t physical_base;
+    int node = ch_cpu_node(config->cpu), err = 0;
+
+    config->region_count = 0;
+    config->allocated = 0;
+
+    while(remaining && config->region_count < config->max_regions) {
+        /* No block is larger than the remainder rounded up to a power of two */
+        order = min_t(unsigned, order, order_base_2(DIV_ROUND_UP(remaining, PAGE_SIZE)));
+
+        /* Higher orders fail fast instead of compacting or reclaiming */
+        err = ch_region_list_alloc(&list, order, order ? GFP_KERNEL | __GFP_NOWARN | __GFP_NORETRY : GFP_KERNEL, node);
+        if(err == -ENOMEM && order) {
+            order--;
+            continue;
+        } else if(err < 0) {
+            break;
+        }
 
-    pr_info("Cachehound kernel memory region of order %u allocated and mapped\n", order);
+        orders_used |= 1u << order;
+        size = PAGE_SIZE << order;
+        physical_base = page_to_pfn(list.tail->page) << PAGE_SHIFT;
+        remaining -= min(remaining, size);
+        config->allocated += size;
+
+        if(region.size && region.physical_base + region.size == physical_base
+                       && region.virtual_base + region.size == (uintptr_t)list.tail->base
+                       && region.node == page_to_nid(list.tail->page)) {
+            region.size += size;
+            continue;
+        }
+
+        if(region.size) {
+            if(copy_to_user(regions + config->region_count - 1, &region, sizeof(region))) {
+                err = -EFAULT;
+                break;
+            }
+        }
+        region.virtual_base = (uintptr_t)list.tail->base;
+        region.physical_base = physical_base;
+        region.size = size;
+        region.node = page_to_nid(list.tail->page);
+        config->region_count++;
+    }
 
+    if(!config->allocated) {
+        pr_alert("Failed to allocate any kernel memory region\n");
+        return -ENOMEM;
+    }
+
+    if(region.size && err != -EFAULT) {
+        if(copy_to_user(regions + config->region_count - 1, &region, sizeof(region))) {
+            err = -EFAULT;
+        }
+    }
+    if(err != -EFAULT && copy_to_user(user_config, config, sizeof(*config))) {
+        err = -EFAULT;
+    }
+    if(err == -EFAULT) {
+        /* The caller learns of none of the regions, so none are kept */
+        ch_region_list_free(&list);
+        return err;
+    }
+
+    mutex_lock(&state->lock);
+    ch_state_append_regions(state, &list);
+    mutex_unlock(&state->lock);
+
+    pr_info("Allocated %zu bytes in %zu regions (orders 0x%x)\n", config->allocated, config->region_count, orders_used);
     return 0;
 }
 
-int agent(void* type_erased_state) {
+/*
+ * Releases the siblings parked by ch_agent_state_quiesce_siblings and waits
+ * until they left their loops. Must be called with state->lock held.
+ */
+static void ch_agent_state_release_siblings(struct ch_agent_state* agent_state) {
+    WRITE_ONCE(agent_state->quiescing, 0);
+    while(atomic_read(&agent_state->parked_running)) {
+        usleep_range(10, 100);
+    }
+    agent_state->parked = 0;
+}
+
+int agent(void* type_erased_agent_state) {
     int cpu;
-    struct ch_state* state = type_erased_state;
+    struct ch_agent_state* agent_state = type_erased_agent_state;
+    struct ch_state* state = agent_state->state;
     unsigned long flags;
     struct ch_local_pmc local_pmc;
     unsigned i;
+    struct ch_agent agent = {
+        .channels = agent_state->channels,
+        .channel_count = CH_CHANNEL_COUNT,
+        .active_channel = &agent_state->active_channel,
+        .ring = agent_state->ring,
+        .ring_mask = CH_RING_ENTRIES - 1,
+        .results = agent_state->results,
+        .results_mask = CH_RESULT_ENTRIES - 1,
+        .program = agent_state->program,
+        .program_entries = CH_PROGRAM_ENTRIES,
+        .levels = agent_state->levels,
+        .levels_mask = CH_LEVEL_ENTRIES - 1,
+        .published_lines = &agent_state->published_lines,
+        .offset_bits = ch_cache_offset_bits(),
+        .prng_state = CH_PRNG_DEFAULT_SEED,
+        .counters = agent_state->counters,
+        .fixed_counters = ch_local_pmc_fixed_counters(),
+        .wait_policy = agent_state->wait_policy,
+        .stats = &agent_state->stats,
+    };
+
+    ch_agent_reload_lines(&agent);
+
+    /* The thread is bound to the CPU, so it stays there even while preemptible */
+    cpu = raw_smp_processor_id();
+    pr_info("Hello from " CH_AGENT_NAME " %u (PID %d) on CPU %d!\n", agent_state->index, current->pid, cpu);
+
+    /* Cache geometry as seen by the agent's CPU */
+    agent.cache_levels = min(ch_cache_levels(), (unsigned)CH_AGENT_CACHE_LEVELS);
+    for(i = 0; i < agent.cache_levels; i++) {
+        agent.sets[i] = ch_dcache_sets(i);
+        agent.ways[i] = ch_dcache_ways(i);
+    }
 
-    cpu = get_cpu();
-    pr_info("Hello from " CH_AGENT_NAME " (PID %d) on CPU %d!\n", current->pid, cpu);
+#if defined(__x86_64__) || defined(_M_X64)
+    /* NMIs and SMIs strike even with interrupts disabled */
+    agent.smis = ch_is_intel();
+#endif
 
-    if(state->isolation_level >= CH_ISOLATION_NO_PREEMPT) {
+    if(agent_state->isolation_level >= CH_ISOLATION_NO_PREEMPT) {
         preempt_disable();
-        if(state->isolation_level >= CH_ISOLATION_DISABLE_IRQ) {
+        if(agent_state->isolation_level >= CH_ISOLATION_DISABLE_IRQ) {
             local_irq_save(flags);
         }
     }
@@ -212,527 +724,144 @@ int agent(void* type_erased_state) {
     ch_local_pmc_save(&local_pmc);
 
     /* Configure PMC */
-    for(i = 0; i < 3; i++) {
-        if(state->evts[i] == 0) break;
-        pr_info("Programming counter %d to track event %llu\n", i, state->evts[i]);
-        ch_local_pmc_configure(i, state->evts[i]);
+    for(i = 0; i < agent_state->counters; i++) {
+        pr_info("Programming counter %d to track event %llu\n", i, agent_state->evts[i]);
+        ch_local_pmc_configure(i, agent_state->evts[i]);
     }
+    ch_local_pmc_configure_fixed(agent_state->counters);
 
-#if defined(__x86_64__) || defined(_M_X64)
-    asm volatile(
-        /* Nop slide to mark begin to verify code in objdump -d */
-        "nop\n"
-        "nop\n"
-        "nop\n"
-        "nop\n"
-
-        /* Calculate channel_ptr */
-        "movq (%[active_channel]), %%r15\n"
-        ".calculate_channel_ptr:\n"
-        "salq $6, %%r15\n"
-        "movq %[channels_ptr], %[channel_ptr]\n"
-        "addq %%r15, %[channel_ptr]\n"
-
-        /* Backup channel_ptr */
-        "movq %[channel_ptr], %%rsi\n"
-
-        /* Loop that waits for channel access (acquire semantics) */
-        ".retry:\n"
-        "pause\n"
-        "movq (%[channel_ptr]), %%rax\n"
-        "testq %%rax, %%rax\n"
-        "je .retry\n"
-
-        /* Extract count from request */
-        "shrq %%rax\n"
-
-        /* Exit if count == 0 && switch_channel == 0 && wbinvd == 0*/
-        "je .exit\n"
-
-        /* Check for wbinvd */
-        "movq %%rax, %%rbx\n"
-        "shrq $4, %%rbx\n"
-        "test %%rbx, %%rbx\n"
-        "jz .handle_switch_channel\n"
-        "wbinvd\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "lfence\n"
-        "xor %%rax, %%rax\n"
-        "movq %%rax, (%[channel_ptr])\n"
-        "jmp .retry\n"
-
-        /* Check for switch_channel */
-        ".handle_switch_channel:\n"
-        "movq %%rax, %%r15\n"
-        "shrq $3, %%r15\n"
-        "test %%r15, %%r15\n"
-        "jz .handle_count\n"
-        /* Put switched-out channel into idle */
-        "movq $0, (%[channel_ptr])\n"
-        /* Read new active_channel from data[0] */
-        "addq $8, %[channel_ptr]\n"
-        /* Read new active_channel into %r15 as used by .calculate_channel_ptr */
-        "movq (%[channel_ptr]), %%r15\n"
-        "movq %%r15, (%[active_channel])\n"
-        "mfence\n"
-        "jmp .calculate_channel_ptr\n"
-
-        /* This is where the action happens */
-        ".handle_count:\n"
-        /* Address mask */
-        "movabsq $0xFFFF000000000000, %%r15\n"
-        /* Decrement count by one */
-        "subq $1, %%rax\n"
-        /* Jump to instrumented loop if we reached 0 */
-        "je .instrloop\n"
-
-        /* Non-instrumented loop */
-        ".noninstrloop:\n"
-        "addq $8, %[channel_ptr]\n"
-        "movq (%[channel_ptr]), %%rbx\n"
-        "test %%rbx, %%rbx\n"
-        "jns .noninstr_flush\n"
-        "orq %%r15, %%rbx\n"
-        "movq (%%rbx), %%rbx\n"
-        "jmp .noninstr_noflush\n"
-        ".noninstr_flush:\n"
-        "orq %%r15, %%rbx\n"
-        "clflush (%%rbx)\n"
-        ".noninstr_noflush:\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "subq $1, %%rax\n"
-        "jne .noninstrloop\n"
-
-        /* Instrumented loop */
-        ".instrloop:\n"
-        "addq $8, %[channel_ptr]\n"
-        "movq (%[channel_ptr]), %%r11\n"
-        "xor %%rax, %%rax\n"
-        "cpuid\n"
-        /* RDPMC 0 into R08 */
-        "xor %%rcx, %%rcx\n"
-        "rdpmc\n"
-        "salq $32, %%rdx\n"
-        "orq %%rax, %%rdx\n"
-        "movq %%rdx, %%r8\n"
-        /* RDPMC 1 into R09 */
-        "addq $1, %%rcx\n"
-        "rdpmc\n"
-        "salq $32, %%rdx\n"
-        "orq %%rax, %%rdx\n"
-        "movq %%rdx, %%r9\n"
-        /* RDPMC 3 into R10 */
-        "addq $1, %%rcx\n"
-        "rdpmc\n"
-        "salq $32, %%rdx\n"
-        "orq %%rax, %%rdx\n"
-        "movq %%rdx, %%r10\n"
-        /* Perform access */
-        "test %%r11, %%r11\n"
-        "jns .instr_flush\n"
-        "orq %%r15, %%r11\n"
-        "movq (%%r11), %%rbx\n"
-        "jmp .instr_noflush\n"
-        ".instr_flush:\n"
-        "orq %%r15, %%r11\n"
-        "clflush (%%r11)\n"
-        ".instr_noflush:\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "mfence\n"
-        "xor %%rax, %%rax\n"
-        "cpuid\n"
-        /* RDPMC 0 into R11 */
-        "xor %%rcx, %%rcx\n"
-        "rdpmc\n"
-        "salq $32, %%rdx\n"
-        "orq %%rax, %%rdx\n"
-        "movq %%rdx, %%r11\n"
-        /* RDPMC 1 into R15 */
-        "addq $1, %%rcx\n"
-        "rdpmc\n"
-        "salq $32, %%rdx\n"
-        "orq %%rax, %%rdx\n"
-        "movq %%rdx, %%r15\n"
-        /* RDPMC 3 into RDX */
-        "addq $1, %%rcx\n"
-        "rdpmc\n"
-        "salq $32, %%rdx\n"
-        "orq %%rax, %%rdx\n"
-
-        /* Write back counters into channel (release semantics) */
-        "movq %%rsi, %[channel_ptr]\n"
-        "addq $8, %[channel_ptr]\n"
-        "movq %%r8, (%[channel_ptr])\n"
-        "addq $8, %[channel_ptr]\n"
-        "movq %%r9, (%[channel_ptr])\n"
-        "addq $8, %[channel_ptr]\n"
-        "movq %%r10, (%[channel_ptr])\n"
-        "addq $8, %[channel_ptr]\n"
-        "movq %%r11, (%[channel_ptr])\n"
-        "addq $8, %[channel_ptr]\n"
-        "movq %%r15, (%[channel_ptr])\n"
-        "addq $8, %[channel_ptr]\n"
-        "movq %%rdx, (%[channel_ptr])\n"
-        "movq %%rsi, %[channel_ptr]\n"
-        "xor %%rax, %%rax\n"
-        "movq %%rax, (%[channel_ptr])\n"
-        "sfence\n"
-        "jmp .retry\n"
-
-        ".exit:\n"
-
-        /* Nop slide to mark end to verify code in objdump -d */
-        "nop\n"
-        "nop\n"
-        "nop\n"
-        "nop\n"
-
-        /* Output registers*/
-        :
-
-        /* Input registers */
-        : [channels_ptr] "r"(state->channels)
-        , [channel_ptr] "r"(0ULL)
-        , [active_channel] "r"(&(state->active_channel))
-
-        /* Clobber registers */
-        : "%rax", "%rbx", "%rcx", "%rdx", "%rsi"
-        , "%r8", "%r9", "%r10", "%r11", "%r15"
-        , "memory"
-    );
-#elif defined(__aarch64__) || defined(_M_ARM64)
-    unsigned long long cisw_counter = 0
-                     , isw_counter  = 0
-                     , csw_counter  = 0;
-
-    asm volatile (
-        /* Nop slide to mark begin to verify code in objdump -d */
-        "NOP\n"
-        "NOP\n"
-        "NOP\n"
-        "NOP\n"
-        "MOV %[cisw_counter], xzr\n"
-        "MOV %[isw_counter], xzr\n"
-        "MOV %[csw_counter], xzr\n"
-
-        /* Calculate channel_ptr */
-        "LDR x0, [%[active_channel]]\n"
-        ".calculate_channel_ptr:\n"
-        "UBFIZ x0, x0, #6, #32\n"
-        "MOV %[channel_ptr], %[channels_ptr]\n"
-        "ADD %[channel_ptr], %[channel_ptr], x0\n"
-
-        /* Backup channel_ptr */
-        "MOV x0, %[channel_ptr]\n"
-
-        /* Loop that waits for channel access (acquire semantics) */
-        ".retry:\n"
-        "YIELD\n"
-        "LDAR x1, [%[channel_ptr]]\n"
-        "CBZ x1, .retry\n"
-
-        /* Extract count from request */
-        "LSR x1, x1, #1\n"
-
-        /* Exit if count == 0 && switch_channel == 0 && clean_invalidate_cache == 0 */
-        "CBZ x1, .exit\n"
-
-        /* Check for clean_invalidate_cache */
-        // ".clean_invalidate_cache:\n"
-        // "UBFX x2, x1, #4, #2\n"
-        // "CBZ x2, .handle_switch_channel\n"
-
-        // "MRS x3, CLIDR_EL1\n"
-        // "AND w4, w0, #0x07000000\n"
-        // "LSR w4, w4, #23\n"
-        // "STLR xzr, [%[channel_ptr]]\n"
-        // "CBZ w4, .retry\n"
-        // "mov w10, #0\n"
-        // "mov w8, #1\n"
-        // ""
-
-        /* Check for switch_channel */
-        ".handle_switch_channel:\n"
-        "UBFX x2, x1, #3, #1\n"
-        "CBZ x2, .handle_count\n"
-        /* Put switched-out channel into idle */
-        "STLR xzr, [%[channel_ptr]]\n"
-        /* Read new active_channel from data[0] into x0 as used by .calculate_channel_ptr */
-        "LDR x0, [%[channel_ptr], #8]\n"
-        "STLR x0, [%[active_channel]]\n"
-        "B .calculate_channel_ptr\n"
-
-        /* This is where the action happens */
-        ".handle_count:\n"
-        /* Decrement count by one */
-        "SUB x1, x1, #1\n"
-        /* Jump to instrumented loop if we reached 0 */
-        "CBZ x1, .instrloop\n"
-
-        /* Non-instrumented loop */
-        ".noninstrloop:\n"
-        "ADD %[channel_ptr], %[channel_ptr], #8\n"
-        "LDR x2, [%[channel_ptr]]\n"
-        /* Check highest two bits for CISW */
-        "UBFX x3, x2, #62, #2\n"
-        "CMP x3, #2\n"
-        "B.GT 3f\n"    /* >2 -> 3 -> no CISW */
-        "B.EQ 2f\n"    /* 2 -> ISW */
-        "CBZ x3, 0f\n" /* 0 -> CISW */
-
-        "1:\n"
-        "DC CSW, x2\n"
-        "ADD %[csw_counter], %[csw_counter], #1\n"
-        "B 4f\n"
-
-        "2:\n"
-        "DC ISW, x2\n"
-        "ADD %[isw_counter], %[isw_counter], #1\n"
-        "B 4f\n"
-
-        "0:\n"
-        "DC CISW, x2\n"
-        "ADD %[cisw_counter], %[cisw_counter], #1\n"
-        "B 4f\n"
-
-        /* Normal access */
-        "3:\n"
-        "LDR x2, [x2]\n"
-        "4:\n"
-        "DSB SY\n"
-        "SUB x1, x1, #1\n"
-        "CBNZ x1, .noninstrloop\n"
-
-        /* Instrumented loop */
-        ".instrloop:\n"
-        "ADD %[channel_ptr], %[channel_ptr], #8\n"
-        "LDR x2, [%[channel_ptr]]\n"
-        /* Check highest two bits for CISW */
-        "UBFX x3, x2, #62, #2\n"
-        "CMP x3, #2\n"
-        "B.GT 3f\n"    /* >2 -> 3 -> no CISW */
-        "B.EQ 2f\n"    /* 2 -> ISW */
-        "CBZ x3, 0f\n" /* 0 -> CISW */
-
-        "1:\n"
-        "DC CSW, x2\n"
-        "ADD %[csw_counter], %[csw_counter], #1\n"
-        "B 4f\n"
-
-        "2:\n"
-        "DC ISW, x2\n"
-        "ADD %[isw_counter], %[isw_counter], #1\n"
-        "B 4f\n"
-
-        "0:\n"
-        "DC CISW, x2\n"
-        "ADD %[cisw_counter], %[cisw_counter], #1\n"
-        "B 4f\n"
-
-        /* Instrumented access */
-        "3:\n"
-        "ISB SY\n"
-        /* PMU counter 0 into x3 */
-        "MRS x3, PMEVCNTR0_EL0\n"
-        /* PMU counter 1 into x4 */
-        "MRS x4, PMEVCNTR1_EL0\n"
-        /* PMU counter 2 into x5 */
-        "MRS x5, PMEVCNTR2_EL0\n"
-        /* Perform access */
-        "LDR x2, [x2]\n"
-        "ISB SY\n"
-        /* PMU counter 0 into x6 */
-        "MRS x6, PMEVCNTR0_EL0\n"
-        /* PMU counter 1 into x7 */
-        "MRS x7, PMEVCNTR1_EL0\n"
-        /* PMU counter 2 into x8 */
-        "MRS x8, PMEVCNTR2_EL0\n"
-
-        /* Write back counters into channel (release semantics) */
-        "MOV %[channel_ptr], x0\n"
-        "ADD %[channel_ptr], %[channel_ptr], #8\n"
-        "STR x3, [%[channel_ptr]]\n"
-        "ADD %[channel_ptr], %[channel_ptr], #8\n"
-        "STR x4, [%[channel_ptr]]\n"
-        "ADD %[channel_ptr], %[channel_ptr], #8\n"
-        "STR x5, [%[channel_ptr]]\n"
-        "ADD %[channel_ptr], %[channel_ptr], #8\n"
-        "STR x6, [%[channel_ptr]]\n"
-        "ADD %[channel_ptr], %[channel_ptr], #8\n"
-        "STR x7, [%[channel_ptr]]\n"
-        "ADD %[channel_ptr], %[channel_ptr], #8\n"
-        "STR x8, [%[channel_ptr]]\n"
-
-        "4:\n"
-        "DSB SY\n"
-        "MOV %[channel_ptr], x0\n"
-        "STLR xzr, [%[channel_ptr]]\n"
-        "B .retry\n"
-
-        ".exit:\n"
-
-        /* Nop slide to mark end to verify code in objdump -d */
-        "NOP\n"
-        "NOP\n"
-        "NOP\n"
-        "NOP\n"
-
-        /* Output registers */
-        : [cisw_counter] "=&r"(cisw_counter)
-        , [isw_counter] "=&r"(isw_counter)
-        , [csw_counter] "=&r"(csw_counter)
-
-        /* Input registers */
-        : [channels_ptr] "r"(state->channels)
-        , [channel_ptr] "r"(0ULL)
-        , [active_channel] "r"(&(state->active_channel))
-
-        /* Clobber registers */
-        : "x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7", "x8", "memory"
-    );
-
-    pr_info("cisw_counter = %llu\n", cisw_counter);
-    pr_info("csw_counter = %llu\n", csw_counter);
-    pr_info("isw_counter = %llu\n", isw_counter);
-
-    // unsigned long long id0;
-    // asm volatile("MRS %[id0], PMCR_EL0" : [id0] "=r"(id0));
-    // pr_info("PMCR = %llu\n", id0);
-    // asm volatile("MRS %[id0], PMCNTENSET_EL0" : [id0] "=r"(id0));
-    // pr_info("PMCNTENSET = %llu\n", id0);
-    // asm volatile("MSR PMSELR_EL0, %[val]" :: [val] "r"(2));
-    // asm volatile("MRS %[id0], PMSELR_EL0" : [id0] "=r"(id0));
-    // pr_info("PMSELR = %llu\n", id0);
-    // asm volatile("MRS %[id0], PMXEVTYPER_EL0" : [id0] "=r"(id0));
-    // pr_info("PMXEVTYPER = %llu\n", id0);
-    // asm volatile("MRS %[id0], PMXEVCNTR_EL0" : [id0] "=r"(id0));
-    // pr_info("PMXEVCNTR = %llu\n", id0);
-    // asm volatile("MRS %[id0], PMCCFILTR_EL0" : [id0] "=r"(id0));
-    // pr_info("PMCCFILTR = %llu\n", id0);
-    // asm volatile("MRS %[id0], PMCCNTR_EL0" : [id0] "=r"(id0));
-    // pr_info("PMCCNTR = %llu\n", id0);
-    // asm volatile ("MRS %[id0], CurrentEL" : [id0] "=r"(id0));
-    // pr_info("EL = %llu\n", id0 >> 2);
-    // // asm volatile("MSR s3_0_c15_c1_4, %[val]" :: [val] "r"(0x0000000961563000 | (1 << 15) | (1 << 5)));
-    // asm volatile("MRS %[id0], S3_0_C15_C1_4" : [id0] "=r"(id0));
-    // pr_info("CPUECTLR = %llu\n", id0);
-
-    // asm volatile("MSR CSSELR_EL1, %[val]" :: [val] "r"(0b110));
-    // asm volatile("MRS %[id0], CSSELR_EL1" : [id0] "=r"(id0));
-    // pr_info("CSSELR = %llu\n", id0);
-    // asm volatile("MRS %[id0], CCSIDR_EL1" : [id0] "=r"(id0));
-    // pr_info("CCSIDR = %llu\n", id0);
+    ch_agent_run(&agent);
 
+    if(agent.invalid_entries) {
+        pr_alert("Skipped %llu invalid ring entries\n", agent.invalid_entries);
+    }
+    pr_info("Waited for submissions %llu times (%llu sleeps), wake-up latency avg %llu / max %llu cycles\n",
+        agent.wait_stats.waits, agent.wait_stats.sleeps,
+        agent.wait_stats.waits ? agent.wait_stats.latency_sum / agent.wait_stats.waits : 0, agent.wait_stats.latency_max);
+#if defined(__aarch64__) || defined(_M_ARM64)
+    pr_info("cisw_counter = %llu\n", agent.cisw_counter);
+    pr_info("csw_counter = %llu\n", agent.csw_counter);
+    pr_info("isw_counter = %llu\n", agent.isw_counter);
 #endif
 
     /* Restore previously saved PMC configuration */
     ch_local_pmc_restore(&local_pmc);
 
-    if(state->isolation_level >= CH_ISOLATION_NO_PREEMPT) {
-        if(state->isolation_level >= CH_ISOLATION_DISABLE_IRQ) {
+    if(agent_state->isolation_level >= CH_ISOLATION_NO_PREEMPT) {
+        if(agent_state->isolation_level >= CH_ISOLATION_DISABLE_IRQ) {
             local_irq_restore(flags);
         }
         preempt_enable();
     }
 
-    pr_info("Goodbye from " CH_AGENT_NAME " (PID %d) on CPU %d!\n", current->pid, cpu);
-    put_cpu();
+    /* Releases the parked siblings, no more are parked afterwards */
+    mutex_lock(&state->lock);
+    WRITE_ONCE(agent_state->exited, 1);
+    ch_agent_state_release_siblings(agent_state);
+    mutex_unlock(&state->lock);
+
+    pr_info("Goodbye from " CH_AGENT_NAME " %u (PID %d) on CPU %d!\n", agent_state->index, current->pid, cpu);
     ch_state_put(state);
 
     return 0;
 }
 
+/*
+ * Parks an SMT sibling of an agent's CPU for the agent's lifetime so that
+ * neither other tasks nor (at CH_ISOLATION_DISABLE_IRQ) interrupt handlers
+ * pollute the caches the sibling shares with the agent. The loop only
+ * pauses, polling the agent's state merely every CH_QUIESCE_SPINS pauses.
+ */
+static int quiesce_sibling(void* type_erased_agent_state) {
+    struct ch_agent_state* agent_state = type_erased_agent_state;
+    unsigned long flags;
+    unsigned i;
+
+    preempt_disable();
+    if(agent_state->isolation_level >= CH_ISOLATION_DISABLE_IRQ) {
+        local_irq_save(flags);
+    }
+
+    while(READ_ONCE(agent_state->quiescing)) {
+        for(i = 0; i < CH_QUIESCE_SPINS; i++) {
+            cpu_relax();
+        }
+    }
+
+    if(agent_state->isolation_level >= CH_ISOLATION_DISABLE_IRQ) {
+        local_irq_restore(flags);
+    }
+    preempt_enable();
+
+    atomic_dec(&agent_state->parked_running);
+    ch_state_put(agent_state->state);
+    return 0;
+}
+
+/*
+ * Parks the online SMT siblings of the agent's CPU that no agent of the
+ * state runs on. Returns the number of siblings parked. Must be called with
+ * state->lock held.
+ */
+static unsigned ch_agent_state_quiesce_siblings(struct ch_agent_state* agent_state) {
+    struct ch_state* state = agent_state->state;
+    struct task_struct* task;
+    unsigned sibling, parked = 0, i;
+
+    if(agent_state->quiescing) {
+        return agent_state->parked;
+    }
+
+    WRITE_ONCE(agent_state->quiescing, 1);
+    for_each_cpu(sibling, topology_sibling_cpumask(agent_state->cpu)) {
+        if(sibling == agent_state->cpu || !cpu_online(sibling)) {
+            continue;
+        }
+        for(i = 0; i < state->agent_count && state->agents[i]->cpu != sibling; i++);
+        if(i < state->agent_count) {
+            pr_info("Not parking CPU %u, agent %u runs on it\n", sibling, i);
+            continue;
+        }
+
+        task = kthread_create(quiesce_sibling, agent_state, CH_AGENT_NAME "/%u-park%u", agent_state->index, sibling);
+        if(IS_ERR(task)) {
+            pr_alert("Failed to create kthread parking CPU %u\n", sibling);
+            continue;
+        }
+        kthread_bind(task, sibling);
+        ch_state_get(state);
+        atomic_inc(&agent_state->parked_running);
+        wake_up_process(task);
+        parked++;
+    }
+
+    if(!parked) {
+        WRITE_ONCE(agent_state->quiescing, 0);
+    }
+    agent_state->parked = parked;
+    return parked;
+}
+
+/*
+ * Submits an exit command once the agent drained the ring.
+ * Must only be called after the user process has gone.
+ */
+void ch_agent_state_terminate(struct ch_agent_state* agent_state) {
+    struct ch_channel* channel;
+    struct ch_wait_stats wait_stats = {0};
+    uint64_t head;
+
+    do {
+        channel = agent_state->channels + smp_load_acquire(&agent_state->active_channel);
+        head = ch_channel_read_head(channel);
+        ch_channel_wait_for_tail(channel, head, CH_WAIT_SLEEP, &wait_stats);
+    } while(channel != agent_state->channels + smp_load_acquire(&agent_state->active_channel));
+
+    pr_info("Terminating agent %u on channel %zu\n", agent_state->index, (size_t)(channel - agent_state->channels));
+    agent_state->ring[head & (CH_RING_ENTRIES - 1)] = ch_command_entry(CH_COMMAND_EXIT, 0);
+    ch_channel_publish_head(channel, head + 1);
+}
+
 static int device_open(struct inode* inode, struct file* file) {
     struct ch_state* state = alloc_ch_state();
     if(!state) return -ENOMEM;
@@ -742,35 +871,219 @@ static int device_open(struct inode* inode, struct file* file) {
 
 static int device_release(struct inode* inode, struct file* file) {
     struct ch_state* state = file->private_data;
-    if(atomic_read(&state->started)) {
-        pr_info("Terminating channel %zu\n", state->active_channel);
-        _ch_channel_terminate(state->channels + state->active_channel);
+    unsigned i;
+
+    for(i = 0; i < state->agent_count; i++) {
+        if(state->agents[i]->started && !READ_ONCE(state->agents[i]->exited)) {
+            ch_agent_state_terminate(state->agents[i]);
+        }
     }
+
+    /* The agents release their siblings on exit, but do not rely on them */
+    mutex_lock(&state->lock);
+    for(i = 0; i < state->agent_count; i++) {
+        ch_agent_state_release_siblings(state->agents[i]);
+    }
+    mutex_unlock(&state->lock);
+
     ch_state_put(state);
     pr_info("File released\n");
     return 0;
 }
 
 static int device_mmap(struct file* file, struct vm_area_struct* vma) {
-    unsigned long pfn, len;
+    unsigned long pfn, len, max_len, pgoff;
+    unsigned index;
+    struct ch_agent_state* agent_state = NULL;
     int ret;
 
     struct ch_state* state = file->private_data;
 
-    pfn = page_to_pfn(state->channels_page);
+    index = vma->vm_pgoff / CH_MMAP_AGENT_PAGES;
+    pgoff = vma->vm_pgoff % CH_MMAP_AGENT_PAGES;
+
+    mutex_lock(&state->lock);
+    if(index < state->agent_count) {
+        agent_state = state->agents[index];
+    }
+    mutex_unlock(&state->lock);
+
+    if(!agent_state) {
+        pr_err("Invalid mmap offset %lu, agent %u was not started\n", vma->vm_pgoff, index);
+        return -EINVAL;
+    }
+
+    if(pgoff == 0) {
+        pfn = page_to_pfn(agent_state->channels_page);
+        max_len = PAGE_SIZE;
+    } else if(pgoff == CH_MMAP_RING_PGOFF) {
+        pfn = page_to_pfn(agent_state->ring_page);
+        max_len = PAGE_SIZE << CH_RING_ORDER;
+    } else if(pgoff == CH_MMAP_RESULTS_PGOFF) {
+        pfn = page_to_pfn(agent_state->results_page);
+        max_len = PAGE_SIZE << CH_RESULTS_ORDER;
+    } else if(pgoff == CH_MMAP_PROGRAM_PGOFF) {
+        pfn = page_to_pfn(agent_state->program_page);
+        max_len = PAGE_SIZE << CH_PROGRAM_ORDER;
+    } else if(pgoff == CH_MMAP_LEVELS_PGOFF) {
+        pfn = page_to_pfn(agent_state->levels_page);
+        max_len = PAGE_SIZE << CH_LEVELS_ORDER;
+    } else {
+        pr_err("Invalid mmap offset %lu\n", vma->vm_pgoff);
+        return -EINVAL;
+    }
 
     len = vma->vm_end - vma->vm_start;
+    if(len > max_len) {
+        pr_err("Requested mapping of %lu bytes exceeds %lu bytes\n", len, max_len);
+        return -EINVAL;
+    }
+
     ret = remap_pfn_range(vma, vma->vm_start, pfn, len, vma->vm_page_prot);
     if(ret < 0) {
-        pr_err("Could not map channels page into user process\n");
+        pr_err("Could not map shared pages into user process\n");
         return -EIO;
     }
 
     return 0;
 }
 
-static long device_ioctl(struct file* file, unsigned int request, unsigned long argp) {
+/*
+ * Checks whether another agent may start on the CPU. Must be called with
+ * state->lock held.
+ */
+static int ch_state_check_agent_start(struct ch_state* state, unsigned cpu) {
+    unsigned i;
+
+    for(i = 0; i < state->agent_count; i++) {
+        /* Two isolated agents on one CPU would wait for each other forever */
+        if(state->agents[i]->cpu == cpu) {
+            pr_alert("CPU %u already runs agent %u\n", cpu, i);
+            return -EBUSY;
+        }
+        if(READ_ONCE(state->agents[i]->quiescing) && state->agents[i]->cpu != cpu
+                && cpumask_test_cpu(cpu, topology_sibling_cpumask(state->agents[i]->cpu))) {
+            pr_alert("CPU %u is parked for agent %u\n", cpu, i);
+            return -EBUSY;
+        }
+    }
+    if(!state->regions.head) {
+        return -EINVAL;
+    }
+    if(state->agent_count == CH_MAX_AGENTS) {
+        pr_alert("All %d agents already started by preceding calls to ioctl()\n", CH_MAX_AGENTS);
+        return -EBUSY;
+    }
+
+    return 0;
+}
+
+/*
+ * Starts an agent as validated config requests and reports it to user_config.
+ * The agent joins state->agents only once nothing can fail anymore, so that
+ * a failed start neither occupies its CPU nor an index.
+ */
+static int ch_state_start_agent(struct ch_state* state, struct ch_ioc_start_config* config, struct ch_ioc_start_config __user* user_config) {
+    struct ch_agent_state* agent_state;
     struct task_struct* agent_task;
+    unsigned index, i;
+    int err;
+
+    /* Keeps the index of the agent until it joins */
+    mutex_lock(&state->start_lock);
+
+    mutex_lock(&state->lock);
+    err = ch_state_check_agent_start(state, config->cpu);
+    index = state->agent_count;
+    mutex_unlock(&state->lock);
+    if(err < 0) {
+        goto unlock_start;
+    }
+
+    agent_state = alloc_ch_agent_state(state, index, ch_cpu_node(config->cpu));
+    if(!agent_state) {
+        err = -ENOMEM;
+        goto unlock_start;
+    }
+    agent_state->cpu = config->cpu;
+    agent_state->isolation_level = config->isolation_level;
+    agent_state->wait_policy = config->wait_policy;
+    for(i = 0; i < CH_RESULT_COUNTERS && config->evts[i]; i++) {
+        agent_state->evts[i] = config->evts[i];
+    }
+    agent_state->counters = i;
+
+    config->agent = agent_state->index;
+    config->channels_base = (uintptr_t)agent_state->channels;
+    config->channels_physical_base = page_to_pfn(agent_state->channels_page) << PAGE_SHIFT;
+    config->ring_base = (uintptr_t)agent_state->ring;
+    config->ring_physical_base = page_to_pfn(agent_state->ring_page) << PAGE_SHIFT;
+    config->results_base = (uintptr_t)agent_state->results;
+    config->results_physical_base = page_to_pfn(agent_state->results_page) << PAGE_SHIFT;
+    config->levels_base = (uintptr_t)agent_state->levels;
+    config->levels_physical_base = page_to_pfn(agent_state->levels_page) << PAGE_SHIFT;
+    config->channel_count = CH_CHANNEL_COUNT;
+    config->active_channel = agent_state->active_channel;
+    config->ring_entries = CH_RING_ENTRIES;
+    config->result_entries = CH_RESULT_ENTRIES;
+    config->program_entries = CH_PROGRAM_ENTRIES;
+    config->level_entries = CH_LEVEL_ENTRIES;
+    config->counters = agent_state->counters;
+    config->fixed_counters = ch_local_pmc_fixed_counters();
+    config->node = ch_cpu_node(config->cpu);
+    pr_info("Agent:                  %u\n", config->agent);
+    pr_info("Channels base address:  0x%px\n", (void*)(config->channels_base));
+    pr_info("Channels physical base: 0x%px\n", (void*)(config->channels_physical_base));
+    pr_info("Active channel:         %zu (of %zu)\n", config->active_channel, config->channel_count);
+    pr_info("Active channel address: 0x%px\n", (void*)(agent_state->channels + agent_state->active_channel));
+    pr_info("Ring entries:           %zu\n", config->ring_entries);
+    pr_info("Result entries:         %zu\n", config->result_entries);
+    pr_info("Program entries:        %zu\n", config->program_entries);
+    pr_info("Level entries:          %zu\n", config->level_entries);
+    pr_info("Counters:               %u programmable, %u fixed\n", config->counters, config->fixed_counters);
+    pr_info("NUMA node:              %d\n", config->node);
+
+    /* Outside of state->lock, which device_mmap() takes under mmap_lock */
+    if(copy_to_user(user_config, config, sizeof(*config))) {
+        err = -EFAULT;
+        goto free_agent_state;
+    }
+
+    mutex_lock(&state->lock);
+    /* Siblings of the CPU may have been parked in the meantime */
+    err = ch_state_check_agent_start(state, config->cpu);
+    if(err < 0) {
+        goto unlock;
+    }
+
+    agent_task = kthread_create(agent, agent_state, CH_AGENT_NAME "/%u", agent_state->index);
+    if(IS_ERR(agent_task)) {
+        pr_alert("Failed to create kthread on cpu\n");
+        err = PTR_ERR(agent_task);
+        goto unlock;
+    }
+    kthread_bind(agent_task, config->cpu);
+
+    ch_agent_state_publish_lines(agent_state, ch_cache_offset_bits());
+    agent_state->started = 1;
+    state->agents[state->agent_count++] = agent_state;
+    ch_state_get(state);
+    mutex_unlock(&state->lock);
+    mutex_unlock(&state->start_lock);
+
+    wake_up_process(agent_task);
+    return 0;
+
+unlock:
+    mutex_unlock(&state->lock);
+free_agent_state:
+    ch_agent_state_free(agent_state);
+unlock_start:
+    mutex_unlock(&state->start_lock);
+    return err;
+}
+
+static long device_ioctl(struct file* file, unsigned int request, unsigned long argp) {
     int err;
     struct ch_state* state;
     unsigned level;
@@ -780,30 +1093,62 @@ static long device_ioctl(struct file* file, unsigned int request, unsigned long
 
     if(request == CH_IOC_ALLOC_MEMORY) {
         struct ch_ioc_alloc_config config;
+        struct ch_region_list list = {0};
 
-        err = copy_from_user(&config, (struct ch_ioc_alloc_config*)argp, sizeof(config));
-        if(err < 0) {
-            return err;
+        if(copy_from_user(&config, (struct ch_ioc_alloc_config*)argp, sizeof(config))) {
+            return -EFAULT;
+        }
+
+        if(config.cpu >= NR_CPUS) {
+            pr_alert("User requested memory local to CPU core %d that does not exist\n", config.cpu);
+            return -EINVAL;
         }
 
-        err = ch_state_alloc_memory(state, config.order);
+        err = ch_region_list_alloc(&list, config.order, GFP_KERNEL, ch_cpu_node(config.cpu));
         if(err < 0) {
+            pr_info("Allocation of kernel page of order %u failed\n", config.order);
             return err;
         }
 
-        config.physical_base = (page_to_pfn(state->regions_tail->page) << PAGE_SHIFT);
-        config.virtual_base = (uintptr_t)state->regions_tail->base;
+        config.physical_base = (page_to_pfn(list.tail->page) << PAGE_SHIFT);
+        config.virtual_base = (uintptr_t)list.tail->base;
+        config.node = page_to_nid(list.tail->page);
+
+        if(copy_to_user((struct ch_ioc_alloc_config*)argp, &config, sizeof(config))) {
+            ch_region_list_free(&list);
+            return -EFAULT;
+        }
+
+        mutex_lock(&state->lock);
+        ch_state_append_regions(state, &list);
+        mutex_unlock(&state->lock);
 
         pr_info("Allocated new memory region:\n");
         pr_info("Physical base address: 0x%px\n", (void*)(config.physical_base));
         pr_info("Virtual base address:  0x%px\n", (void*)(config.virtual_base));
 
-        err = copy_to_user((struct ch_ioc_alloc_config*)argp, &config, sizeof(config));
-        if(err < 0) {
-            return err;
+        return 0;
+    } else if(request == CH_IOC_ALLOC_MEMORY_BULK) {
+        struct ch_ioc_bulk_alloc_config config;
+
+        if(copy_from_user(&config, (struct ch_ioc_bulk_alloc_config*)argp, sizeof(config))) {
+            return -EFAULT;
         }
 
-        return 0;
+        if(config.cpu >= NR_CPUS) {
+            pr_alert("User requested memory local to CPU core %d that does not exist\n", config.cpu);
+            return -EINVAL;
+        }
+
+        return ch_state_alloc_memory_bulk(state, &config, (struct ch_ioc_bulk_alloc_config*)argp);
+    } else if(request == CH_IOC_PIN_MEMORY) {
+        struct ch_ioc_pin_config config;
+
+        if(copy_from_user(&config, (struct ch_ioc_pin_config*)argp, sizeof(config))) {
+            return -EFAULT;
+        }
+
+        return ch_state_pin_memory(state, &config, (struct ch_ioc_pin_config*)argp);
     } else if(request == CH_IOC_CACHE_INFO) {
         struct ch_ioc_cache_info cache_info;
         cache_info.levels = ch_cache_levels();
@@ -813,21 +1158,15 @@ static long device_ioctl(struct file* file, unsigned int request, unsigned long
             cache_info.ways[level] = ch_dcache_ways(level);
         }
 
-        err = copy_to_user((struct ch_ioc_cache_info*)argp, &cache_info, sizeof(cache_info));
-        if(err < 0) {
-            return err;
+        if(copy_to_user((struct ch_ioc_cache_info*)argp, &cache_info, sizeof(cache_info))) {
+            return -EFAULT;
         }
         return 0;
     } else if(request == CH_IOC_START_AGENT) {
         struct ch_ioc_start_config config;
 
-        if(!state->regions_head) {
-            return -EINVAL;
-        }
-
-        err = copy_from_user(&config, (struct ch_ioc_start_config*)argp, sizeof(config));
-        if(err < 0) {
-            return err;
+        if(copy_from_user(&config, (struct ch_ioc_start_config*)argp, sizeof(config))) {
+            return -EFAULT;
         }
 
         if(config.cpu >= NR_CPUS) {
@@ -838,41 +1177,81 @@ static long device_ioctl(struct file* file, unsigned int request, unsigned long
             pr_alert("Invalid isolation level %u\n", config.isolation_level);
             return -EINVAL;
         }
+        for(i = 0; i < CH_RESULT_COUNTERS && config.evts[i]; i++);
+        if(i > ch_local_pmc_counters()) {
+            pr_alert("%d events requested but only %u counters are available\n", i, ch_local_pmc_counters());
+            return -EINVAL;
+        }
+        if(config.wait_policy >= NR_CH_WAIT_POLICIES || !ch_wait_policy_supported(config.wait_policy)) {
+            pr_alert("Wait policy %u is not supported\n", config.wait_policy);
+            return -EINVAL;
+        }
+        if(config.wait_policy == CH_WAIT_SLEEP && config.isolation_level >= CH_ISOLATION_NO_PREEMPT) {
+            pr_alert("Agent cannot sleep without preemption\n");
+            return -EINVAL;
+        }
 
         pr_info("Requested agent to launch on CPU %d\n", config.cpu);
 
-        if(!ch_state_try_start(state)) {
-            pr_alert("Agent already started by a preceding call to ioctl()\n");
-            return -EBUSY;
-        }
+        return ch_state_start_agent(state, &config, (struct ch_ioc_start_config*)argp);
+    } else if(request == CH_IOC_QUIESCE_SIBLINGS) {
+        struct ch_ioc_quiesce_config config;
+        struct ch_agent_state* agent_state;
 
-        state->isolation_level = config.isolation_level;
-        for(i = 0; i < 3; i++) {
-            state->evts[i] = config.evts[i];
+        if(copy_from_user(&config, (struct ch_ioc_quiesce_config*)argp, sizeof(config))) {
+            return -EFAULT;
         }
 
-        config.channels_base = (uintptr_t)state->channels;
-        config.channel_count = PAGE_SIZE / sizeof(struct ch_channel);
-        config.active_channel = state->active_channel;
-        pr_info("Channels base address:  0x%px\n", (void*)(config.channels_base));
-        pr_info("Active channel:         %zu (of %zu)\n", config.active_channel, config.channel_count);
-        pr_info("Active channel address: 0x%px\n", (void*)(state->channels + state->active_channel));
-
-        err = copy_to_user((struct ch_ioc_start_config*)argp, &config, sizeof(config));
-        if(err < 0) {
-            return err;
+        mutex_lock(&state->lock);
+        if(config.agent >= state->agent_count || !state->agents[config.agent]->started) {
+            mutex_unlock(&state->lock);
+            pr_alert("User requested to quiesce the siblings of agent %u that was not started\n", config.agent);
+            return -EINVAL;
         }
+        agent_state = state->agents[config.agent];
+        if(config.enable && agent_state->exited) {
+            mutex_unlock(&state->lock);
+            pr_alert("User requested to quiesce the siblings of agent %u that exited\n", config.agent);
+            return -EINVAL;
+        }
+        if(config.enable) {
+            config.parked = ch_agent_state_quiesce_siblings(agent_state);
+            pr_info("Parked %u SMT siblings of CPU %u\n", config.parked, agent_state->cpu);
+        } else {
+            ch_agent_state_release_siblings(agent_state);
+            config.parked = 0;
+        }
+        mutex_unlock(&state->lock);
+
+        if(copy_to_user((struct ch_ioc_quiesce_config*)argp, &config, sizeof(config))) {
+            /* The caller cannot tell that siblings were parked */
+            if(config.enable) {
+                mutex_lock(&state->lock);
+                ch_agent_state_release_siblings(agent_state);
+                mutex_unlock(&state->lock);
+            }
+            return -EFAULT;
+        }
+        return 0;
+    } else if(request == CH_IOC_AGENT_STATS) {
+        struct ch_ioc_agent_stats query;
 
-        agent_task = kthread_create(agent, state, CH_AGENT_NAME);
-        kthread_bind(agent_task, config.cpu);
-        if(!agent_task) {
-            pr_alert("Failed to create kthread on cpu\n");
-            return -EIO;
+        if(copy_from_user(&query, (struct ch_ioc_agent_stats*)argp, sizeof(query))) {
+            return -EFAULT;
         }
 
-        ch_state_get(state);
-        wake_up_process(agent_task);
+        mutex_lock(&state->lock);
+        if(query.agent >= state->agent_count) {
+            mutex_unlock(&state->lock);
+            pr_alert("User requested stats of agent %u that was not started\n", query.agent);
+            return -EINVAL;
+        }
+        memcpy(&query.stats, &state->agents[query.agent]->stats, sizeof(query.stats));
+        mutex_unlock(&state->lock);
 
+        if(copy_to_user((struct ch_ioc_agent_stats*)argp, &query, sizeof(query))) {
+            return -EFAULT;
+        }
         return 0;
     }
 
@@ -0,0 +1,827 @@
+#ifndef CH_AGENT_H
+#define CH_AGENT_H
+
+#include "ch_channel.h"
+#include "ch_ops.h"
+
+/*
+ * Interpreter of ring entries and programs shared by the kernel agent and
+ * the agent thread of userspace_agent_memory. The caller sets up the
+ * execution environment (pinning, isolation, counters) and then hands a
+ * populated ch_agent to ch_agent_run().
+ */
+
+#define CH_PRNG_DEFAULT_SEED 0x9E3779B97F4A7C15ULL
+#define CH_AGENT_CACHE_LEVELS 3
+#define CH_AGENT_RANDOM_DRAWS 64
+
+/*
+ * Lines [first_line, next range's first_line) of the regions start at base.
+ * Ranges are sorted by first_line; the first one starts at line 0.
+ */
+struct ch_line_range {
+    uintptr_t base;
+    uint64_t first_line;
+};
+
+/*
+ * The line ranges of all regions at the time they were published. A set is
+ * never modified once published and stays valid while the agent runs.
+ */
+struct ch_line_set {
+    const struct ch_line_range* ranges;
+    size_t range_count;
+    uint64_t lines;
+};
+
+struct ch_agent {
+    struct ch_channel* channels;
+    size_t channel_count;
+    size_t* active_channel; /* Updated with release semantics upon switches */
+
+    const uint64_t* ring;
+    uint64_t ring_mask;
+
+    struct ch_result* results;
+    uint64_t results_mask;
+    uint64_t results_index;
+
+    const uint64_t* program;
+    size_t program_entries;
+
+    /* Levels of classified accesses, see CH_OP_CLASSIFIED_ACCESS */
+    uint8_t* levels;
+    uint64_t levels_mask;
+    uint64_t levels_index;
+    struct ch_pmu_rule profile[CH_PMU_MAX_RULES];
+    unsigned profile_rules;
+    unsigned profile_pending; /* Rules still expected by CH_COMMAND_PMU_PROFILE */
+
+    /* Memory covered by CH_COMMAND_RANDOM_ACCESS, LINK and CHASE */
+    const struct ch_line_range* line_ranges;
+    size_t line_range_count;
+    uint64_t lines;
+    /* Newest set, written with release semantics, see CH_COMMAND_RELOAD_LINES */
+    const struct ch_line_set* const* published_lines;
+    unsigned offset_bits;
+    uint64_t prng_state;
+    const uint64_t* blacklist;
+    size_t blacklist_length;
+
+    /* Data cache geometry for CH_COMMAND_MAINTAIN_SETS/LEVEL */
+    unsigned cache_levels;
+    unsigned sets[CH_AGENT_CACHE_LEVELS];
+    unsigned ways[CH_AGENT_CACHE_LEVELS];
+
+    /* Programmable and fixed counters read around instrumented accesses */
+    unsigned counters;
+    unsigned fixed_counters;
+
+    /* CH_SERIALIZE_* profile and value of the last dependent access */
+    unsigned serialization;
+    uintptr_t dependency;
+
+    unsigned wait_policy;
+    struct ch_wait_stats wait_stats;
+    struct ch_agent_stats* stats;
+
+    /* Published along with each tail, see CH_COMMAND_INTERRUPT_GAP */
+    int smis; /* Whether MSR_SMI_COUNT is available */
+    uint64_t interrupt_gap;
+    uint64_t gap_interrupts;
+
+#ifndef __KERNEL__
+    /* Reads CH_RESULT_COUNTERS programmable counter values */
+    void (*read_counters)(void* context, uint64_t* values);
+    void* counters_context;
+#endif
+
+    unsigned long long invalid_entries;
+    unsigned long long cisw_counter
+                     , isw_counter
+                     , csw_counter;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+inline uint64_t _ch_agent_load(const uint64_t* entry) {
+#ifdef __KERNEL__
+    return READ_ONCE(*entry);
+#else
+    return *(const volatile uint64_t*)entry;
+#endif
+}
+
+inline uintptr_t _ch_agent_address(uint64_t entry) {
+#ifdef __KERNEL__
+    return ch_entry_address(entry);
+#else
+    return ch_entry_operand(entry);
+#endif
+}
+
+inline void _ch_agent_read_counters(struct ch_agent* agent, struct ch_result* values) {
+#ifdef __KERNEL__
+    unsigned i;
+    for(i = 0; i < agent->counters; i++) {
+        values->deltas[i] = ch_local_pmc_read(i);
+    }
+    for(i = 0; i < agent->fixed_counters; i++) {
+        values->fixed[i] = ch_local_pmc_read_fixed(i);
+    }
+#else
+    agent->read_counters(agent->counters_context, values->deltas);
+#endif
+}
+
+/*
+ * xorshift64*, the state must not be zero.
+ */
+inline uint64_t ch_prng_next(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+inline int ch_agent_blacklisted(struct ch_agent* agent, uintptr_t address) {
+    size_t low = 0, high = agent->blacklist_length, mid;
+    uint64_t entry;
+
+    while(low < high) {
+        mid = low + (high - low) / 2;
+        entry = _ch_agent_load(agent->blacklist + mid);
+        if(entry == address) {
+            return 1;
+        } else if(entry < address) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return 0;
+}
+
+inline uintptr_t _ch_agent_line_address(struct ch_agent* agent, uint64_t line) {
+    size_t low = 0, high = agent->line_range_count, mid;
+
+    /* Last range that starts at or before line */
+    while(high - low > 1) {
+        mid = low + (high - low) / 2;
+        if(agent->line_ranges[mid].first_line <= line) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return agent->line_ranges[low].base + ((line - agent->line_ranges[low].first_line) << agent->offset_bits);
+}
+
+/*
+ * Interrupts observed thus far, see struct ch_channel.
+ */
+inline uint64_t ch_agent_interrupts(const struct ch_agent* agent) {
+#ifdef __KERNEL__
+    return ch_local_interrupts(agent->smis) + agent->gap_interrupts;
+#else
+    return agent->gap_interrupts;
+#endif
+}
+
+inline unsigned ch_stats_bucket(uint64_t value) {
+    unsigned bucket = value ? 63 - __builtin_clzll(value) : 0;
+    return bucket < CH_STATS_BUCKETS ? bucket : CH_STATS_BUCKETS - 1;
+}
+
+/*
+ * Accounts for a cache maintenance operation that started at start.
+ */
+inline void _ch_agent_maintenance_done(struct ch_agent* agent, uint64_t start) {
+    agent->stats->maintenance++;
+    agent->stats->maintenance_cycles += ch_cycles() - start;
+}
+
+/*
+ * Waits for the preceding access as required by the serialization profile.
+ */
+inline void _ch_agent_access_fence(const struct ch_agent* agent) {
+    switch(agent->serialization) {
+    case CH_SERIALIZE_FENCE:
+        ch_op_fence_once();
+        return;
+    case CH_SERIALIZE_LOAD_FENCE:
+        ch_op_load_fence();
+        return;
+    case CH_SERIALIZE_DEPENDENCY:
+        return;
+    default:
+        ch_op_fence();
+    }
+}
+
+/*
+ * Waits for the preceding cache maintenance operation.
+ */
+inline void _ch_agent_maintenance_fence(const struct ch_agent* agent) {
+    if(agent->serialization == CH_SERIALIZE_STRICT) {
+        ch_op_fence();
+    } else {
+        ch_op_fence_once();
+    }
+}
+
+/*
+ * Serializes around the counter reads of instrumented accesses.
+ */
+inline void _ch_agent_serialize(const struct ch_agent* agent) {
+    if(agent->serialization <= CH_SERIALIZE_FENCE) {
+        ch_op_serialize();
+    } else {
+        ch_op_order();
+    }
+}
+
+inline void _ch_agent_access(struct ch_agent* agent, uintptr_t address) {
+    if(agent->serialization == CH_SERIALIZE_DEPENDENCY) {
+        agent->dependency = ch_op_access_dependent(address, agent->dependency);
+    } else {
+        ch_op_access(address);
+        _ch_agent_access_fence(agent);
+    }
+}
+
+/*
+ * Whether the line of the address lies within the memory covered by the
+ * line ranges.
+ */
+inline int ch_agent_owns(const struct ch_agent* agent, uintptr_t address) {
+    size_t i;
+    uint64_t end_line;
+
+    for(i = 0; i < agent->line_range_count; i++) {
+        end_line = i + 1 < agent->line_range_count ? agent->line_ranges[i + 1].first_line : agent->lines;
+        if(address >= agent->line_ranges[i].base
+           && ((address - agent->line_ranges[i].base) >> agent->offset_bits) < end_line - agent->line_ranges[i].first_line) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Adopts the line ranges published last, if any.
+ */
+inline void ch_agent_reload_lines(struct ch_agent* agent) {
+    const struct ch_line_set* lines;
+
+    if(!agent->published_lines) {
+        return;
+    }
+#ifdef __KERNEL__
+    lines = smp_load_acquire(agent->published_lines);
+#else
+    lines = __atomic_load_n(agent->published_lines, __ATOMIC_ACQUIRE);
+#endif
+    if(!lines) {
+        return;
+    }
+    agent->line_ranges = lines->ranges;
+    agent->line_range_count = lines->range_count;
+    agent->lines = lines->lines;
+}
+
+/*
+ * Links the lines of the chain into a cycle (see CH_COMMAND_LINK). The
+ * program area is writable by the user process, so every entry is loaded
+ * exactly once and only stored through once it was checked. A chain that
+ * fails the check stays linked up to the offending entry.
+ */
+inline int ch_agent_link(struct ch_agent* agent, const uint64_t* chain, size_t length) {
+    uintptr_t line_mask = ~(((uintptr_t)1 << agent->offset_bits) - 1);
+    uintptr_t first, previous, line;
+    size_t i;
+
+    first = _ch_agent_load(chain) & line_mask;
+    if(!ch_agent_owns(agent, first)) {
+        return 0;
+    }
+    previous = first;
+    for(i = 1; i < length; i++) {
+        line = _ch_agent_load(chain + i) & line_mask;
+        if(!ch_agent_owns(agent, line)) {
+            return 0;
+        }
+        *(volatile uintptr_t*)previous = line;
+        previous = line;
+    }
+    *(volatile uintptr_t*)previous = first;
+    return 1;
+}
+
+/*
+ * Follows hops pointers of a linked chain starting at its first line. The
+ * lines are writable by the user process, so every pointer is checked
+ * before it is dereferenced. Returns 0 if the chase stopped at a line that
+ * is not owned, a null pointer ends it regularly.
+ */
+inline int ch_agent_chase(struct ch_agent* agent, uintptr_t head, uint64_t hops) {
+    uintptr_t line_mask = ~(((uintptr_t)1 << agent->offset_bits) - 1);
+    uintptr_t address = head & line_mask;
+    int owned = 1;
+
+    while(hops-- && address) {
+        if(!ch_agent_owns(agent, address)) {
+            owned = 0;
+            break;
+        }
+        address = ch_op_chase(address) & line_mask;
+    }
+    _ch_agent_access_fence(agent);
+    return owned;
+}
+
+/*
+ * Draws lines until one is not blacklisted. The blacklist lies in the
+ * program area, which the user process may overwrite after it was checked
+ * (see CH_COMMAND_BLACKLIST), so after CH_AGENT_RANDOM_DRAWS draws the lines
+ * following the last one are scanned instead. Returns 0 if all lines are
+ * blacklisted.
+ */
+inline uintptr_t ch_agent_random_address(struct ch_agent* agent) {
+    uint64_t line = 0, i;
+    uintptr_t address;
+
+    for(i = 0; i < CH_AGENT_RANDOM_DRAWS; i++) {
+        line = ch_prng_next(&agent->prng_state) % agent->lines;
+        address = _ch_agent_line_address(agent, line);
+        if(!ch_agent_blacklisted(agent, address)) {
+            return address;
+        }
+    }
+
+    for(i = 1; i < agent->lines; i++) {
+        address = _ch_agent_line_address(agent, (line + i) % agent->lines);
+        if(!ch_agent_blacklisted(agent, address)) {
+            return address;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Whether entries [offset, offset + length) of the program area form a
+ * valid blacklist, i.e., strictly ascend and leave at least one line to be
+ * drawn. Each entry is loaded once.
+ */
+inline int ch_agent_valid_blacklist(struct ch_agent* agent, uint64_t offset, uint64_t length) {
+    uint64_t i, entry, previous = 0;
+
+    if(offset > agent->program_entries || length > agent->program_entries - offset || length >= agent->lines) {
+        return 0;
+    }
+    for(i = 0; i < length; i++) {
+        entry = _ch_agent_load(agent->program + offset + i);
+        if(i && entry <= previous) {
+            return 0;
+        }
+        previous = entry;
+    }
+    return 1;
+}
+
+/*
+ * Accesses the address and stores by how much the counters advanced during
+ * the access. The cycle counter is read innermost.
+ */
+inline void _ch_agent_measure_access(struct ch_agent* agent, uintptr_t address, struct ch_result* result) {
+    struct ch_result before = {0}, after = {0};
+    unsigned i;
+
+    _ch_agent_serialize(agent);
+    _ch_agent_read_counters(agent, &before);
+    _ch_agent_serialize(agent);
+    before.cycles = ch_op_timestamp();
+    _ch_agent_serialize(agent);
+    ch_op_access(address);
+#if defined(__x86_64__) || defined(_M_X64)
+    _ch_agent_access_fence(agent);
+#endif
+    _ch_agent_serialize(agent);
+    after.cycles = ch_op_timestamp();
+    _ch_agent_serialize(agent);
+    _ch_agent_read_counters(agent, &after);
+
+    result->cycles = after.cycles - before.cycles;
+    for(i = 0; i < CH_RESULT_FIXED_COUNTERS; i++) {
+        result->fixed[i] = after.fixed[i] - before.fixed[i];
+    }
+    for(i = 0; i < CH_RESULT_COUNTERS; i++) {
+        result->deltas[i] = after.deltas[i] - before.deltas[i];
+    }
+#if defined(__aarch64__) || defined(_M_ARM64)
+    _ch_agent_access_fence(agent);
+#endif
+
+    if(agent->interrupt_gap && result->cycles >= agent->interrupt_gap) {
+        agent->gap_interrupts++;
+    }
+}
+
+/*
+ * Stores the counter deltas of the access in the next result slot.
+ */
+inline void ch_agent_instrumented_access(struct ch_agent* agent, uintptr_t address) {
+    _ch_agent_measure_access(agent, address, agent->results + (agent->results_index++ & agent->results_mask));
+}
+
+/*
+ * Evaluates the PMU profile against the counter deltas of an access.
+ */
+inline uint8_t ch_agent_classify(const struct ch_agent* agent, const struct ch_result* result) {
+    const struct ch_pmu_rule* rule;
+
+    for(rule = agent->profile; rule < agent->profile + agent->profile_rules; rule++) {
+        if(rule->condition == CH_PMU_ALWAYS
+                || (rule->condition == CH_PMU_NONZERO && result->deltas[rule->counter])
+                || (rule->condition == CH_PMU_ZERO && !result->deltas[rule->counter])) {
+            return rule->level;
+        }
+    }
+    return CH_LEVEL_UNCLASSIFIED;
+}
+
+/*
+ * Stores the level of the access according to the PMU profile in the next
+ * byte of the levels area.
+ */
+inline void ch_agent_classified_access(struct ch_agent* agent, uintptr_t address) {
+    struct ch_result result;
+
+    _ch_agent_measure_access(agent, address, &result);
+    agent->levels[agent->levels_index++ & agent->levels_mask] = ch_agent_classify(agent, &result);
+}
+
+#if defined(__KERNEL__) && (defined(__aarch64__) || defined(_M_ARM64))
+/*
+ * Cleans and/or invalidates all ways of sets [first_set, end_set) of the
+ * level by set/way, encoded like the operands of CH_OP_CISW.
+ */
+inline void ch_agent_maintain_sets(struct ch_agent* agent, unsigned flags, unsigned level, uint64_t first_set, uint64_t end_set) {
+    unsigned way_bits = 0, way;
+    uint64_t set, set_way, lines = (end_set - first_set) * agent->ways[level];
+
+    while((1U << way_bits) < agent->ways[level]) {
+        way_bits++;
+    }
+
+    for(set = first_set; set < end_set; set++) {
+        for(way = 0; way < agent->ways[level]; way++) {
+            set_way = (level << 1) | (set << agent->offset_bits) | ((uint64_t)way << (32 - way_bits));
+            if(flags == (CH_MAINTAIN_CLEAN | CH_MAINTAIN_INVALIDATE)) {
+                ch_op_cisw(set_way);
+            } else if(flags == CH_MAINTAIN_CLEAN) {
+                ch_op_csw(set_way);
+            } else {
+                ch_op_isw(set_way);
+            }
+        }
+    }
+    _ch_agent_maintenance_fence(agent);
+
+    if(flags == (CH_MAINTAIN_CLEAN | CH_MAINTAIN_INVALIDATE)) {
+        agent->cisw_counter += lines;
+    } else if(flags == CH_MAINTAIN_CLEAN) {
+        agent->csw_counter += lines;
+    } else {
+        agent->isw_counter += lines;
+    }
+}
+#endif
+
+/*
+ * Executes an entry that is valid both in the ring and in programs.
+ * Privileged operations are skipped outside of the kernel.
+ */
+inline void ch_agent_execute(struct ch_agent* agent, uint64_t entry) {
+    uint64_t argument, i;
+#if defined(__KERNEL__)
+    uint64_t start;
+#endif
+
+    switch(ch_entry_op(entry)) {
+    case CH_OP_ACCESS:
+        _ch_agent_access(agent, _ch_agent_address(entry));
+        return;
+
+    case CH_OP_INSTRUMENTED_ACCESS:
+        ch_agent_instrumented_access(agent, _ch_agent_address(entry));
+        return;
+
+    case CH_OP_CLASSIFIED_ACCESS:
+        ch_agent_classified_access(agent, _ch_agent_address(entry));
+        return;
+
+#if defined(__x86_64__) || defined(_M_X64)
+    case CH_OP_CLFLUSH:
+        ch_op_clflush(_ch_agent_address(entry));
+        _ch_agent_maintenance_fence(agent);
+        return;
+#elif defined(__KERNEL__) && (defined(__aarch64__) || defined(_M_ARM64))
+    case CH_OP_CISW:
+        start = ch_cycles();
+        ch_op_cisw(ch_entry_operand(entry));
+        _ch_agent_maintenance_fence(agent);
+        _ch_agent_maintenance_done(agent, start);
+        agent->cisw_counter++;
+        return;
+
+    case CH_OP_CSW:
+        start = ch_cycles();
+        ch_op_csw(ch_entry_operand(entry));
+        _ch_agent_maintenance_fence(agent);
+        _ch_agent_maintenance_done(agent, start);
+        agent->csw_counter++;
+        return;
+
+    case CH_OP_ISW:
+        start = ch_cycles();
+        ch_op_isw(ch_entry_operand(entry));
+        _ch_agent_maintenance_fence(agent);
+        _ch_agent_maintenance_done(agent, start);
+        agent->isw_counter++;
+        return;
+#endif
+
+    case CH_OP_COMMAND:
+        argument = ch_entry_operand(entry) >> CH_COMMAND_SHIFT;
+
+        switch(entry & CH_COMMAND_MASK) {
+#if defined(__KERNEL__) && (defined(__x86_64__) || defined(_M_X64))
+        case CH_COMMAND_WBINVD:
+            start = ch_cycles();
+            ch_op_wbinvd();
+            _ch_agent_maintenance_fence(agent);
+            _ch_agent_maintenance_done(agent, start);
+            return;
+#endif
+
+        case CH_COMMAND_SEED:
+            agent->prng_state = argument ? argument : CH_PRNG_DEFAULT_SEED;
+            return;
+
+        case CH_COMMAND_RANDOM_ACCESS:
+            if(!agent->lines || argument > CH_RANDOM_ACCESS_MAX) {
+                break;
+            }
+            for(i = 0; i < argument; i++) {
+                uintptr_t address = ch_agent_random_address(agent);
+                if(!address) {
+                    break;
+                }
+                _ch_agent_access(agent, address);
+            }
+            if(i < argument) {
+                /* The blacklist was overwritten to cover all lines */
+                break;
+            }
+            return;
+
+        case CH_COMMAND_BLACKLIST: {
+            uint64_t offset = argument & CH_COMMAND_FIELD_MASK
+                   , length = argument >> CH_COMMAND_FIELD_BITS;
+            if(!ch_agent_valid_blacklist(agent, offset, length)) {
+                break;
+            }
+            agent->blacklist = agent->program + offset;
+            agent->blacklist_length = length;
+            return;
+        }
+
+        case CH_COMMAND_PMU_PROFILE:
+            if(argument > CH_PMU_MAX_RULES) {
+                break;
+            }
+            agent->profile_rules = 0;
+            agent->profile_pending = argument;
+            return;
+
+        case CH_COMMAND_PMU_RULE: {
+            struct ch_pmu_rule rule = {
+                .counter = (uint8_t)(argument & 0xFF),
+                .condition = (uint8_t)((argument >> 8) & 0xFF),
+                .level = (uint8_t)((argument >> 16) & 0xFF)
+            };
+            if(!agent->profile_pending || rule.counter >= CH_RESULT_COUNTERS || rule.condition >= NR_CH_PMU_CONDITIONS) {
+                break;
+            }
+            agent->profile[agent->profile_rules++] = rule;
+            agent->profile_pending--;
+            return;
+        }
+
+        case CH_COMMAND_LINK: {
+            uint64_t offset = argument & CH_COMMAND_FIELD_MASK
+                   , length = argument >> CH_COMMAND_FIELD_BITS;
+            if(!length || offset > agent->program_entries || length > agent->program_entries - offset
+               || !ch_agent_link(agent, agent->program + offset, length)) {
+                break;
+            }
+            return;
+        }
+
+        case CH_COMMAND_CHASE: {
+            uint64_t offset = argument & CH_COMMAND_FIELD_MASK
+                   , hops = argument >> CH_COMMAND_FIELD_BITS;
+            uintptr_t head;
+            if(offset >= agent->program_entries) {
+                break;
+            }
+            head = _ch_agent_load(agent->program + offset);
+            if(!ch_agent_chase(agent, head, hops)) {
+                break;
+            }
+            return;
+        }
+
+#if defined(__KERNEL__) && (defined(__aarch64__) || defined(_M_ARM64))
+        case CH_COMMAND_MAINTAIN_SETS:
+        case CH_COMMAND_MAINTAIN_LEVEL: {
+            uint64_t first_set = argument & CH_COMMAND_FIELD_MASK
+                   , fields = argument >> CH_COMMAND_FIELD_BITS
+                   , end_set = fields & CH_COMMAND_FIELD_MASK;
+            unsigned level = (fields >> CH_MAINTAIN_LEVEL_SHIFT) & 0x3
+                   , flags = (fields >> CH_MAINTAIN_FLAGS_SHIFT) & 0x3;
+            if(level >= agent->cache_levels || !flags) {
+                break;
+            }
+            if((entry & CH_COMMAND_MASK) == CH_COMMAND_MAINTAIN_LEVEL) {
+                first_set = 0;
+                end_set = agent->sets[level];
+            }
+            if(first_set > end_set || end_set > agent->sets[level]) {
+                break;
+            }
+            start = ch_cycles();
+            ch_agent_maintain_sets(agent, flags, level, first_set, end_set);
+            _ch_agent_maintenance_done(agent, start);
+            return;
+        }
+#endif
+
+        case CH_COMMAND_SERIALIZATION:
+            if(argument >= NR_CH_SERIALIZE) {
+                break;
+            }
+            agent->serialization = argument;
+            return;
+
+        case CH_COMMAND_INTERRUPT_GAP:
+            agent->interrupt_gap = argument;
+            return;
+
+        case CH_COMMAND_BARRIER:
+            ch_op_fence();
+            ch_op_serialize();
+            return;
+
+        case CH_COMMAND_RELOAD_LINES:
+            ch_agent_reload_lines(agent);
+            return;
+
+        case CH_COMMAND_SKIP_RESULTS:
+            agent->results_index += argument & CH_COMMAND_FIELD_MASK;
+            agent->levels_index += argument >> CH_COMMAND_FIELD_BITS;
+            return;
+        }
+        break;
+    }
+
+    agent->invalid_entries++;
+}
+
+/*
+ * Interprets entries [offset, offset + length) of the program area.
+ */
+inline void ch_agent_run_program(struct ch_agent* agent, uint64_t offset, uint64_t length) {
+    const uint64_t *pc, *end, *body;
+    uint64_t entry, argument, body_length, repetitions;
+
+    if(offset > agent->program_entries || length > agent->program_entries - offset) {
+        agent->invalid_entries++;
+        return;
+    }
+
+    for(pc = agent->program + offset, end = pc + length; pc < end; pc++) {
+        entry = _ch_agent_load(pc);
+
+        if(ch_entry_op(entry) == CH_OP_COMMAND && (entry & CH_COMMAND_MASK) == CH_COMMAND_REPEAT) {
+            argument = ch_entry_operand(entry) >> CH_COMMAND_SHIFT;
+            body_length = argument & CH_COMMAND_FIELD_MASK;
+            repetitions = argument >> CH_COMMAND_FIELD_BITS;
+            if(body_length > (uint64_t)(end - pc - 1) || repetitions > CH_REPEAT_MAX) {
+                agent->invalid_entries++;
+                return;
+            }
+
+            for(; repetitions; repetitions--) {
+                for(body = pc + 1; body <= pc + body_length; body++) {
+                    ch_agent_execute(agent, _ch_agent_load(body));
+                }
+            }
+            pc += body_length;
+        } else {
+            ch_agent_execute(agent, entry);
+        }
+    }
+}
+
+/*
+ * Drains the ring of the active channel until a CH_COMMAND_EXIT arrives.
+ */
+inline void ch_agent_run(struct ch_agent* agent) {
+    struct ch_channel* channel = agent->channels + *agent->active_channel;
+    uint64_t head, tail = ch_channel_read_tail(channel), entry, argument, first, start, end;
+
+    for(;;) {
+        /* Wait for new submissions (acquire semantics) */
+        end = ch_cycles();
+        head = ch_channel_wait_for_head(channel, tail, agent->wait_policy, &agent->wait_stats);
+        start = ch_cycles();
+        agent->stats->idle_cycles += start - end;
+        first = tail;
+
+        /* Drain everything submitted thus far */
+        for(; tail != head; tail++) {
+            entry = _ch_agent_load(agent->ring + (tail & agent->ring_mask));
+
+            if(ch_entry_op(entry) == CH_OP_COMMAND) {
+                argument = ch_entry_operand(entry) >> CH_COMMAND_SHIFT;
+
+                switch(entry & CH_COMMAND_MASK) {
+                case CH_COMMAND_EXIT:
+                    ch_channel_publish_tail(channel, tail + 1);
+                    return;
+
+                case CH_COMMAND_SWITCH_CHANNEL:
+                    if(argument >= agent->channel_count) {
+                        agent->invalid_entries++;
+                        continue;
+                    }
+                    /* Put switched-out channel into idle, the new channel takes over from here */
+                    end = ch_cycles();
+                    channel->interrupts = ch_agent_interrupts(agent);
+                    ch_channel_publish_tail(channel, tail + 1);
+                    channel = agent->channels + argument;
+#ifdef __KERNEL__
+                    smp_store_release(agent->active_channel, argument);
+#else
+                    __atomic_store_n(agent->active_channel, argument, __ATOMIC_RELEASE);
+#endif
+                    agent->stats->channel_switches++;
+                    agent->stats->channel_switch_cycles += ch_cycles() - end;
+                    continue;
+
+                case CH_COMMAND_RUN_PROGRAM:
+                    ch_agent_run_program(agent, argument & CH_COMMAND_FIELD_MASK, argument >> CH_COMMAND_FIELD_BITS);
+                    continue;
+
+                case CH_COMMAND_SKIP:
+                    /* Never past the entries published thus far */
+                    if(argument >= head - tail) {
+                        agent->invalid_entries++;
+                        continue;
+                    }
+                    tail += argument;
+                    continue;
+                }
+            }
+
+            ch_agent_execute(agent, entry);
+        }
+
+        /* Account for the batch before its completion publishes the stats */
+        end = ch_cycles();
+        agent->stats->batches++;
+        agent->stats->batch_entries += tail - first;
+        agent->stats->batch_cycles += end - start;
+        agent->stats->batch_sizes[ch_stats_bucket(tail - first)]++;
+        agent->stats->round_trip_cycles[ch_stats_bucket(end - _ch_channel_read_head_timestamp(channel))]++;
+        agent->stats->invalid_entries = agent->invalid_entries;
+
+        /* Report completion (release semantics) */
+        channel->agent_wait = agent->wait_stats;
+        channel->interrupts = ch_agent_interrupts(agent);
+        ch_channel_publish_tail(channel, tail);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CH_AGENT_H */
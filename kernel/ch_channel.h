@@ -4,40 +4,339 @@
 #ifdef __KERNEL__
 #    include <linux/types.h>
 #    include <linux/atomic.h>
+#    include <linux/delay.h>
 #    include <linux/string.h>
 #else
 #    include <stdint.h>
 #    include <stddef.h>
+#    include <time.h>
 #    include <atomic>
-#    include <sched.h>
 #    include <cassert>
 #endif
 
+#define CH_CACHE_LINE_SIZE 64
+
+/*
+ * The submission ring spans 2^CH_RING_ORDER pages and is mapped into the
+ * user process at page offset CH_MMAP_RING_PGOFF of the device (the channels
+ * page lives at offset 0).
+ */
+#define CH_RING_ORDER      3
+#define CH_MMAP_RING_PGOFF 1
+
+/*
+ * The results area spans 2^CH_RESULTS_ORDER pages and follows the ring in
+ * the device mapping. The agent stores the outcome of the n-th instrumented
+ * access in slot n % result_entries.
+ */
+#define CH_RESULTS_ORDER      4
+#define CH_MMAP_RESULTS_PGOFF (CH_MMAP_RING_PGOFF + (1 << CH_RING_ORDER))
+
+/*
+ * The program area spans 2^CH_PROGRAM_ORDER pages and follows the results
+ * in the device mapping. It holds entries that the agent interprets upon a
+ * CH_COMMAND_RUN_PROGRAM, i.e., a recurring sequence is uploaded once and
+ * then executed by a single ring entry.
+ */
+#define CH_PROGRAM_ORDER      3
+#define CH_MMAP_PROGRAM_PGOFF (CH_MMAP_RESULTS_PGOFF + (1 << CH_RESULTS_ORDER))
+
+/*
+ * The levels area spans 2^CH_LEVELS_ORDER pages and follows the program
+ * area in the device mapping. The agent stores the level of the n-th
+ * classified access (see CH_OP_CLASSIFIED_ACCESS) in byte n % level_entries.
+ */
+#define CH_LEVELS_ORDER      2
+#define CH_MMAP_LEVELS_PGOFF (CH_MMAP_PROGRAM_PGOFF + (1 << CH_PROGRAM_ORDER))
+
+/*
+ * Every agent started on an open device has its own channels, ring, results,
+ * program and levels area. The offsets above are relative to the first page
+ * of the agent's block, i.e., the first agent uses them as they are.
+ */
+#define CH_MAX_AGENTS              16
+#define CH_MMAP_AGENT_PAGES        (CH_MMAP_LEVELS_PGOFF + (1 << CH_LEVELS_ORDER))
+#define CH_MMAP_AGENT_PGOFF(agent) ((agent) * CH_MMAP_AGENT_PAGES)
+
+/*
+ * Every ring entry is a 64-bit word. The upper four bits select the
+ * operation, the lower 60 bits hold the operand. Kernel virtual addresses
+ * have their upper bits set, i.e., a plain address is a regular access.
+ * The agent restores the upper bits of address operands before use.
+ */
+#define CH_OP_SHIFT 60
+#define CH_OP_MASK  (0xFULL << CH_OP_SHIFT)
+
 enum {
-    _CH_CHANNEL_IDLE   = 0,
-    _CH_CHANNEL_ACCESS = 1,
+    CH_OP_CISW                = 0x0, /* ARMv8 only, operand: set/way */
+    CH_OP_COMMAND             = 0x1, /* operand: command (lowest byte) and argument */
+    CH_OP_CSW                 = 0x4, /* ARMv8 only, operand: set/way */
+    CH_OP_CLFLUSH             = 0x7, /* x86 only, operand: address */
+    CH_OP_ISW                 = 0x8, /* ARMv8 only, operand: set/way */
+    CH_OP_CLASSIFIED_ACCESS   = 0xD, /* operand: address */
+    CH_OP_INSTRUMENTED_ACCESS = 0xE, /* operand: address */
+    CH_OP_ACCESS              = 0xF, /* operand: address */
 };
 
+#define CH_COMMAND_SHIFT 8
+#define CH_COMMAND_MASK  ((1ULL << CH_COMMAND_SHIFT) - 1)
+
+enum {
+    CH_COMMAND_EXIT           = 0,
+    CH_COMMAND_SWITCH_CHANNEL = 1, /* argument: new channel */
+    CH_COMMAND_WBINVD         = 2, /* x86 only */
+    CH_COMMAND_RUN_PROGRAM    = 3, /* ring only, argument: program offset and length */
+    CH_COMMAND_REPEAT         = 4, /* programs only, argument: body length and repetitions */
+    CH_COMMAND_SEED           = 5, /* argument: seed of the agent's PRNG */
+    CH_COMMAND_RANDOM_ACCESS  = 6, /* argument: number of accesses to random lines of the regions */
+    CH_COMMAND_BARRIER        = 7,
+    CH_COMMAND_BLACKLIST      = 8, /* argument: offset and length of the blacklist in the program area */
+    CH_COMMAND_PMU_PROFILE    = 9, /* argument: number of CH_COMMAND_PMU_RULE entries that follow */
+    CH_COMMAND_PMU_RULE       = 10, /* argument: counter, condition and level (one byte each) */
+    CH_COMMAND_MAINTAIN_SETS  = 11, /* ARMv8 only, argument: first and end set, level and CH_MAINTAIN_* flags */
+    CH_COMMAND_MAINTAIN_LEVEL = 12, /* ARMv8 only, argument: level and CH_MAINTAIN_* flags */
+    CH_COMMAND_LINK           = 13, /* argument: offset and length of a chain in the program area */
+    CH_COMMAND_CHASE          = 14, /* argument: offset of a linked chain in the program area and number of hops */
+    CH_COMMAND_SERIALIZATION  = 15, /* argument: CH_SERIALIZE_* profile */
+    CH_COMMAND_INTERRUPT_GAP  = 16, /* argument: cycles of an instrumented access that count as an interrupt (0 disables) */
+    CH_COMMAND_RELOAD_LINES   = 17, /* adopts the lines of regions added since the agent's start */
+    CH_COMMAND_SKIP           = 18, /* ring only, argument: number of the following entries to pass over unread */
+    CH_COMMAND_SKIP_RESULTS   = 19, /* argument: number of result slots and level bytes to leave untouched */
+};
+
+/*
+ * Commands with two arguments pack them into two fields, the first one
+ * occupying the lower bits. A repeated body consists of the entries that
+ * follow the CH_COMMAND_REPEAT and must not contain further repetitions.
+ * The blacklist consists of strictly ascending line addresses, fewer than
+ * the lines of the regions, that are excluded from CH_COMMAND_RANDOM_ACCESS;
+ * it must not be modified while in use. A single command performs at most
+ * CH_RANDOM_ACCESS_MAX random accesses or CH_REPEAT_MAX repetitions.
+ * The skip commands keep the agent off lines of the ring, results and
+ * levels that would collide with the sets under test; the skipped entries
+ * must have been published together with the CH_COMMAND_SKIP.
+ */
+#define CH_COMMAND_FIELD_BITS 24
+#define CH_COMMAND_FIELD_MASK ((1ULL << CH_COMMAND_FIELD_BITS) - 1)
+#define CH_RANDOM_ACCESS_MAX  (1ULL << 24)
+#define CH_REPEAT_MAX         (1ULL << 20)
+
+/*
+ * Serialization profiles trade the stability of measurements for agent
+ * throughput. They determine how the agent waits for each access and cache
+ * maintenance operation and how it serializes around the counter reads of
+ * instrumented accesses:
+ *
+ * - CH_SERIALIZE_STRICT: 32 full fences, serializing instructions around
+ *   the counters (default)
+ * - CH_SERIALIZE_FENCE: a single full fence
+ * - CH_SERIALIZE_LOAD_FENCE: a load fence (lfence, DSB LD) after accesses,
+ *   ordering instructions (lfence, ISB) around the counters
+ * - CH_SERIALIZE_DEPENDENCY: no fence after accesses, each one depends on
+ *   the value loaded by its predecessor instead, ordering instructions
+ *   around the counters
+ *
+ * Cache maintenance is followed by a single full fence in all but the
+ * strict profile.
+ */
+enum {
+    CH_SERIALIZE_STRICT     = 0,
+    CH_SERIALIZE_FENCE      = 1,
+    CH_SERIALIZE_LOAD_FENCE = 2,
+    CH_SERIALIZE_DEPENDENCY = 3,
+    NR_CH_SERIALIZE
+};
+
+/*
+ * A chain is a sequence of line addresses in the program area. Linking it
+ * makes the agent store the address of each line at the start of its
+ * predecessor, the last line pointing back to the first. Chasing it then
+ * accesses its lines by dependent loads starting at the first one, i.e.,
+ * without a ring entry per line. Lines that were never linked hold a null
+ * pointer, which ends a chase.
+ */
+
+/*
+ * Set/way maintenance of all ways of sets [first, end) of a cache level,
+ * or of the entire level, executed by the agent instead of one DC CISW,
+ * CSW or ISW entry per line. The level and flags are packed above the end
+ * set in the second field (see ch_maintenance_fields()).
+ */
+enum {
+    CH_MAINTAIN_CLEAN      = 1,
+    CH_MAINTAIN_INVALIDATE = 2
+};
+
+#define CH_MAINTAIN_LEVEL_SHIFT CH_COMMAND_FIELD_BITS
+#define CH_MAINTAIN_FLAGS_SHIFT (CH_MAINTAIN_LEVEL_SHIFT + 2)
+
+/*
+ * A PMU profile lets the agent classify instrumented accesses itself: its
+ * rules are evaluated in order against the programmable counter deltas and
+ * the first one that matches yields the level of the access. A profile of
+ * hit-counting events maps a nonzero delta to the level of the event, one
+ * of miss-counting events maps it to the level below, and a final
+ * CH_PMU_ALWAYS rule covers accesses that no counter observed.
+ */
+enum {
+    CH_PMU_NONZERO = 0,
+    CH_PMU_ZERO    = 1,
+    CH_PMU_ALWAYS  = 2,
+    NR_CH_PMU_CONDITIONS
+};
+
+#define CH_PMU_MAX_RULES      (2 * CH_RESULT_COUNTERS)
+#define CH_LEVEL_UNCLASSIFIED 0xFF /* No rule matched or no profile was uploaded */
+
+struct ch_pmu_rule {
+    uint8_t counter;
+    uint8_t condition;
+    uint8_t level;
+};
+
+/*
+ * Policies for waiting on the other side of a channel.
+ */
+enum {
+    CH_WAIT_SPIN    = 0, /* Polling with exponential pause backoff */
+    CH_WAIT_MONITOR = 1, /* umonitor/umwait (x86 with WAITPKG) or LDXR/WFE (ARMv8) */
+    CH_WAIT_SLEEP   = 2, /* Polling, then sleeping when idle for long (must not be used in atomic context) */
+    NR_CH_WAIT_POLICIES
+};
+
+#define CH_WAIT_MAX_BACKOFF_SHIFT 6      /* At most 2^6 pauses between polls */
+#define CH_WAIT_SLEEP_POLLS       256    /* Polls before CH_WAIT_SLEEP starts sleeping */
+#define CH_WAIT_SLEEP_US          50
+#define CH_WAIT_UMWAIT_CYCLES     100000 /* Upper bound of a single umwait */
+
+/*
+ * Collected by a waiting side. Latencies are measured in cycles from the
+ * publication of an index until the waiter observed it and only for waits
+ * that did not succeed on the first poll.
+ */
+struct ch_wait_stats {
+    uint64_t waits;
+    uint64_t sleeps; /* Polls that slept, umwaited or executed WFE */
+    uint64_t latency_sum;
+    uint64_t latency_max;
+};
+
+/*
+ * Where the agent spends its time, in ch_cycles(). Batches are the entries
+ * drained after each wait for submissions; their execution includes cache
+ * maintenance and channel switches. Round trips last from the submission
+ * of the last entry of a batch to the completion of the batch. Histogram
+ * bucket i counts values in [2^i, 2^(i + 1)), bucket 0 includes 0 and the
+ * last bucket all larger values.
+ */
+#define CH_STATS_BUCKETS 32
+
+struct ch_agent_stats {
+    uint64_t idle_cycles;
+    uint64_t batches;
+    uint64_t batch_entries;
+    uint64_t batch_cycles;
+    uint64_t maintenance; /* wbinvd and DC CISW/CSW/ISW, set/level maintenance counts once */
+    uint64_t maintenance_cycles;
+    uint64_t channel_switches;
+    uint64_t channel_switch_cycles;
+    uint64_t batch_sizes[CH_STATS_BUCKETS];
+    uint64_t round_trip_cycles[CH_STATS_BUCKETS];
+    uint64_t invalid_entries; /* Skipped, e.g., chains with lines outside the regions */
+};
+
+/*
+ * A channel consists of two cache lines: the first one is written by the
+ * user process only (head), the second one by the agent only (tail and its
+ * wait statistics). Both indices grow monotonically; the ring slot of index
+ * i is i % ring_entries. The timestamps record when an index was published.
+ *
+ * Along with each tail the agent publishes how many interrupts its CPU took
+ * thus far (IRQs, NMIs and SMIs in the kernel, plus instrumented accesses
+ * that exceeded the interrupt gap). Results completed between two tails are
+ * contaminated if the count differs.
+ */
 struct ch_channel {
-    // least-significant bit: IDLE/ACCESS
-    // higher bits: size
 #ifdef __KERNEL__
-    atomic64_t control;
+    atomic64_t head;
+    uint64_t head_timestamp;
+#else
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> head_timestamp;
+#endif
+    uint64_t _head_padding[CH_CACHE_LINE_SIZE / sizeof(uint64_t) - 2];
+
+#ifdef __KERNEL__
+    atomic64_t tail;
+    uint64_t tail_timestamp;
 #else
-    std::atomic<uint64_t> control;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> tail_timestamp;
 #endif
-    uintptr_t data[7];
+    struct ch_wait_stats agent_wait;
+    uint64_t interrupts;
+    uint64_t _tail_padding[CH_CACHE_LINE_SIZE / sizeof(uint64_t) - 3 - sizeof(struct ch_wait_stats) / sizeof(uint64_t)];
+};
+
+/*
+ * Upper bounds of the programmable and fixed counters an agent reads. The
+ * agent reports how many of them the CPU actually provides, the remaining
+ * deltas are zero.
+ */
+#define CH_RESULT_COUNTERS       8
+#define CH_RESULT_FIXED_COUNTERS 3
+
+/*
+ * Counter deltas (after - before) observed around an instrumented access.
+ * The cycles are read closest to the access, i.e., they measure its latency
+ * (TSC on x86, PMCCNTR_EL0 on arm64).
+ */
+struct ch_result {
+    uint64_t cycles;
+    uint64_t fixed[CH_RESULT_FIXED_COUNTERS];
+    uint64_t deltas[CH_RESULT_COUNTERS];
+    uint64_t _padding[4];
 };
 #ifdef __cplusplus
-    static_assert(sizeof(ch_channel) <= 64, "Channel must fit into a cache line");
+    static_assert(sizeof(ch_channel) == 2 * CH_CACHE_LINE_SIZE, "Channel must span exactly two cache lines");
+    static_assert(offsetof(ch_channel, tail) == CH_CACHE_LINE_SIZE, "Head and tail must reside on separate cache lines");
+    static_assert(sizeof(ch_result) % CH_CACHE_LINE_SIZE == 0, "Results must occupy whole cache lines");
 
 extern "C" {
 #endif
 
-#ifdef __KERNEL__
-inline void ch_channel_init(struct ch_channel* ch) {
-    memset(ch->data, 0, sizeof(ch->data));
-    atomic64_set(&ch->control, _CH_CHANNEL_IDLE);
+inline uint64_t ch_entry(uint64_t op, uint64_t operand) {
+    return (op << CH_OP_SHIFT) | (operand & ~CH_OP_MASK);
+}
+
+inline uint64_t ch_command_entry(uint64_t command, uint64_t argument) {
+    return ch_entry(CH_OP_COMMAND, (argument << CH_COMMAND_SHIFT) | command);
+}
+
+inline uint64_t ch_command_fields(uint64_t first, uint64_t second) {
+    return (first & CH_COMMAND_FIELD_MASK) | (second << CH_COMMAND_FIELD_BITS);
+}
+
+inline uint64_t ch_pmu_rule_fields(unsigned counter, unsigned condition, unsigned level) {
+    return (counter & 0xFF) | ((condition & 0xFF) << 8) | ((uint64_t)(level & 0xFF) << 16);
+}
+
+inline uint64_t ch_maintenance_fields(unsigned flags, unsigned level, uint64_t first_set, uint64_t end_set) {
+    return ch_command_fields(first_set, (end_set & CH_COMMAND_FIELD_MASK)
+                                      | ((uint64_t)(level & 0x3) << CH_MAINTAIN_LEVEL_SHIFT)
+                                      | ((uint64_t)(flags & 0x3) << CH_MAINTAIN_FLAGS_SHIFT));
+}
+
+inline unsigned ch_entry_op(uint64_t entry) {
+    return entry >> CH_OP_SHIFT;
+}
+
+inline uint64_t ch_entry_operand(uint64_t entry) {
+    return entry & ~CH_OP_MASK;
+}
+
+inline uintptr_t ch_entry_address(uint64_t entry) {
+    return entry | CH_OP_MASK;
 }
 
 inline void _ch_pause(void)
@@ -50,81 +349,251 @@ inline void _ch_pause(void)
         asm volatile ("isb sy");
     }
 #else
-    ;
+    {}
 #endif
 
-inline void _ch_channel_terminate(struct ch_channel* ch) {
-    while(atomic64_cmpxchg(&ch->control, _CH_CHANNEL_IDLE, _CH_CHANNEL_ACCESS) != _CH_CHANNEL_IDLE) {
-#ifdef __KERNEL__
-        _ch_pause();
+/*
+ * Reads a cycle counter that is synchronized across cores.
+ */
+inline uint64_t ch_cycles(void)
+#if defined(__x86_64__) || defined(_M_X64)
+    {
+        uint32_t low, high;
+        asm volatile ("rdtsc" : "=a"(low), "=d"(high));
+        return ((uint64_t)high << 32) | low;
+    }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    {
+        uint64_t cycles;
+        asm volatile ("isb sy\n"
+                      "mrs %[cycles], cntvct_el0" : [cycles] "=r"(cycles) :: "memory");
+        return cycles;
+    }
 #else
-        sched_yield();
+    {
+        return 0;
+    }
+#endif
+
+inline int ch_wait_policy_supported(unsigned policy) {
+    if(policy == CH_WAIT_MONITOR) {
+#if defined(__x86_64__) || defined(_M_X64)
+        /* CPUID.(EAX=07H, ECX=0H):ECX.WAITPKG[bit 5] */
+        uint32_t eax = 7, ebx, ecx = 0, edx;
+        asm volatile ("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+        return (ecx >> 5) & 1;
+#elif defined(__aarch64__) || defined(_M_ARM64)
+        return 1;
+#else
+        return 0;
 #endif
     }
+    return policy < NR_CH_WAIT_POLICIES;
+}
+
+inline void _ch_backoff(unsigned polls) {
+    unsigned i, pauses = 1u << (polls < CH_WAIT_MAX_BACKOFF_SHIFT ? polls : CH_WAIT_MAX_BACKOFF_SHIFT);
+    for(i = 0; i < pauses; i++) {
+        _ch_pause();
+    }
 }
 
+/*
+ * Waits until the index at address is written (or a timeout/event occurs)
+ * in case it still holds the value seen.
+ */
+inline void _ch_monitor_wait(const volatile uint64_t* address, uint64_t seen)
+#if defined(__x86_64__) || defined(_M_X64)
+    {
+        uint64_t deadline;
+
+        /* umonitor %rax */
+        asm volatile (".byte 0xf3, 0x0f, 0xae, 0xf0" :: "a"(address) : "memory");
+        if(*address != seen)
+            return;
+
+        /* umwait %ecx, requesting the faster-waking C0.1 state */
+        deadline = ch_cycles() + CH_WAIT_UMWAIT_CYCLES;
+        asm volatile (".byte 0xf2, 0x0f, 0xae, 0xf1"
+                      :: "c"(1), "a"((uint32_t)deadline), "d"((uint32_t)(deadline >> 32)) : "cc", "memory");
+    }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    {
+        /* Arms the exclusive monitor, a store to the index sends the wake-up event */
+        uint64_t value;
+        asm volatile ("ldxr %[value], [%[address]]" : [value] "=&r"(value) : [address] "r"(address) : "memory");
+        if(value == seen) {
+            asm volatile ("wfe" ::: "memory");
+        }
+    }
+#else
+    {
+        _ch_pause();
+    }
 #endif
 
-inline uint64_t _ch_channel_read_control(
-    struct ch_channel* ch,
-    size_t* count /* Only valid in the case of ACCESS */
-) {
-    uint64_t control;
+inline void _ch_sleep(void) {
 #ifdef __KERNEL__
-    control = atomic64_read_acquire(&ch->control);
+    usleep_range(CH_WAIT_SLEEP_US, 2 * CH_WAIT_SLEEP_US);
 #else
-    control = ch->control.load(std::memory_order_acquire);
+    struct timespec duration = { 0, CH_WAIT_SLEEP_US * 1000 };
+    nanosleep(&duration, NULL);
 #endif
-    if(count) {
-        *count = (control >> 1) & 0b111;
+}
+
+/*
+ * Called after the polls-th unsuccessful poll of the index at address.
+ */
+inline void _ch_wait_step(unsigned policy, const volatile uint64_t* address, uint64_t seen, unsigned polls, struct ch_wait_stats* stats) {
+    switch(policy) {
+    case CH_WAIT_MONITOR:
+        _ch_monitor_wait(address, seen);
+        stats->sleeps++;
+        break;
+    case CH_WAIT_SLEEP:
+        if(polls >= CH_WAIT_SLEEP_POLLS) {
+            _ch_sleep();
+            stats->sleeps++;
+            break;
+        }
+        /* fallthrough */
+    default:
+        _ch_backoff(polls);
+        break;
     }
-    return control&1;
 }
 
-inline size_t _ch_channel_spin(
-    struct ch_channel* ch,
-    uint64_t desired
-) {
-    size_t count;
-    while(_ch_channel_read_control(ch, &count) != desired) {
+inline void _ch_wait_done(unsigned polls, uint64_t timestamp, struct ch_wait_stats* stats) {
+    int64_t latency;
+
+    if(polls == 0)
+        return;
+
+    latency = (int64_t)(ch_cycles() - timestamp);
+    if(latency < 0)
+        latency = 0;
+
+    stats->waits++;
+    stats->latency_sum += latency;
+    if((uint64_t)latency > stats->latency_max)
+        stats->latency_max = latency;
+}
+
+inline const volatile uint64_t* _ch_channel_head_address(struct ch_channel* ch) {
 #ifdef __KERNEL__
-        _ch_pause();
+    return (const volatile uint64_t*)&ch->head.counter;
 #else
-        sched_yield();
+    return reinterpret_cast<const volatile uint64_t*>(&ch->head);
 #endif
-    }
-    return count;
 }
 
-inline void _ch_channel_write_control(
-    struct ch_channel* ch,
-    uint64_t control,
-    size_t count /* only in the case of ACCESS */
-) {
+inline const volatile uint64_t* _ch_channel_tail_address(struct ch_channel* ch) {
 #ifdef __KERNEL__
-    atomic64_set_release(&ch->control, control|(count << 1));
+    return (const volatile uint64_t*)&ch->tail.counter;
 #else
-    ch->control.store(control|(count << 1), std::memory_order_release);
+    return reinterpret_cast<const volatile uint64_t*>(&ch->tail);
 #endif
 }
 
-inline void _ch_channel_set_idle(struct ch_channel* ch) {
-    _ch_channel_write_control(ch, _CH_CHANNEL_IDLE, 0);
+inline uint64_t ch_channel_read_head(struct ch_channel* ch) {
+#ifdef __KERNEL__
+    return atomic64_read_acquire(&ch->head);
+#else
+    return ch->head.load(std::memory_order_acquire);
+#endif
+}
+
+inline uint64_t ch_channel_read_tail(struct ch_channel* ch) {
+#ifdef __KERNEL__
+    return atomic64_read_acquire(&ch->tail);
+#else
+    return ch->tail.load(std::memory_order_acquire);
+#endif
 }
 
-inline size_t _ch_channel_wait_for_access(struct ch_channel* ch) {
-    return _ch_channel_spin(ch, _CH_CHANNEL_ACCESS);
+inline uint64_t _ch_channel_read_head_timestamp(struct ch_channel* ch) {
+#ifdef __KERNEL__
+    return READ_ONCE(ch->head_timestamp);
+#else
+    return ch->head_timestamp.load(std::memory_order_relaxed);
+#endif
+}
+
+inline uint64_t _ch_channel_read_tail_timestamp(struct ch_channel* ch) {
+#ifdef __KERNEL__
+    return READ_ONCE(ch->tail_timestamp);
+#else
+    return ch->tail_timestamp.load(std::memory_order_relaxed);
+#endif
 }
 
-inline void ch_channel_wait_for_idle(struct ch_channel* ch) {
-    _ch_channel_spin(ch, _CH_CHANNEL_IDLE);
+inline void ch_channel_publish_head(struct ch_channel* ch, uint64_t head) {
+#ifdef __KERNEL__
+    WRITE_ONCE(ch->head_timestamp, ch_cycles());
+    atomic64_set_release(&ch->head, head);
+#else
+    ch->head_timestamp.store(ch_cycles(), std::memory_order_relaxed);
+    ch->head.store(head, std::memory_order_release);
+#endif
 }
 
-inline void ch_channel_set_access(struct ch_channel* ch, size_t count) {
-#ifndef __KERNEL__
-    // assert(count > 0);
+inline void ch_channel_publish_tail(struct ch_channel* ch, uint64_t tail) {
+#ifdef __KERNEL__
+    WRITE_ONCE(ch->tail_timestamp, ch_cycles());
+    atomic64_set_release(&ch->tail, tail);
+#else
+    ch->tail_timestamp.store(ch_cycles(), std::memory_order_relaxed);
+    ch->tail.store(tail, std::memory_order_release);
 #endif
-    _ch_channel_write_control(ch, _CH_CHANNEL_ACCESS, count);
+}
+
+/*
+ * Resets both indices of an unused channel, e.g., before switching to it.
+ */
+inline void ch_channel_init(struct ch_channel* ch, uint64_t index) {
+    ch_channel_publish_tail(ch, index);
+    ch_channel_publish_head(ch, index);
+}
+
+/*
+ * Used by the agent: waits until entries beyond tail were submitted
+ * and returns the new head.
+ */
+inline uint64_t ch_channel_wait_for_head(struct ch_channel* ch, uint64_t tail, unsigned policy, struct ch_wait_stats* stats) {
+    uint64_t head;
+    unsigned polls = 0;
+    while((head = ch_channel_read_head(ch)) == tail) {
+        _ch_wait_step(policy, _ch_channel_head_address(ch), tail, polls++, stats);
+    }
+    _ch_wait_done(polls, _ch_channel_read_head_timestamp(ch), stats);
+    return head;
+}
+
+/*
+ * Used by the user process: waits until the agent executed all entries up
+ * to (excluding) the given index.
+ */
+inline void ch_channel_wait_for_tail(struct ch_channel* ch, uint64_t index, unsigned policy, struct ch_wait_stats* stats) {
+    uint64_t tail;
+    unsigned polls = 0;
+    while((tail = ch_channel_read_tail(ch)) != index) {
+        _ch_wait_step(policy, _ch_channel_tail_address(ch), tail, polls++, stats);
+    }
+    _ch_wait_done(polls, _ch_channel_read_tail_timestamp(ch), stats);
+}
+
+/*
+ * Used by the user process: waits until the agent executed at least all
+ * entries up to (excluding) the given index, later ones may still be in
+ * flight.
+ */
+inline void ch_channel_wait_for_progress(struct ch_channel* ch, uint64_t index, unsigned policy, struct ch_wait_stats* stats) {
+    uint64_t tail;
+    unsigned polls = 0;
+    while((tail = ch_channel_read_tail(ch)) < index) {
+        _ch_wait_step(policy, _ch_channel_tail_address(ch), tail, polls++, stats);
+    }
+    _ch_wait_done(polls, _ch_channel_read_tail_timestamp(ch), stats);
 }
 
 #ifdef __cplusplus
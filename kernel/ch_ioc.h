@@ -14,8 +14,44 @@
 
 struct ch_ioc_alloc_config {
     /* in */ unsigned order;
+    /* in */ int cpu; /* Allocate on the NUMA node of the CPU, on any node if negative */
     /* out */ uintptr_t virtual_base;
     /* out */ uintptr_t physical_base;
+    /* out */ int node; /* NUMA node the region resides on */
+};
+
+/* Upper bound of ch_ioc_bulk_alloc_config::max_order that selects the largest blocks available */
+#define CH_ALLOC_MAX_ORDER (~0u)
+
+struct ch_ioc_region {
+    uintptr_t virtual_base;
+    uintptr_t physical_base;
+    size_t size;
+    int node; /* NUMA node the region resides on */
+};
+
+struct ch_ioc_bulk_alloc_config {
+    /* in */  size_t size; /* Bytes to allocate at least */
+    /* in */  unsigned max_order; /* Blocks are at most 2^max_order pages large */
+    /* in */  int cpu; /* Allocate on the NUMA node of the CPU, on any node if negative */
+    /* in */  struct ch_ioc_region* regions; /* Receives the allocated regions */
+    /* in */  size_t max_regions; /* Capacity of regions, allocation stops early once it is exhausted */
+    /* out */ size_t region_count;
+    /* out */ size_t allocated; /* Bytes allocated in total */
+};
+
+struct ch_ioc_pin_config {
+    /* in */  uintptr_t user_base; /* Page aligned buffer of the calling process, e.g. a hugetlbfs mapping */
+    /* in */  size_t size; /* Bytes to pin, a multiple of the page size */
+    /* in */  struct ch_ioc_region* regions; /* Receives one region per physically contiguous run */
+    /* in */  size_t max_regions; /* Capacity of regions, nothing is pinned (-ENOSPC) if exceeded */
+    /* out */ size_t region_count; /* Regions pinned, or required on -ENOSPC */
+};
+
+struct ch_ioc_quiesce_config {
+    /* in */  unsigned agent;
+    /* in */  unsigned enable; /* Park (nonzero) or release (zero) the SMT siblings of the agent's CPU */
+    /* out */ unsigned parked; /* Number of siblings parked */
 };
 
 struct ch_ioc_cache_info {
@@ -25,6 +61,11 @@ struct ch_ioc_cache_info {
     /* out */ unsigned ways[3];
 };
 
+struct ch_ioc_agent_stats {
+    /* in */  unsigned agent;
+    /* out */ struct ch_agent_stats stats; /* Snapshot while the agent runs */
+};
+
 enum {
     CH_ISOLATION_OFF         = 0,
     CH_ISOLATION_NO_PREEMPT  = 1,
@@ -33,17 +74,37 @@ enum {
 };
 struct ch_ioc_start_config {
     /* in */  unsigned cpu;
-    /* in */  unsigned long long evts[3];
+    /* in */  unsigned long long evts[CH_RESULT_COUNTERS]; /* Zero-terminated unless all counters are used */
     /* in */  unsigned isolation_level;
+    /* in */  unsigned wait_policy; /* CH_WAIT_* policy of the agent */
+    /* out */ unsigned agent; /* Index of the agent, selects its mmap offsets (see CH_MMAP_AGENT_PGOFF) */
     /* out */ uintptr_t channels_base; /* Address of the channels inside kernel address space */
+    /* out */ uintptr_t channels_physical_base;
+    /* out */ uintptr_t ring_base; /* Addresses of the ring, results and levels inside kernel address space */
+    /* out */ uintptr_t ring_physical_base;
+    /* out */ uintptr_t results_base;
+    /* out */ uintptr_t results_physical_base;
+    /* out */ uintptr_t levels_base;
+    /* out */ uintptr_t levels_physical_base;
     /* out */ size_t active_channel;
     /* out */ size_t channel_count; /* Number of channels allocated in the kernel */
+    /* out */ size_t ring_entries; /* Number of entries in the submission ring (a power of two) */
+    /* out */ size_t result_entries; /* Number of slots in the results area (a power of two) */
+    /* out */ size_t program_entries; /* Number of entries in the program area */
+    /* out */ size_t level_entries; /* Number of bytes in the levels area (a power of two) */
+    /* out */ unsigned counters; /* Programmable counters read around instrumented accesses */
+    /* out */ unsigned fixed_counters; /* Fixed counters read around instrumented accesses */
+    /* out */ int node; /* NUMA node of the CPU, its channels, ring, results, program and levels reside on */
 };
 
 enum {
     CH_IOC_ALLOC_MEMORY = _IOWR(CH_IOCTL_TYPE, 0, struct ch_ioc_alloc_config),
     CH_IOC_CACHE_INFO   = _IOR(CH_IOCTL_TYPE, 1, struct ch_ioc_cache_info),
     CH_IOC_START_AGENT  = _IOWR(CH_IOCTL_TYPE, 2, struct ch_ioc_start_config),
+    CH_IOC_ALLOC_MEMORY_BULK = _IOWR(CH_IOCTL_TYPE, 3, struct ch_ioc_bulk_alloc_config),
+    CH_IOC_AGENT_STATS  = _IOWR(CH_IOCTL_TYPE, 4, struct ch_ioc_agent_stats),
+    CH_IOC_PIN_MEMORY   = _IOWR(CH_IOCTL_TYPE, 5, struct ch_ioc_pin_config),
+    CH_IOC_QUIESCE_SIBLINGS = _IOWR(CH_IOCTL_TYPE, 6, struct ch_ioc_quiesce_config),
 };
 
 #endif
@@ -0,0 +1,217 @@
+#ifndef CH_OPS_H
+#define CH_OPS_H
+
+#include "ch_channel.h"
+#include "ch_pmc.h"
+
+/*
+ * Primitives executed by the agent for the individual ring entries.
+ */
+
+#define _CH_REPEAT_2(s)  s s
+#define _CH_REPEAT_4(s)  _CH_REPEAT_2(_CH_REPEAT_2(s))
+#define _CH_REPEAT_8(s)  _CH_REPEAT_2(_CH_REPEAT_4(s))
+#define _CH_REPEAT_16(s) _CH_REPEAT_2(_CH_REPEAT_8(s))
+#define _CH_REPEAT_32(s) _CH_REPEAT_2(_CH_REPEAT_16(s))
+
+inline void ch_op_access(uintptr_t address)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    asm volatile("movq (%[address]), %%rax\n" :: [address] "r"(address) : "rax", "memory");
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    unsigned long long value;
+    asm volatile("LDR %[value], [%[address]]\n" : [value] "=&r"(value) : [address] "r"(address) : "memory");
+}
+#else
+;
+#endif
+
+/*
+ * Loads the pointer at the start of a line, i.e., one hop of a pointer
+ * chase. Consecutive hops depend on each other and need no fence.
+ */
+inline uintptr_t ch_op_chase(uintptr_t address)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    uintptr_t next;
+    asm volatile("movq (%[address]), %[next]\n" : [next] "=r"(next) : [address] "r"(address) : "memory");
+    return next;
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    uintptr_t next;
+    asm volatile("LDR %[next], [%[address]]\n" : [next] "=r"(next) : [address] "r"(address) : "memory");
+    return next;
+}
+#else
+;
+#endif
+
+/*
+ * Waits until the preceding access or maintenance operation completed.
+ */
+inline void ch_op_fence(void)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    asm volatile(_CH_REPEAT_32("mfence\n") ::: "memory");
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    asm volatile("DSB SY\n" ::: "memory");
+}
+#else
+;
+#endif
+
+/*
+ * Single full fence, the cheaper counterpart of ch_op_fence().
+ */
+inline void ch_op_fence_once(void)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    asm volatile("mfence\n" ::: "memory");
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    asm volatile("DSB SY\n" ::: "memory");
+}
+#else
+;
+#endif
+
+/*
+ * Waits until the preceding loads completed. Does not order cache
+ * maintenance operations.
+ */
+inline void ch_op_load_fence(void)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    asm volatile("lfence\n" ::: "memory");
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    asm volatile("DSB LD\n" ::: "memory");
+}
+#else
+;
+#endif
+
+/*
+ * Accesses the address after the load that yielded dependency, i.e., the
+ * access cannot start before the preceding one completed, and returns the
+ * loaded value as the dependency of the next access.
+ */
+inline uintptr_t ch_op_access_dependent(uintptr_t address, uintptr_t dependency)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    uintptr_t value;
+    asm volatile("andq $0, %[dependency]\n"
+                 "movq (%[address], %[dependency]), %[value]\n"
+                 : [value] "=r"(value), [dependency] "+&r"(dependency) : [address] "r"(address) : "cc", "memory");
+    return value;
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    uintptr_t value;
+    asm volatile("AND %[dependency], %[dependency], XZR\n"
+                 "LDR %[value], [%[address], %[dependency]]\n"
+                 : [value] "=r"(value), [dependency] "+&r"(dependency) : [address] "r"(address) : "memory");
+    return value;
+}
+#else
+;
+#endif
+
+/*
+ * Serializes instruction execution around performance counter reads.
+ */
+inline void ch_op_serialize(void)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    unsigned eax = 0, ebx, ecx = 0, edx;
+    asm volatile("cpuid\n" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx) :: "memory");
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    asm volatile("ISB SY\n" ::: "memory");
+}
+#else
+;
+#endif
+
+/*
+ * Orders instruction execution around timestamps without the full
+ * serialization of ch_op_serialize() on x86.
+ */
+inline void ch_op_order(void)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    asm volatile("lfence\n" ::: "memory");
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    asm volatile("ISB SY\n" ::: "memory");
+}
+#else
+;
+#endif
+
+/*
+ * Reads the cycle counter that times instrumented accesses. The caller
+ * serializes around it. Userspace on arm64 falls back to the generic timer
+ * as PMCCNTR_EL0 is usually not accessible at EL0.
+ */
+inline uint64_t ch_op_timestamp(void)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    unsigned lo, hi;
+    asm volatile("rdtsc\n" : "=a"(lo), "=d"(hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+#elif defined(__KERNEL__) && (defined(__aarch64__) || defined(_M_ARM64))
+{
+    uint64_t value;
+    asm volatile("MRS %[value], PMCCNTR_EL0\n" : [value] "=r"(value) :: "memory");
+    return value;
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    uint64_t value;
+    asm volatile("MRS %[value], CNTVCT_EL0\n" : [value] "=r"(value) :: "memory");
+    return value;
+}
+#else
+{
+    return 0;
+}
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+inline void ch_op_clflush(uintptr_t address) {
+    asm volatile("clflush (%[address])\n" :: [address] "r"(address) : "memory");
+}
+
+inline void ch_op_wbinvd(void) {
+    asm volatile("wbinvd\n" ::: "memory");
+}
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+
+inline void ch_op_cisw(unsigned long long set_way) {
+    asm volatile("DC CISW, %[set_way]\n" :: [set_way] "r"(set_way) : "memory");
+}
+
+inline void ch_op_csw(unsigned long long set_way) {
+    asm volatile("DC CSW, %[set_way]\n" :: [set_way] "r"(set_way) : "memory");
+}
+
+inline void ch_op_isw(unsigned long long set_way) {
+    asm volatile("DC ISW, %[set_way]\n" :: [set_way] "r"(set_way) : "memory");
+}
+
+#endif
+
+#endif /* CH_OPS_H */
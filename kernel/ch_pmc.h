@@ -1,16 +1,30 @@
 #ifndef CH_PMC_H
 #define CH_PMC_H
 
+#include "ch_channel.h"
 #include "ch_plat.h"
 
-#define CH_IA32_PERFEVTSEL0 0x186
-#define CH_PERF_LEGACY_CTL0 0xc0010000
+#ifdef __KERNEL__
+#    include <linux/kernel_stat.h>
+#    include <asm/hardirq.h>
+#endif
+
+#define CH_IA32_PERFEVTSEL0         0x186
+#define CH_IA32_FIXED_CTR_CTRL      0x38d
+#define CH_IA32_PERF_GLOBAL_CTRL    0x38f
+#define CH_PERF_LEGACY_CTL0         0xc0010000
+#define CH_PERF_LEGACY_COUNTERS     4
+#define CH_MSR_SMI_COUNT            0x34
 
 struct ch_local_pmc {
 #if defined(__x86_64__) || defined(_M_X64)
-    unsigned counters[8];
+    unsigned counters[2 * CH_RESULT_COUNTERS];
+    unsigned long long fixed_ctrl;
+    unsigned long long global_ctrl;
 #elif defined(__aarch64__) || defined(_M_ARM64)
-    unsigned long long counters[4];
+    unsigned long long counters[CH_RESULT_COUNTERS];
+    unsigned long long cycle_filter;
+    unsigned long long enabled;
 #endif
 };
 
@@ -31,15 +45,92 @@ inline void ch_local_pmc_init(void)
 ;
 #endif
 
+#if defined(__x86_64__) || defined(_M_X64)
+inline unsigned long long ch_local_msr_read(unsigned msr)
+{
+    unsigned lo, hi;
+    asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr) : "memory");
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+inline void ch_local_msr_write(unsigned msr, unsigned long long value)
+{
+    asm volatile("wrmsr" : : "a"((unsigned)value), "d"((unsigned)(value >> 32)), "c"(msr) : "memory");
+}
+
+/*
+ * Architectural performance monitoring leaf (Intel only).
+ */
+inline void ch_local_pmc_cpuid(unsigned* eax, unsigned* edx)
+{
+    unsigned ebx, ecx = 0;
+    *eax = 0xa;
+    asm volatile("cpuid" : "+a"(*eax), "=b"(ebx), "+c"(ecx), "=d"(*edx));
+}
+#endif
+
 /*
-* Save the configuration of the first four custom performance counters
-* and resets them to zero.
+ * Number of programmable counters the agent uses, at most CH_RESULT_COUNTERS.
+ */
+inline unsigned ch_local_pmc_counters(void)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    unsigned eax, edx, counters;
+    if(!ch_is_intel()) {
+        return CH_PERF_LEGACY_COUNTERS;
+    }
+    ch_local_pmc_cpuid(&eax, &edx);
+    counters = (eax >> 8) & 0xff;
+    return counters < CH_RESULT_COUNTERS ? counters : CH_RESULT_COUNTERS;
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    unsigned long long pmcr;
+    unsigned counters;
+    asm volatile("MRS %[pmcr], PMCR_EL0" : [pmcr] "=r"(pmcr));
+    counters = (pmcr >> 11) & ((1 << (15 - 11)) - 1);
+    return counters < CH_RESULT_COUNTERS ? counters : CH_RESULT_COUNTERS;
+}
+#else
+{
+    return 0;
+}
+#endif
+
+/*
+ * Number of fixed-function counters the agent uses, at most
+ * CH_RESULT_FIXED_COUNTERS. Only Intel provides them (version 2 onwards),
+ * the cycle counter of arm64 is reported as the cycles of ch_result.
+ */
+inline unsigned ch_local_pmc_fixed_counters(void)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    unsigned eax, edx, counters;
+    if(!ch_is_intel()) {
+        return 0;
+    }
+    ch_local_pmc_cpuid(&eax, &edx);
+    if((eax & 0xff) < 2) {
+        return 0;
+    }
+    counters = edx & 0x1f;
+    return counters < CH_RESULT_FIXED_COUNTERS ? counters : CH_RESULT_FIXED_COUNTERS;
+}
+#else
+{
+    return 0;
+}
+#endif
+
+/*
+* Save the configuration of the programmable and fixed performance counters
+* and resets the programmable ones to zero.
 */
 inline void ch_local_pmc_save(struct ch_local_pmc* local_pmc)
 #if defined(__x86_64__) || defined(_M_X64)
 {
     unsigned* it = local_pmc->counters;
-    unsigned* const end = local_pmc->counters + (sizeof(local_pmc->counters) / sizeof(local_pmc->counters[0]));
+    unsigned* const end = local_pmc->counters + 2 * ch_local_pmc_counters();
     int i = 0;
     while(it != end) {
         unsigned* lo = it++;
@@ -48,24 +139,35 @@ inline void ch_local_pmc_save(struct ch_local_pmc* local_pmc)
         asm volatile("wrmsr" : : "a"(0), "d"(0), "c"(CH_PMC_MSR0 + i) : "memory");
         i++;
     }
+
+    if(ch_local_pmc_fixed_counters()) {
+        local_pmc->fixed_ctrl = ch_local_msr_read(CH_IA32_FIXED_CTR_CTRL);
+        local_pmc->global_ctrl = ch_local_msr_read(CH_IA32_PERF_GLOBAL_CTRL);
+    }
 }
 #elif defined(__aarch64__) || defined(_M_ARM64)
 {
-    asm volatile("MRS %[out], PMEVTYPER0_EL0" : [out] "=r"(local_pmc->counters[0]) :: "memory");
-    asm volatile("MRS %[out], PMEVTYPER1_EL0" : [out] "=r"(local_pmc->counters[1]) :: "memory");
-    asm volatile("MRS %[out], PMEVTYPER2_EL0" : [out] "=r"(local_pmc->counters[2]) :: "memory");
-    asm volatile("MRS %[out], PMEVTYPER3_EL0" : [out] "=r"(local_pmc->counters[3]) :: "memory");
+    unsigned long long i, counters = ch_local_pmc_counters();
+    for(i = 0; i < counters; i++) {
+        asm volatile(
+            "MSR PMSELR_EL0, %[reg]\n"
+            "ISB SY\n"
+            "MRS %[out], PMXEVTYPER_EL0\n"
+            : [out] "=r"(local_pmc->counters[i]) : [reg] "r"(i) : "memory");
+    }
+    asm volatile("MRS %[out], PMCCFILTR_EL0" : [out] "=r"(local_pmc->cycle_filter) :: "memory");
+    asm volatile("MRS %[out], PMCNTENSET_EL0" : [out] "=r"(local_pmc->enabled) :: "memory");
 }
 #endif
 
 /*
-* Restore the previously saved configuration of the first four custom performance counters.
+* Restore the previously saved configuration of the performance counters.
 */
 inline void ch_local_pmc_restore(const struct ch_local_pmc* local_pmc)
 #if defined(__x86_64__) || defined(_M_X64)
 {
     const unsigned* it = local_pmc->counters;
-    const unsigned* const end = local_pmc->counters + (sizeof(local_pmc->counters) / sizeof(local_pmc->counters[0]));
+    const unsigned* const end = local_pmc->counters + 2 * ch_local_pmc_counters();
     int i = 0;
     while(it != end) {
         unsigned lo = *it++;
@@ -73,13 +175,24 @@ inline void ch_local_pmc_restore(const struct ch_local_pmc* local_pmc)
         asm volatile("wrmsr" : : "a"(lo), "d"(hi), "c"(CH_PMC_MSR0 + i) : "memory");
         i++;
     }
+
+    if(ch_local_pmc_fixed_counters()) {
+        ch_local_msr_write(CH_IA32_FIXED_CTR_CTRL, local_pmc->fixed_ctrl);
+        ch_local_msr_write(CH_IA32_PERF_GLOBAL_CTRL, local_pmc->global_ctrl);
+    }
 }
 #elif defined(__aarch64__) || defined(_M_ARM64)
 {
-    asm volatile("MSR PMEVTYPER0_EL0, %[in]" :: [in] "r"(local_pmc->counters[0]) : "memory");
-    asm volatile("MSR PMEVTYPER1_EL0, %[in]" :: [in] "r"(local_pmc->counters[1]) : "memory");
-    asm volatile("MSR PMEVTYPER2_EL0, %[in]" :: [in] "r"(local_pmc->counters[2]) : "memory");
-    asm volatile("MSR PMEVTYPER3_EL0, %[in]" :: [in] "r"(local_pmc->counters[3]) : "memory");
+    unsigned long long i, counters = ch_local_pmc_counters();
+    for(i = 0; i < counters; i++) {
+        asm volatile(
+            "MSR PMSELR_EL0, %[reg]\n"
+            "ISB SY\n"
+            "MSR PMXEVTYPER_EL0, %[in]\n"
+            :: [in] "r"(local_pmc->counters[i]), [reg] "r"(i) : "memory");
+    }
+    asm volatile("MSR PMCCFILTR_EL0, %[in]" :: [in] "r"(local_pmc->cycle_filter) : "memory");
+    asm volatile("MSR PMCNTENCLR_EL0, %[in]" :: [in] "r"(~local_pmc->enabled) : "memory");
 }
 #endif
 
@@ -132,21 +245,122 @@ inline void ch_local_pmc_configure(
 ;
 #endif
 
-inline unsigned ch_local_pmc_counters(void)
+inline unsigned long long ch_local_pmc_read(unsigned reg)
 #if defined(__x86_64__) || defined(_M_X64)
 {
-    return 4;
+    unsigned lo, hi;
+    asm volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(reg));
+    return ((unsigned long long)hi << 32) | lo;
 }
 #elif defined(__aarch64__) || defined(_M_ARM64)
 {
-    unsigned long long pmcr;
-    asm volatile("MRS %[pmcr], PMCR_EL0" : [pmcr] "=r"(pmcr));
-    return (pmcr >> 11) & ((1 << (15 - 11)) - 1);
+    unsigned long long value = 0;
+    switch(reg) {
+        case 0: asm volatile("MRS %[out], PMEVCNTR0_EL0" : [out] "=r"(value)); break;
+        case 1: asm volatile("MRS %[out], PMEVCNTR1_EL0" : [out] "=r"(value)); break;
+        case 2: asm volatile("MRS %[out], PMEVCNTR2_EL0" : [out] "=r"(value)); break;
+        case 3: asm volatile("MRS %[out], PMEVCNTR3_EL0" : [out] "=r"(value)); break;
+        default:
+            asm volatile(
+                "MSR PMSELR_EL0, %[reg]\n"
+                "ISB SY\n"
+                "MRS %[out], PMXEVCNTR_EL0\n"
+                : [out] "=r"(value) : [reg] "r"((unsigned long long)reg));
+            break;
+    }
+    return value;
+}
+#else
+{
+    return 0;
+}
+#endif
+
+/*
+* Lets the fixed counters (x86) or the cycle counter (arm64) count in all
+* privilege levels. Must be called after the programmable counters were
+* configured.
+*/
+inline void ch_local_pmc_configure_fixed(unsigned programmable)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    unsigned i, fixed = ch_local_pmc_fixed_counters();
+    unsigned long long fixed_ctrl, global_ctrl;
+    if(!fixed) {
+        return;
+    }
+
+    fixed_ctrl = ch_local_msr_read(CH_IA32_FIXED_CTR_CTRL);
+    global_ctrl = ch_local_msr_read(CH_IA32_PERF_GLOBAL_CTRL);
+    for(i = 0; i < fixed; i++) {
+        fixed_ctrl = (fixed_ctrl & ~(0xfULL << (4 * i))) | (0x3ULL << (4 * i)); /* OS and USR */
+        global_ctrl |= 1ULL << (32 + i);
+    }
+    global_ctrl |= (1ULL << programmable) - 1;
+    ch_local_msr_write(CH_IA32_FIXED_CTR_CTRL, fixed_ctrl);
+    ch_local_msr_write(CH_IA32_PERF_GLOBAL_CTRL, global_ctrl);
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+{
+    unsigned long long filter = 1 << 27; /* Also count in EL2 */
+    unsigned long long enable = 1ULL << 31;
+    asm volatile(
+        "MRS x0, PMCR_EL0\n"
+        "ORR x0, x0, #1\n"
+        "MSR PMCR_EL0, x0\n"
+        "MSR PMCCFILTR_EL0, %[filter]\n"
+        "MSR PMCNTENSET_EL0, %[enable]\n"
+        "ISB SY\n"
+        :
+        : [filter] "r"(filter)
+        , [enable] "r"(enable)
+        : "x0", "memory"
+    );
+    (void)programmable;
 }
 #else
 {
+    (void)programmable;
+}
+#endif
+
+inline unsigned long long ch_local_pmc_read_fixed(unsigned reg)
+#if defined(__x86_64__) || defined(_M_X64)
+{
+    unsigned lo, hi;
+    asm volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"((1U << 30) | reg));
+    return ((unsigned long long)hi << 32) | lo;
+}
+#else
+{
+    (void)reg;
     return 0;
 }
 #endif
 
+#ifdef __KERNEL__
+/*
+ * Interrupts the local CPU took thus far: everything accounted by the
+ * generic IRQ layer plus, on x86, the local APIC timer, NMIs and IPIs that
+ * bypass it and the SMIs of MSR_SMI_COUNT (Intel only). Only differences
+ * of two reads are meaningful.
+ */
+inline unsigned long long ch_local_interrupts(int smis)
+{
+    unsigned long long count = kstat_cpu_irqs_sum(smp_processor_id());
+#if defined(__x86_64__) || defined(_M_X64)
+    count += this_cpu_read(irq_stat.apic_timer_irqs) + this_cpu_read(irq_stat.__nmi_count);
+#ifdef CONFIG_SMP
+    count += this_cpu_read(irq_stat.irq_resched_count) + this_cpu_read(irq_stat.irq_call_count);
+#endif
+    if(smis) {
+        count += ch_local_msr_read(CH_MSR_SMI_COUNT) & 0xffffffff;
+    }
+#else
+    (void)smis;
+#endif
+    return count;
+}
+#endif
+
 #endif /* CH_PMC_H */
@@ -1,7 +1,16 @@
 #ifndef CACHEHOUND_ADAPTERS_ARMV8_BYPASS_ADAPTER_HPP
 #define CACHEHOUND_ADAPTERS_ARMV8_BYPASS_ADAPTER_HPP
 
+#include <cstdint>
+#include <span>
+#include <vector>
+
 #include "../concepts/armv8_memory.hpp"
+#include "../concepts/batched_memory.hpp"
+#include "../concepts/armv8_range_memory.hpp"
+#include "../concepts/channel_placement_memory.hpp"
+#include "../concepts/growable_memory.hpp"
+#include "../concepts/interrupt_aware_memory.hpp"
 #include "../concepts/placement_policy.hpp"
 #include "../concepts/resettable_memory.hpp"
 #include "../concepts/flushable_memory.hpp"
@@ -14,8 +23,11 @@ template <armv8_memory Memory, placement_policy PlacementPolicy>
 class armv8_bypass_adapter {
     Memory& memory_;
     PlacementPolicy& placement_policy_;
+    std::vector<unsigned> batch_levels_;
 
     void invalidate_set(std::size_t set);
+    // Invalidates the sets of all addresses with a single flush
+    void invalidate_sets(std::span<const std::uintptr_t> addresses);
 
 public:
     using region_type = typename Memory::region_type;
@@ -35,6 +47,14 @@ public:
 
     unsigned instrumented_access(std::uintptr_t address);
 
+    // The batch is instrumented on the memory in runs of addresses in
+    // distinct sets, whose sets are invalidated before and after each run
+    void access_many(std::span<const std::uintptr_t> addresses)
+        requires batched_memory<Memory>;
+
+    void instrumented_access_many(std::span<const std::uintptr_t> addresses, std::span<unsigned> levels)
+        requires batched_memory<Memory>;
+
     unsigned levels() const noexcept;
 
     void cisw(unsigned level, std::size_t set, std::size_t way);
@@ -43,6 +63,18 @@ public:
 
     void isw(unsigned level, std::size_t set, std::size_t way);
 
+    void cisw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>;
+
+    void csw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>;
+
+    void isw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>;
+
+    void cisw_level(unsigned level)
+        requires armv8_range_memory<Memory>;
+
     void reset() noexcept
         requires resettable_memory<Memory>;
 
@@ -54,6 +86,21 @@ public:
 
     stats_type stats() const noexcept
         requires stats_memory<Memory>;
+
+    void set_channel_placement(std::vector<any_placement_policy> placements)
+        requires channel_placement_memory<Memory>;
+
+    void avoid_channel_conflicts(std::span<const std::uintptr_t> addresses)
+        requires channel_placement_memory<Memory>;
+
+    std::uint64_t interrupts() const noexcept
+        requires interrupt_aware_memory<Memory>;
+
+    void set_interrupt_gap(std::uint64_t cycles) noexcept
+        requires interrupt_aware_memory<Memory>;
+
+    std::size_t grow(std::size_t size)
+        requires growable_memory<Memory>;
 };
 
 }
@@ -3,9 +3,13 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <span>
 #include <vector>
 
+#include "../concepts/channel_placement_memory.hpp"
+#include "../concepts/growable_memory.hpp"
 #include "../concepts/instrumented_memory.hpp"
+#include "../concepts/interrupt_aware_memory.hpp"
 #include "../concepts/placement_policy.hpp"
 #include "../concepts/resettable_memory.hpp"
 #include "../concepts/flushable_memory.hpp"
@@ -21,7 +25,7 @@ namespace cachehound {
 // TODO: Does not seem to work as I wanted to. But could also be a bug with memory_hierarchy.
 // Works like 19 our of 20 times on non_inclusive/inclusive cache. But I need to figure out how to deal with exclusive caches.
 template <instrumented_memory Memory, placement_policy PlacementPolicy>
-class bypass_adapter : public detail::bypass_adapter_base<Memory> {
+class bypass_adapter : public detail::bypass_adapter_base<Memory>, detail::bypass_adapter_chains<Memory> {
 public:
     using region_type = std::conditional_t<
         extended_memory_region<typename Memory::region_type>,
@@ -33,8 +37,12 @@ private:
     PlacementPolicy& placement_policy_;
     std::vector<region_type> regions_;
     std::vector<std::vector<std::uintptr_t>> evsets_;
+    // Regions of the memory that regions_ covers
+    std::size_t memory_regions_ = 0;
 
     void access_eviction_set(std::size_t set);
+    // Evicts the address from the first level until an access misses it
+    void bypass_first_level(std::uintptr_t address);
 
 public:
 
@@ -71,6 +79,23 @@ public:
 
     auto stats() const noexcept
         requires stats_memory<Memory>;
+
+    void set_channel_placement(std::vector<any_placement_policy> placements)
+        requires channel_placement_memory<Memory>;
+
+    void avoid_channel_conflicts(std::span<const std::uintptr_t> addresses)
+        requires channel_placement_memory<Memory>;
+
+    std::uint64_t interrupts() const noexcept
+        requires interrupt_aware_memory<Memory>;
+
+    void set_interrupt_gap(std::uint64_t cycles) noexcept
+        requires interrupt_aware_memory<Memory>;
+
+    // Appends the regions the memory grew by as they are, the eviction sets
+    // remain in the regions present at construction
+    std::size_t grow(std::size_t size)
+        requires growable_memory<Memory>;
 };
 
 }
@@ -1,6 +1,12 @@
 #ifndef CACHEHOUND_ADAPTERS_DETAIL_BYPASS_ADAPTER_BASE_HPP
 #define CACHEHOUND_ADAPTERS_DETAIL_BYPASS_ADAPTER_BASE_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../../concepts/chase_memory.hpp"
 #include "../../concepts/memory.hpp"
 #include "../../concepts/stats_memory.hpp"
 
@@ -15,6 +21,40 @@ struct bypass_adapter_base<Memory, std::enable_if_t<stats_memory<Memory>, void>>
     using stats_type  = typename Memory::stats_type;
 };
 
+// Splits the addresses into maximal runs of consecutive addresses whose first
+// level sets are pairwise distinct and calls func(run, offset) for each, so
+// that no address of a run can evict another one from the first level
+void for_each_distinct_set_run(std::span<const std::uintptr_t> addresses, auto& placement_policy, std::size_t sets, auto&& func)
+{
+    std::vector<bool> used(sets);
+    std::size_t first = 0;
+    while(first < addresses.size()) {
+        auto last = first;
+        for(; last < addresses.size(); last++) {
+            auto set = placement_policy(addresses[last]);
+            if(used[set]) {
+                break;
+            }
+            used[set] = true;
+        }
+        for(auto address : addresses.subspan(first, last - first)) {
+            used[placement_policy(address)] = false;
+        }
+        func(addresses.subspan(first, last - first), first);
+        first = last;
+    }
+}
+
+// Eviction sets linked into chains on memory that chases them itself
+template<memory Memory, typename = void>
+struct bypass_adapter_chains {
+};
+
+template<memory Memory>
+struct bypass_adapter_chains<Memory, std::enable_if_t<chase_memory<Memory>, void>> {
+    std::vector<typename Memory::chain_type> chains_;
+};
+
 }
 
 #endif
@@ -1,15 +1,38 @@
 #ifndef CACHEHOUND_ADAPTERS_IMPL_ARMV8_BYPASS_ADAPTER_HPP
 #define CACHEHOUND_ADAPTERS_IMPL_ARMV8_BYPASS_ADAPTER_HPP
 
+#include <cassert>
+
 #include "../armv8_bypass_adapter.hpp"
+#include "../detail/bypass_adapter_base.hpp"
 #include "../../concepts/armv8_memory.hpp"
+#include "../../concepts/armv8_range_memory.hpp"
 #include "../../concepts/placement_policy.hpp"
 
 template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
 void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>:: invalidate_set(std::size_t set)
 {
-    for (int way = 0; way < memory_.ways(0); way++)
-        memory_.isw(0, set, way);
+    if constexpr (armv8_range_memory<Memory>) {
+        memory_.isw_sets(0, set, set + 1);
+    } else {
+        for (int way = 0; way < memory_.ways(0); way++)
+            memory_.isw(0, set, way);
+    }
+    memory_.flush();
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::invalidate_sets(std::span<const std::uintptr_t> addresses)
+{
+    for (auto address : addresses) {
+        std::size_t set = placement_policy_(address);
+        if constexpr (armv8_range_memory<Memory>) {
+            memory_.isw_sets(0, set, set + 1);
+        } else {
+            for (int way = 0; way < memory_.ways(0); way++)
+                memory_.isw(0, set, way);
+        }
+    }
     memory_.flush();
 }
 
@@ -61,6 +84,31 @@ unsigned cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::instrumented
     return level - 1;
 }
 
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::access_many(std::span<const std::uintptr_t> addresses)
+    requires batched_memory<Memory>
+{
+    batch_levels_.resize(addresses.size());
+    instrumented_access_many(addresses, batch_levels_);
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::instrumented_access_many(std::span<const std::uintptr_t> addresses, std::span<unsigned> levels)
+    requires batched_memory<Memory>
+{
+    assert(addresses.size() == levels.size());
+    detail::for_each_distinct_set_run(addresses, placement_policy_, std::size_t{1} << memory_.index_bits(0), [&](auto run, std::size_t offset) {
+        auto run_levels = levels.subspan(offset, run.size());
+        invalidate_sets(run);
+        memory_.instrumented_access_many(run, run_levels);
+        invalidate_sets(run);
+        for (auto& level : run_levels) {
+            assert(level != 0);
+            level--;
+        }
+    });
+}
+
 template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
 unsigned cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::levels() const noexcept
 {
@@ -82,6 +130,34 @@ void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::isw(unsigned lev
     memory_.isw(level + 1, set, way);
 }
 
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::cisw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+    requires armv8_range_memory<Memory>
+{
+    memory_.cisw_sets(level + 1, first_set, end_set);
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::csw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+    requires armv8_range_memory<Memory>
+{
+    memory_.csw_sets(level + 1, first_set, end_set);
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::isw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+    requires armv8_range_memory<Memory>
+{
+    memory_.isw_sets(level + 1, first_set, end_set);
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::cisw_level(unsigned level)
+    requires armv8_range_memory<Memory>
+{
+    memory_.cisw_level(level + 1);
+}
+
 template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
 void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::reset() noexcept
     requires resettable_memory<Memory>
@@ -111,4 +187,39 @@ cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::stats() const noexcep
     return memory_.stats();
 }
 
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::set_channel_placement(std::vector<any_placement_policy> placements)
+    requires channel_placement_memory<Memory>
+{
+    memory_.set_channel_placement(std::move(placements));
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::avoid_channel_conflicts(std::span<const std::uintptr_t> addresses)
+    requires channel_placement_memory<Memory>
+{
+    memory_.avoid_channel_conflicts(addresses);
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+std::uint64_t cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::interrupts() const noexcept
+    requires interrupt_aware_memory<Memory>
+{
+    return memory_.interrupts();
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::set_interrupt_gap(std::uint64_t cycles) noexcept
+    requires interrupt_aware_memory<Memory>
+{
+    memory_.set_interrupt_gap(cycles);
+}
+
+template<cachehound::armv8_memory Memory, cachehound::placement_policy PlacementPolicy>
+std::size_t cachehound::armv8_bypass_adapter<Memory, PlacementPolicy>::grow(std::size_t size)
+    requires growable_memory<Memory>
+{
+    return memory_.grow(size);
+}
+
 #endif /* CACHEHOUND_ADAPTERS_IMPL_ARMV8_BYPASS_ADAPTER_HPP */
@@ -2,16 +2,35 @@
 #define CACHEHOUND_ADAPTERS_IMPL_BYPASS_ADAPTER_HPP
 
 #include "../bypass_adapter.hpp"
+#include "../../concepts/chase_memory.hpp"
 
 #include <cassert>
 
 template <cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
 void cachehound::bypass_adapter<Memory, PlacementPolicy>::access_eviction_set(std::size_t set) {
-    for(std::uintptr_t address : evsets_[set]) {
-        memory_.access(address);
+    if constexpr(chase_memory<Memory>) {
+        if(!evsets_[set].empty()) {
+            memory_.chase(this->chains_[set], evsets_[set].size());
+        }
+    } else {
+        for(std::uintptr_t address : evsets_[set]) {
+            memory_.access(address);
+        }
     }
 }
 
+template <cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::bypass_adapter<Memory, PlacementPolicy>::bypass_first_level(std::uintptr_t address) {
+    const auto set = placement_policy_(address);
+
+retry:
+    access_eviction_set(set);
+
+    auto level = memory_.instrumented_access(address);
+    if (level == 0)
+        goto retry;
+}
+
 template <cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
 cachehound::bypass_adapter<Memory, PlacementPolicy>::bypass_adapter(Memory& memory, PlacementPolicy& placement_policy)
     : memory_(memory)
@@ -42,7 +61,7 @@ cachehound::bypass_adapter<Memory, PlacementPolicy>::bypass_adapter(Memory& memo
 
                             if constexpr(extended_memory_region<region_type>) {
                                 auto new_physical_base = region.physical_base() + reserved_space;
-                                regions_.emplace_back(new_base, new_physical_base, new_size);
+                                regions_.emplace_back(new_base, new_physical_base, new_size, region.node());
                             } else {
                                 regions_.emplace_back(new_base, new_size);
                             }
@@ -54,7 +73,7 @@ cachehound::bypass_adapter<Memory, PlacementPolicy>::bypass_adapter(Memory& memo
             }
         } else {
             if constexpr(extended_memory_region<region_type>) {
-                regions_.emplace_back(region.base(), region.physical_base(), region.size());
+                regions_.emplace_back(region.base(), region.physical_base(), region.size(), region.node());
             } else {
                 regions_.emplace_back(region.base(), region.size());
             }
@@ -62,6 +81,15 @@ cachehound::bypass_adapter<Memory, PlacementPolicy>::bypass_adapter(Memory& memo
     
     done:;
     }
+    memory_regions_ = memory.regions().size();
+
+    if constexpr(chase_memory<Memory>) {
+        // The lines are excluded from the regions above, so storing the
+        // links in them does not affect other users of the memory
+        for(auto& evset : evsets_) {
+            this->chains_.push_back(evset.empty() ? typename Memory::chain_type{} : memory_.link_chain(evset));
+        }
+    }
 }
 
 template<cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
@@ -101,15 +129,7 @@ unsigned cachehound::bypass_adapter<Memory, PlacementPolicy>::instrumented_acces
     if (level > 0)
         return level - 1;
 
-    const auto set = placement_policy_(address);
-
-retry:
-    access_eviction_set(set);
-
-    level = memory_.instrumented_access(address);
-    if (level == 0)
-        goto retry;
-
+    bypass_first_level(address);
     return 0;
 
 
@@ -175,5 +195,50 @@ auto cachehound::bypass_adapter<Memory, PlacementPolicy>::stats() const noexcept
     return memory_.stats();
 }
 
+template<cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::bypass_adapter<Memory, PlacementPolicy>::set_channel_placement(std::vector<any_placement_policy> placements)
+    requires channel_placement_memory<Memory>
+{
+    memory_.set_channel_placement(std::move(placements));
+}
+
+template<cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::bypass_adapter<Memory, PlacementPolicy>::avoid_channel_conflicts(std::span<const std::uintptr_t> addresses)
+    requires channel_placement_memory<Memory>
+{
+    memory_.avoid_channel_conflicts(addresses);
+}
+
+template<cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
+std::uint64_t cachehound::bypass_adapter<Memory, PlacementPolicy>::interrupts() const noexcept
+    requires interrupt_aware_memory<Memory>
+{
+    return memory_.interrupts();
+}
+
+template<cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
+void cachehound::bypass_adapter<Memory, PlacementPolicy>::set_interrupt_gap(std::uint64_t cycles) noexcept
+    requires interrupt_aware_memory<Memory>
+{
+    memory_.set_interrupt_gap(cycles);
+}
+
+template<cachehound::instrumented_memory Memory, cachehound::placement_policy PlacementPolicy>
+std::size_t cachehound::bypass_adapter<Memory, PlacementPolicy>::grow(std::size_t size)
+    requires growable_memory<Memory>
+{
+    auto grown = memory_.grow(size);
+    auto&& regions = memory_.regions();
+    for(; memory_regions_ < regions.size(); memory_regions_++) {
+        auto& region = regions[memory_regions_];
+        if constexpr(extended_memory_region<region_type>) {
+            regions_.emplace_back(region.base(), region.physical_base(), region.size(), region.node());
+        } else {
+            regions_.emplace_back(region.base(), region.size());
+        }
+    }
+    return grown;
+}
+
 
 #endif /* CACHEHOUND_ADAPTERS_IMPL_BYPASS_ADAPTER_HPP */
@@ -0,0 +1,232 @@
+#ifndef CACHEHOUND_ADAPTERS_LATENCY_ADAPTER_HPP
+#define CACHEHOUND_ADAPTERS_LATENCY_ADAPTER_HPP
+
+#include <cassert>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../concepts/memory.hpp"
+#include "../concepts/armv8_memory.hpp"
+#include "../concepts/armv8_range_memory.hpp"
+#include "../concepts/batched_memory.hpp"
+#include "../concepts/channel_placement_memory.hpp"
+#include "../concepts/flushable_memory.hpp"
+#include "../concepts/growable_memory.hpp"
+#include "../concepts/instrumented_memory.hpp"
+#include "../concepts/interrupt_aware_memory.hpp"
+#include "../concepts/prng_memory.hpp"
+#include "../concepts/resettable_memory.hpp"
+#include "../concepts/switch_channel_memory.hpp"
+#include "../concepts/timed_memory.hpp"
+#include "../concepts/x86_memory.hpp"
+#include "../util/any_placement_policy.hpp"
+#include "../util/latency_classifier.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief Classifies instrumented accesses by their latency instead of the
+ * memory's own classification (e.g., performance counters that are
+ * unavailable to the process). The classifier keeps tracking the latencies
+ * and recalibrates its thresholds once they drift.
+ */
+template<memory Memory>
+    requires instrumented_memory<Memory> && timed_memory<Memory>
+class latency_adapter {
+public:
+    using region_type = typename Memory::region_type;
+    using stats_type = typename Memory::stats_type;
+
+private:
+    Memory& memory_;
+    latency_classifier classifier_;
+
+public:
+    latency_adapter(Memory& memory, latency_classifier classifier)
+        : memory_(memory)
+        , classifier_(std::move(classifier)) {}
+
+    [[nodiscard]] const latency_classifier& classifier() const noexcept {
+        return classifier_;
+    }
+
+    void access(std::uintptr_t address) {
+        memory_.access(address);
+    }
+
+    decltype(auto) regions() const noexcept {
+        return memory_.regions();
+    }
+
+    std::uint8_t offset_bits() const noexcept {
+        return memory_.offset_bits();
+    }
+
+    unsigned instrumented_access(std::uintptr_t address) {
+        auto cycles = memory_.timed_access(address);
+        classifier_.observe(cycles);
+        return classifier_.classify(cycles);
+    }
+
+    void access_many(std::span<const std::uintptr_t> addresses)
+        requires batched_memory<Memory>
+    {
+        memory_.access_many(addresses);
+    }
+
+    // Every latency is classified on its own, so instrumented accesses are
+    // timed one by one
+    void instrumented_access_many(std::span<const std::uintptr_t> addresses, std::span<unsigned> levels)
+        requires batched_memory<Memory>
+    {
+        assert(addresses.size() == levels.size());
+        for(std::size_t i = 0; i < addresses.size(); i++) {
+            levels[i] = instrumented_access(addresses[i]);
+        }
+    }
+
+    std::uint64_t timed_access(std::uintptr_t address) {
+        return memory_.timed_access(address);
+    }
+
+    void seed(std::uint64_t seed)
+        requires prng_memory<Memory>
+    {
+        memory_.seed(seed);
+    }
+
+    void random_accesses(std::size_t count)
+        requires prng_memory<Memory>
+    {
+        memory_.random_accesses(count);
+    }
+
+    void random_access_blacklist(std::span<const std::uintptr_t> addresses)
+        requires prng_memory<Memory>
+    {
+        memory_.random_access_blacklist(addresses);
+    }
+
+    unsigned levels() const noexcept {
+        return memory_.levels();
+    }
+
+    std::uint8_t index_bits(unsigned level) const noexcept {
+        return memory_.index_bits(level);
+    }
+
+    std::size_t ways(unsigned level) const noexcept {
+        return memory_.ways(level);
+    }
+
+    void cisw(unsigned level, std::size_t set, std::size_t way)
+        requires armv8_memory<Memory>
+    {
+        memory_.cisw(level, set, way);
+    }
+
+    void csw(unsigned level, std::size_t set, std::size_t way)
+        requires armv8_memory<Memory>
+    {
+        memory_.csw(level, set, way);
+    }
+
+    void isw(unsigned level, std::size_t set, std::size_t way)
+        requires armv8_memory<Memory>
+    {
+        memory_.isw(level, set, way);
+    }
+
+    void cisw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>
+    {
+        memory_.cisw_sets(level, first_set, end_set);
+    }
+
+    void csw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>
+    {
+        memory_.csw_sets(level, first_set, end_set);
+    }
+
+    void isw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>
+    {
+        memory_.isw_sets(level, first_set, end_set);
+    }
+
+    void cisw_level(unsigned level)
+        requires armv8_range_memory<Memory>
+    {
+        memory_.cisw_level(level);
+    }
+
+    void flush() noexcept
+        requires flushable_memory<Memory>
+    {
+        memory_.flush();
+    }
+
+    void reset()
+        requires resettable_memory<Memory>
+    {
+        memory_.reset();
+    }
+
+    void switch_channel() noexcept
+        requires switch_channel_memory<Memory>
+    {
+        memory_.switch_channel();
+    }
+
+    void clflush(std::uintptr_t address)
+        requires x86_memory<Memory>
+    {
+        memory_.clflush(address);
+    }
+
+    void wbinvd()
+        requires x86_memory<Memory>
+    {
+        memory_.wbinvd();
+    }
+
+    stats_type stats() const noexcept {
+        return memory_.stats();
+    }
+
+    void set_channel_placement(std::vector<any_placement_policy> placements, bool physical = false)
+        requires channel_placement_memory<Memory>
+    {
+        memory_.set_channel_placement(std::move(placements), physical);
+    }
+
+    void avoid_channel_conflicts(std::span<const std::uintptr_t> addresses)
+        requires channel_placement_memory<Memory>
+    {
+        memory_.avoid_channel_conflicts(addresses);
+    }
+
+    std::uint64_t interrupts() const noexcept
+        requires interrupt_aware_memory<Memory>
+    {
+        return memory_.interrupts();
+    }
+
+    void set_interrupt_gap(std::uint64_t cycles) noexcept
+        requires interrupt_aware_memory<Memory>
+    {
+        memory_.set_interrupt_gap(cycles);
+    }
+
+    std::size_t grow(std::size_t size)
+        requires growable_memory<Memory>
+    {
+        return memory_.grow(size);
+    }
+};
+
+}
+
+#endif /* CACHEHOUND_ADAPTERS_LATENCY_ADAPTER_HPP */
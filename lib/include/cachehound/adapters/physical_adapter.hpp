@@ -1,13 +1,24 @@
 #ifndef CACHEHOUND_ADAPTERS_PHYSICAL_ADAPTER_HPP
 #define CACHEHOUND_ADAPTERS_PHYSICAL_ADAPTER_HPP
 
+#include <algorithm>
 #include <cassert>
 #include <map>
+#include <span>
+#include <vector>
 
 #include "../concepts/memory.hpp"
 #include "../concepts/armv8_memory.hpp"
+#include "../concepts/armv8_range_memory.hpp"
+#include "../concepts/batched_memory.hpp"
+#include "../concepts/channel_placement_memory.hpp"
 #include "../concepts/extended_memory_region_range.hpp"
+#include "../concepts/growable_memory.hpp"
 #include "../concepts/instrumented_memory.hpp"
+#include "../concepts/interrupt_aware_memory.hpp"
+#include "../concepts/prng_memory.hpp"
+#include "../concepts/queued_instrumented_memory.hpp"
+#include "../concepts/timed_memory.hpp"
 #include "../util/basic_memory_region.hpp"
 #include "cachehound/concepts/flushable_memory.hpp"
 #include "cachehound/concepts/resettable_memory.hpp"
@@ -29,6 +40,7 @@ private:
     Memory& memory_;
     std::vector<region_type> regions_;
     std::map<std::uintptr_t, std::uintptr_t> address_translation_;
+    std::vector<std::uintptr_t> translated_;
 
     std::uintptr_t translate(std::uintptr_t physical_address) {
         auto it = address_translation_.upper_bound(physical_address);
@@ -38,6 +50,12 @@ private:
         return it->second + (physical_address - it->first);
     }
 
+    std::span<const std::uintptr_t> translate_many(std::span<const std::uintptr_t> physical_addresses) {
+        translated_.resize(physical_addresses.size());
+        std::ranges::transform(physical_addresses, translated_.begin(), [this](auto address) { return translate(address); });
+        return translated_;
+    }
+
 public:
     physical_adapter(Memory& memory) : memory_(memory) {
         for(auto& region : memory_.regions()) {
@@ -64,6 +82,59 @@ public:
         return memory_.instrumented_access(translate(address));
     }
 
+    void access_many(std::span<const std::uintptr_t> addresses)
+        requires batched_memory<Memory>
+    {
+        memory_.access_many(translate_many(addresses));
+    }
+
+    void instrumented_access_many(std::span<const std::uintptr_t> addresses, std::span<unsigned> levels)
+        requires batched_memory<Memory>
+    {
+        memory_.instrumented_access_many(translate_many(addresses), levels);
+    }
+
+    std::uint64_t timed_access(std::uintptr_t address)
+        requires timed_memory<Memory>
+    {
+        return memory_.timed_access(translate(address));
+    }
+
+    void enqueue_instrumented_access(std::uintptr_t address)
+        requires queued_instrumented_memory<Memory>
+    {
+        memory_.enqueue_instrumented_access(translate(address));
+    }
+
+    std::span<const unsigned> collect_instrumented_accesses()
+        requires queued_instrumented_memory<Memory>
+    {
+        return memory_.collect_instrumented_accesses();
+    }
+
+    void seed(std::uint64_t seed)
+        requires prng_memory<Memory>
+    {
+        memory_.seed(seed);
+    }
+
+    void random_accesses(std::size_t count)
+        requires prng_memory<Memory>
+    {
+        memory_.random_accesses(count);
+    }
+
+    void random_access_blacklist(std::span<const std::uintptr_t> addresses)
+        requires prng_memory<Memory>
+    {
+        std::vector<std::uintptr_t> translated;
+        translated.reserve(addresses.size());
+        for(auto address : addresses) {
+            translated.push_back(translate(address));
+        }
+        memory_.random_access_blacklist(translated);
+    }
+
     unsigned levels() const noexcept
         requires instrumented_memory<Memory>
     {
@@ -100,6 +171,30 @@ public:
         memory_.isw(level, set, way);
     }
 
+    void cisw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>
+    {
+        memory_.cisw_sets(level, first_set, end_set);
+    }
+
+    void csw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>
+    {
+        memory_.csw_sets(level, first_set, end_set);
+    }
+
+    void isw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+        requires armv8_range_memory<Memory>
+    {
+        memory_.isw_sets(level, first_set, end_set);
+    }
+
+    void cisw_level(unsigned level)
+        requires armv8_range_memory<Memory>
+    {
+        memory_.cisw_level(level);
+    }
+
     void flush()
         requires flushable_memory<Memory>
     {
@@ -133,6 +228,42 @@ public:
     stats_type stats() const noexcept {
         return memory_.stats();
     }
+
+    void set_channel_placement(std::vector<any_placement_policy> placements)
+        requires channel_placement_memory<Memory>
+    {
+        memory_.set_channel_placement(std::move(placements), true);
+    }
+
+    void avoid_channel_conflicts(std::span<const std::uintptr_t> addresses)
+        requires channel_placement_memory<Memory>
+    {
+        memory_.avoid_channel_conflicts(addresses);
+    }
+
+    std::uint64_t interrupts() const noexcept
+        requires interrupt_aware_memory<Memory>
+    {
+        return memory_.interrupts();
+    }
+
+    void set_interrupt_gap(std::uint64_t cycles) noexcept
+        requires interrupt_aware_memory<Memory>
+    {
+        memory_.set_interrupt_gap(cycles);
+    }
+
+    std::size_t grow(std::size_t size)
+        requires growable_memory<Memory>
+    {
+        auto grown = memory_.grow(size);
+        auto&& regions = memory_.regions();
+        for(auto i = regions_.size(); i < regions.size(); i++) {
+            regions_.emplace_back(regions[i].physical_base(), regions[i].size());
+            address_translation_[regions[i].physical_base()] = regions[i].base();
+        }
+        return grown;
+    }
 };
 
 }
@@ -0,0 +1,47 @@
+#ifndef CACHEHOUND_ALGO_CALIBRATE_LATENCY_HPP
+#define CACHEHOUND_ALGO_CALIBRATE_LATENCY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../concepts/instrumented_memory.hpp"
+#include "../concepts/timed_memory.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief Measures the latencies of lines resident at each level, to fit a
+ * latency_classifier. First level latencies are taken right after accessing
+ * the line. For each deeper level, the line is evicted from the level above
+ * by random accesses to twice the capacity of that level (at most half the
+ * capacity of the level under test). Memory latencies are taken after a
+ * clflush on x86 and after random accesses to twice the capacity of the
+ * last level otherwise. The memory must exceed the capacities involved,
+ * otherwise the random accesses hit the same lines over and over again.
+ *
+ * @param memory The memory to calibrate
+ * @param gen Random generator for the accessed lines
+ * @param samples Number of latencies per level
+ * @return The latencies of each level, the last one being memory
+ */
+template<typename Memory>
+    requires instrumented_memory<Memory> && timed_memory<Memory>
+[[nodiscard]] std::vector<std::vector<std::uint64_t>> calibrate_latency(
+    Memory& memory,
+    std::uniform_random_bit_generator auto& gen,
+    std::size_t samples = 500
+);
+
+/**
+ * @brief Bytes of memory calibrate_latency() needs to evict lines from all
+ * levels by random accesses.
+ */
+[[nodiscard]] std::size_t latency_calibration_size(const instrumented_memory auto& memory) noexcept;
+
+}
+
+#include "./impl/calibrate_latency.hpp"
+
+#endif /* CACHEHOUND_ALGO_CALIBRATE_LATENCY_HPP */
@@ -0,0 +1,67 @@
+#ifndef CACHEHOUND_ALGO_CALIBRATE_SERIALIZATION_HPP
+#define CACHEHOUND_ALGO_CALIBRATE_SERIALIZATION_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <ranges>
+#include <type_traits>
+#include <vector>
+
+#include "../concepts/instrumented_memory.hpp"
+#include "../concepts/serialization_memory.hpp"
+
+namespace cachehound {
+
+template<typename Profile>
+struct serialization_calibration {
+    Profile profile;
+    // Time the memory took for the throughput benchmark
+    std::chrono::nanoseconds duration;
+    // Fraction of instrumented accesses to a line accessed just before that
+    // were reported as first level hits
+    double stability;
+};
+
+/**
+ * @brief Measures throughput and stability of each serialization profile.
+ * Every stability probe accesses a line, then a burst of random lines, and
+ * finally the line again by an instrumented access. Serialization that is
+ * too weak lets the misses of the burst leak into the counters of the
+ * instrumented access, which is then no longer reported as a hit. The
+ * memory remains in the last profile.
+ *
+ * @param memory The memory to calibrate
+ * @param profiles The candidate profiles
+ * @param gen Random generator for the accessed lines
+ * @param probes Number of stability probes per profile
+ * @param burst Number of random accesses before each instrumented access
+ * @param accesses Number of accesses of the throughput benchmark
+ * @return The calibration of each profile, in the order of profiles
+ */
+template<typename Memory>
+    requires instrumented_memory<Memory> && serialization_memory<Memory>
+[[nodiscard]] std::vector<serialization_calibration<typename Memory::serialization_profile>> calibrate_serialization(
+    Memory& memory,
+    std::ranges::input_range auto&& profiles,
+    std::uniform_random_bit_generator auto& gen,
+    std::size_t probes = 1000,
+    std::size_t burst = 16,
+    std::size_t accesses = 100'000
+);
+
+/**
+ * @brief Picks the profile of the fastest calibration whose stability is
+ * at most tolerance below the most stable one.
+ */
+template<typename Profile>
+[[nodiscard]] Profile select_serialization(
+    const std::vector<serialization_calibration<Profile>>& calibrations,
+    double tolerance = 0.01
+);
+
+}
+
+#include "./impl/calibrate_serialization.hpp"
+
+#endif /* CACHEHOUND_ALGO_CALIBRATE_SERIALIZATION_HPP */
@@ -12,6 +12,97 @@ std::optional<std::size_t> measure_sequence(
     std::vector<bool> seen;
     std::size_t hit_counter = 0;
 
+    // Interrupts in between may have evicted lines, such measurements are
+    // discarded like those of insufficient pollution
+    [[maybe_unused]] std::uint64_t interrupts = 0;
+    if constexpr(Safe && interrupt_aware_memory<std::remove_cvref_t<decltype(memory)>>) {
+        interrupts = memory.interrupts();
+    }
+    auto uninterrupted = [&]() -> std::optional<std::size_t> {
+        if constexpr(Safe && interrupt_aware_memory<std::remove_cvref_t<decltype(memory)>>) {
+            if(memory.interrupts() != interrupts) {
+                return std::nullopt;
+            }
+        }
+        return hit_counter;
+    };
+
+    if constexpr(Safe && queued_instrumented_memory<std::remove_cvref_t<decltype(memory)>>) {
+        // Every access is instrumented, so the whole sequence is submitted
+        // at once and evaluated afterwards
+        std::vector<bool> first_access;
+        for(auto addr : std::forward<decltype(sequence)>(sequence)) {
+            if (addr >= seen.size()) {
+                seen.resize(1 + addr);
+            }
+            first_access.push_back(!seen[addr]);
+            seen[addr] = true;
+            memory.enqueue_instrumented_access(*(std::ranges::begin(addresses) + (addr)));
+        }
+
+        auto levels = memory.collect_instrumented_accesses();
+        for(std::size_t i = 0; i < levels.size(); i++) {
+            if(first_access[i]) {
+                if(levels[i] == 0) {
+                    return std::nullopt;
+                }
+            } else {
+                hit_counter += levels[i] == 0;
+            }
+        }
+        return uninterrupted();
+    }
+
+    if constexpr(batched_memory<std::remove_cvref_t<decltype(memory)>>) {
+        // Consecutive plain and instrumented accesses are submitted as one
+        // batch each (all accesses are instrumented if Safe)
+        std::vector<std::uintptr_t> batch;
+        std::vector<bool> first_access;
+        std::vector<unsigned> levels;
+        bool instrumented = false
+           , missed_first = false;
+        auto submit = [&]() {
+            if(instrumented) {
+                levels.resize(batch.size());
+                memory.instrumented_access_many(batch, levels);
+                for(std::size_t i = 0; i < levels.size(); i++) {
+                    if(first_access[i]) {
+                        missed_first |= levels[i] == 0;
+                    } else {
+                        hit_counter += levels[i] == 0;
+                    }
+                }
+            } else {
+                memory.access_many(batch);
+            }
+            batch.clear();
+            first_access.clear();
+        };
+
+        for(auto addr : std::forward<decltype(sequence)>(sequence)) {
+            if (addr >= seen.size()) {
+                seen.resize(1 + addr);
+            }
+
+            bool instrument = Safe || seen[addr];
+            if(instrument != instrumented && !batch.empty()) {
+                submit();
+            }
+            instrumented = instrument;
+            batch.push_back(*(std::ranges::begin(addresses) + (addr)));
+            first_access.push_back(!seen[addr]);
+            seen[addr] = true;
+        }
+        if(!batch.empty()) {
+            submit();
+        }
+
+        if(missed_first) {
+            return std::nullopt;
+        }
+        return uninterrupted();
+    }
+
     for(auto addr : std::forward<decltype(sequence)>(sequence)) {
         if (addr >= seen.size()) {
             seen.resize(1 + addr);
@@ -35,7 +126,7 @@ std::optional<std::size_t> measure_sequence(
         }
     }
 
-    return hit_counter;
+    return uninterrupted();
 }
 
 
@@ -21,7 +21,9 @@ namespace cachehound {
  * @param target The target address for that eviction set
  * @param offset_bits The number of bits by which cache lines are aligned, typically 6 bits for 64-byte cache lines
  * @param urbg Uniform random bit generator supplied to distribution
- * @param distribution An address distribution used for sourcing addresses
+ * @param distribution An address distribution used for sourcing addresses.
+ * Once it yields no new address for a while, a growable memory grows by its
+ * current size and the distribution is updated, provided it supports that.
  * @return std::vector<std::uintptr_t> A valid eviction set for the target address
  */
 [[nodiscard]] std::vector<std::uintptr_t> find_eviction_set(
@@ -0,0 +1,95 @@
+#ifndef CACHEHOUND_ALGO_IMPL_CALIBRATE_LATENCY_HPP
+#define CACHEHOUND_ALGO_IMPL_CALIBRATE_LATENCY_HPP
+
+#include "../calibrate_latency.hpp"
+
+#include <algorithm>
+
+#include "../../concepts/prng_memory.hpp"
+#include "../../concepts/x86_memory.hpp"
+#include "../../util/uniform_address_distribution.hpp"
+
+namespace cachehound::detail {
+
+std::size_t cache_capacity(const instrumented_memory auto& memory, unsigned level) noexcept
+{
+    return memory.ways(level) << (memory.index_bits(level) + memory.offset_bits());
+}
+
+// Bytes accessed at random to evict a line from the levels above the given
+// one (zero if a clflush evicts it instead)
+template<typename Memory>
+std::size_t eviction_volume(const Memory& memory, unsigned level) noexcept
+{
+    if(level == 0 || (x86_memory<Memory> && level == memory.levels())) {
+        return 0;
+    }
+    auto volume = 2 * cache_capacity(memory, level - 1);
+    if(level < memory.levels()) {
+        volume = std::min(volume, cache_capacity(memory, level) / 2);
+    }
+    return volume;
+}
+
+}
+
+std::size_t cachehound::latency_calibration_size(const cachehound::instrumented_memory auto& memory) noexcept
+{
+    std::size_t size = 0;
+    for(unsigned level = 0; level <= memory.levels(); level++) {
+        size = std::max(size, detail::eviction_volume(memory, level));
+    }
+    return size;
+}
+
+template<typename Memory>
+    requires cachehound::instrumented_memory<Memory> && cachehound::timed_memory<Memory>
+std::vector<std::vector<std::uint64_t>> cachehound::calibrate_latency(
+    Memory& memory,
+    std::uniform_random_bit_generator auto& gen,
+    std::size_t samples
+) {
+    uniform_address_distribution distribution{memory, memory.offset_bits()};
+
+    auto random_accesses = [&](std::size_t count) {
+        if constexpr(prng_memory<Memory>) {
+            memory.random_accesses(count);
+        } else {
+            while(count-- > 0) {
+                memory.access(distribution(gen));
+            }
+        }
+    };
+
+    auto evict = [&](std::uintptr_t address, unsigned level, std::size_t evictions) {
+        if constexpr(x86_memory<Memory>) {
+            if(level == memory.levels()) {
+                memory.clflush(address);
+                return;
+            }
+        }
+        random_accesses(evictions);
+    };
+
+    if constexpr(prng_memory<Memory>) {
+        memory.seed(gen());
+        memory.random_access_blacklist({});
+    }
+
+    auto levels = memory.levels();
+    std::vector<std::vector<std::uint64_t>> latencies(levels + 1);
+    for(unsigned level = 0; level <= levels; level++) {
+        auto evictions = detail::eviction_volume(memory, level) >> memory.offset_bits();
+
+        latencies[level].reserve(samples);
+        for(std::size_t sample = 0; sample < samples; sample++) {
+            auto address = distribution(gen);
+            memory.access(address);
+            evict(address, level, evictions);
+            latencies[level].push_back(memory.timed_access(address));
+        }
+    }
+    return latencies;
+}
+
+#endif /* CACHEHOUND_ALGO_IMPL_CALIBRATE_LATENCY_HPP */
@@ -0,0 +1,81 @@
+#ifndef CACHEHOUND_ALGO_IMPL_CALIBRATE_SERIALIZATION_HPP
+#define CACHEHOUND_ALGO_IMPL_CALIBRATE_SERIALIZATION_HPP
+
+#include "../calibrate_serialization.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../../concepts/prng_memory.hpp"
+#include "../../util/uniform_address_distribution.hpp"
+
+template<typename Memory>
+    requires cachehound::instrumented_memory<Memory> && cachehound::serialization_memory<Memory>
+std::vector<cachehound::serialization_calibration<typename Memory::serialization_profile>> cachehound::calibrate_serialization(
+    Memory& memory,
+    std::ranges::input_range auto&& profiles,
+    std::uniform_random_bit_generator auto& gen,
+    std::size_t probes,
+    std::size_t burst,
+    std::size_t accesses
+) {
+    uniform_address_distribution distribution{memory, memory.offset_bits()};
+
+    auto random_accesses = [&](std::size_t count) {
+        if constexpr(prng_memory<Memory>) {
+            // Generated by the memory itself, so only its own cost is measured
+            memory.random_accesses(count);
+        } else {
+            while(count-- > 0) {
+                memory.access(distribution(gen));
+            }
+        }
+    };
+
+    if constexpr(prng_memory<Memory>) {
+        memory.seed(gen());
+        memory.random_access_blacklist({});
+    }
+
+    std::vector<serialization_calibration<typename Memory::serialization_profile>> calibrations;
+    for(auto profile : std::forward<decltype(profiles)>(profiles)) {
+        memory.set_serialization(profile);
+
+        std::size_t hits = 0;
+        for(std::size_t probe = 0; probe < probes; probe++) {
+            auto address = distribution(gen);
+            memory.access(address);
+            random_accesses(burst);
+            hits += memory.instrumented_access(address) == 0;
+        }
+
+        // The instrumented access waits for the completion of all accesses
+        auto start = std::chrono::steady_clock::now();
+        random_accesses(accesses);
+        (void) memory.instrumented_access(distribution(gen));
+        auto duration = std::chrono::steady_clock::now() - start;
+
+        calibrations.push_back({
+            profile,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(duration),
+            probes ? static_cast<double>(hits) / probes : 1.0
+        });
+    }
+    return calibrations;
+}
+
+template<typename Profile>
+Profile cachehound::select_serialization(
+    const std::vector<serialization_calibration<Profile>>& calibrations,
+    double tolerance
+) {
+    assert(!calibrations.empty());
+
+    auto most_stable = std::ranges::max(calibrations, {}, &serialization_calibration<Profile>::stability).stability;
+    auto stable = calibrations | std::views::filter([&](auto& calibration) {
+        return calibration.stability + tolerance >= most_stable;
+    });
+    return std::ranges::min(stable, {}, &serialization_calibration<Profile>::duration).profile;
+}
+
+#endif /* CACHEHOUND_ALGO_IMPL_CALIBRATE_SERIALIZATION_HPP */
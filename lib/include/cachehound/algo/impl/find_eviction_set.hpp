@@ -3,9 +3,13 @@
 
 #include "../find_eviction_set.hpp"
 
+#include <type_traits>
+
 #include "../is_eviction_set.hpp"
 #include "../../concepts/address_distribution.hpp"
+#include "../../concepts/growable_memory.hpp"
 #include "../../util/concatenated_address_distribution.hpp"
+#include "../../util/memory_size.hpp"
 
 std::vector<std::uintptr_t> cachehound::find_eviction_set(
     is_eviction_set auto&& is_eviction_set,
@@ -15,6 +19,8 @@ std::vector<std::uintptr_t> cachehound::find_eviction_set(
     address_distribution auto& distribution
 ) {
     static constexpr std::size_t attempts = 5;
+    // Draws without a new address after which the memory is deemed exhausted
+    static constexpr std::size_t stale_draws_before_growth = 1024;
 
     std::vector<std::uintptr_t> out;
     std::unordered_set<std::uintptr_t> seen;
@@ -32,11 +38,20 @@ std::vector<std::uintptr_t> cachehound::find_eviction_set(
             distribution.reset();
 
             auto it = out.begin();
+            std::size_t stale_draws = 0;
             while(it != out.end()) {
                 auto address = distribution(urbg);
                 if(!seen.contains(address)) {
                     seen.emplace(address);
                     *it++ = address;
+                    stale_draws = 0;
+                } else if(++stale_draws == stale_draws_before_growth) {
+                    if constexpr(growable_memory<std::remove_cvref_t<decltype(memory)>>
+                                 && requires { distribution.update(memory); }) {
+                        memory.grow(memory_size(memory));
+                        distribution.update(memory);
+                    }
+                    stale_draws = 0;
                 }
             }
 
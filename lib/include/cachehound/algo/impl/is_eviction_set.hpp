@@ -7,15 +7,29 @@
 #include <cstdint>
 #include <optional>
 #include <ranges>
+#include <algorithm>
+#include <type_traits>
+
+#include <vector>
+
+#include "../../concepts/batched_memory.hpp"
+#include "../../concepts/interrupt_aware_memory.hpp"
+#include "../../concepts/queued_instrumented_memory.hpp"
 
 bool cachehound::unsafe_is_eviction_set(
     cachehound::instrumented_memory auto& memory,
     std::uintptr_t target,
     cachehound::address_range auto&& addresses
 ) {
-    memory.access(target);
-    for(std::uintptr_t address : std::forward<decltype(addresses)>(addresses)) {
-        memory.access(address);
+    if constexpr(batched_memory<std::remove_cvref_t<decltype(memory)>>) {
+        std::vector<std::uintptr_t> batch{target};
+        std::ranges::copy(std::forward<decltype(addresses)>(addresses), std::back_inserter(batch));
+        memory.access_many(batch);
+    } else {
+        memory.access(target);
+        for(std::uintptr_t address : std::forward<decltype(addresses)>(addresses)) {
+            memory.access(address);
+        }
     }
     return memory.instrumented_access(target) > 0;
 }
@@ -25,6 +39,36 @@ std::optional<bool> cachehound::safe_is_eviction_set(
     std::uintptr_t target,
     cachehound::address_range auto&& addresses
 ) {
+    // An interrupt in between may have evicted the target, such results are
+    // discarded like those of insufficient pollution
+    [[maybe_unused]] std::uint64_t interrupts = 0;
+    if constexpr(interrupt_aware_memory<std::remove_cvref_t<decltype(memory)>>) {
+        interrupts = memory.interrupts();
+    }
+    auto uninterrupted = [&](bool result) -> std::optional<bool> {
+        if constexpr(interrupt_aware_memory<std::remove_cvref_t<decltype(memory)>>) {
+            if(memory.interrupts() != interrupts) {
+                return std::nullopt;
+            }
+        }
+        return result;
+    };
+
+    if constexpr(queued_instrumented_memory<std::remove_cvref_t<decltype(memory)>>) {
+        // Measure everything in one batch, the checks below only depend on the results
+        memory.enqueue_instrumented_access(target);
+        for(std::uintptr_t address : std::forward<decltype(addresses)>(addresses)) {
+            memory.enqueue_instrumented_access(address);
+        }
+        memory.enqueue_instrumented_access(target);
+
+        auto levels = memory.collect_instrumented_accesses();
+        if(std::ranges::any_of(levels.first(levels.size() - 1), [](unsigned level) { return level == 0; })) {
+            return std::nullopt;
+        }
+        return uninterrupted(levels.back() > 0);
+    }
+
     if(memory.instrumented_access(target) == 0) {
         return std::nullopt;
     }
@@ -33,7 +77,7 @@ std::optional<bool> cachehound::safe_is_eviction_set(
             return std::nullopt;
         }
     }
-    return memory.instrumented_access(target) > 0;
+    return uninterrupted(memory.instrumented_access(target) > 0);
 }
 
 #endif /* CACHEHOUND_ALGO_IMPL_IS_EVICTION_SET_HPP */
@@ -0,0 +1,63 @@
+#ifndef CACHEHOUND_ALGO_IMPL_MEASURE_EVICTION_NOISE_HPP
+#define CACHEHOUND_ALGO_IMPL_MEASURE_EVICTION_NOISE_HPP
+
+#include "../measure_eviction_noise.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "../is_eviction_set.hpp"
+#include "../../concepts/resettable_memory.hpp"
+#include "../../concepts/x86_memory.hpp"
+#include "../../util/uniform_address_distribution.hpp"
+
+cachehound::eviction_noise cachehound::measure_eviction_noise(
+    cachehound::instrumented_memory auto& memory,
+    std::uniform_random_bit_generator auto& gen,
+    std::size_t size,
+    std::size_t probes,
+    std::size_t pollution
+) {
+    using Memory = std::remove_cvref_t<decltype(memory)>;
+    uniform_address_distribution distribution{memory};
+
+    auto check = [&](std::uintptr_t target, const std::vector<std::uintptr_t>& addresses) {
+        if constexpr(resettable_memory<Memory>) {
+            memory.reset();
+        } else if constexpr(x86_memory<Memory>) {
+            memory.wbinvd();
+        } else {
+            for(std::size_t i = 0; i < pollution; i++) {
+                memory.access(distribution(gen));
+            }
+        }
+        return safe_is_eviction_set(memory, target, addresses);
+    };
+
+    eviction_noise noise;
+    std::vector<std::uintptr_t> addresses;
+    for(; noise.probes < probes; noise.probes++) {
+        auto target = distribution(gen);
+        addresses.clear();
+        while(addresses.size() < size) {
+            auto address = distribution(gen);
+            if(address != target && std::ranges::find(addresses, address) == addresses.end()) {
+                addresses.push_back(address);
+            }
+        }
+
+        std::optional<bool> first = check(target, addresses);
+        std::optional<bool> second = check(target, addresses);
+        if(!first || !second) {
+            noise.discarded++;
+        } else if(*first != *second) {
+            noise.inconsistent++;
+        }
+    }
+    return noise;
+}
+
+#endif /* CACHEHOUND_ALGO_IMPL_MEASURE_EVICTION_NOISE_HPP */
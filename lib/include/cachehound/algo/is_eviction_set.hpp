@@ -22,7 +22,8 @@ concept is_eviction_set = requires(F func, kernel_memory memory, std::uintptr_t
  * miss. It is recommended when using cache polluting to make sure
  * that the polluting was sufficient. A mechanism around the safe variant
  * is required to satisfy the is_eviction_set concept (which expects a
- * bool return type).
+ * bool return type). On interrupt_aware_memory, it also rejects results
+ * during which the CPU of the memory took an interrupt.
  * 
  * @param memory The memory to perform the accesses on
  * @param target The target address that should be evicted
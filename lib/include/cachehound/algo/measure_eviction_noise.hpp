@@ -0,0 +1,52 @@
+#ifndef CACHEHOUND_ALGO_MEASURE_EVICTION_NOISE_HPP
+#define CACHEHOUND_ALGO_MEASURE_EVICTION_NOISE_HPP
+
+#include <cstddef>
+#include <random>
+
+#include "../concepts/instrumented_memory.hpp"
+
+namespace cachehound {
+
+struct eviction_noise {
+    std::size_t probes = 0;
+    // Probes of which safe_is_eviction_set discarded a result due to
+    // insufficient pollution or interrupts
+    std::size_t discarded = 0;
+    // Probes whose two results disagreed, the noise repetitions guard against
+    std::size_t inconsistent = 0;
+
+    // Fraction of probes that yielded no trustworthy result
+    [[nodiscard]] double unsafe_rate() const noexcept {
+        return probes ? static_cast<double>(discarded + inconsistent) / probes : 0.0;
+    }
+};
+
+/**
+ * @brief Estimates how often safe_is_eviction_set yields untrustworthy
+ * results on the memory, e.g. to compare the noise with and without a
+ * quiet SMT sibling. Every probe checks a random target against size random
+ * lines twice, resetting (or wbinvd-ing) the memory before each check, or
+ * polluting it on memories that support neither. Sets of about as many lines as the level has ways
+ * evict the target by chance, so that noise shows up in both directions.
+ *
+ * @param memory The memory to measure
+ * @param gen Random generator for the accessed lines
+ * @param size Number of lines checked against each target
+ * @param probes Number of probes
+ * @param pollution Random accesses before each check on memories that can
+ * be neither reset nor wbinvd-ed
+ */
+[[nodiscard]] eviction_noise measure_eviction_noise(
+    instrumented_memory auto& memory,
+    std::uniform_random_bit_generator auto& gen,
+    std::size_t size,
+    std::size_t probes = 1000,
+    std::size_t pollution = 0
+);
+
+}
+
+#include "./impl/measure_eviction_noise.hpp"
+
+#endif /* CACHEHOUND_ALGO_MEASURE_EVICTION_NOISE_HPP */
@@ -4,7 +4,10 @@
 #include <unordered_set>
 
 #include "../concepts/address_range.hpp"
+#include "../concepts/batched_memory.hpp"
 #include "../concepts/instrumented_memory.hpp"
+#include "../concepts/interrupt_aware_memory.hpp"
+#include "../concepts/queued_instrumented_memory.hpp"
 #include "../concepts/resettable_memory.hpp"
 #include "../concepts/sequence.hpp"
 #include "../concepts/x86_memory.hpp"
@@ -0,0 +1,374 @@
+#ifndef CACHEHOUND_BACKENDS_DETAIL_AGENT_MEMORY_BASE_HPP
+#define CACHEHOUND_BACKENDS_DETAIL_AGENT_MEMORY_BASE_HPP
+
+#include <cstddef>
+#include <concepts>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "ch_channel.h"
+#include "ch_ioc.h"
+
+#include "../../util/address_checker.hpp"
+#include "../../util/any_placement_policy.hpp"
+#include "../../util/pmu_profile.hpp"
+
+namespace cachehound::detail {
+
+/**
+ * @brief Client side of the channel protocol shared by all backends whose
+ * accesses are executed by an agent (see kernel/ch_channel.h). Derived
+ * classes set up the agent together with its channels, ring and results
+ * and hand them over via attach().
+ */
+class agent_memory_base {
+public:
+    enum class wait_policy : unsigned {
+        spin = CH_WAIT_SPIN,
+        monitor = CH_WAIT_MONITOR,
+        sleep = CH_WAIT_SLEEP
+    };
+
+    // See CH_SERIALIZE_* in kernel/ch_channel.h
+    enum class serialization_profile : unsigned {
+        strict     = CH_SERIALIZE_STRICT,
+        fence      = CH_SERIALIZE_FENCE,
+        load_fence = CH_SERIALIZE_LOAD_FENCE,
+        dependency = CH_SERIALIZE_DEPENDENCY
+    };
+
+    // Location of a program inside the program area (see run_program())
+    struct program_type {
+        std::size_t offset                = 0
+                  , length                = 0
+                  , instrumented_accesses = 0;
+        // Whether the agent classifies the instrumented accesses (see
+        // set_pmu_profile())
+        bool classified = false;
+    };
+
+    // Location of a linked chain inside the program area (see link_chain())
+    struct chain_type {
+        std::size_t offset = 0
+                  , length = 0;
+    };
+
+    struct stats_type {
+        std::size_t accesses              = 0
+                  , instrumented_accesses = 0
+                  , flushes               = 0
+                  , channel_switches      = 0
+                  , program_runs          = 0;
+        // Checks by avoid_channel_conflicts() that found the active channel
+        // colliding with the addresses, of which no channel was free of
+        // collisions
+        std::size_t channel_collisions            = 0
+                  , unavoidable_channel_collisions = 0;
+        // Ring entries and result or level slots passed over since their
+        // lines collide with those addresses as well
+        std::size_t skipped_entries = 0
+                  , skipped_results = 0;
+        // Waits for the agent and for submissions by the agent, respectively
+        // (see ch_wait_stats), latencies in cycles
+        std::size_t waits                     = 0
+                  , wait_sleeps               = 0
+                  , wait_latency_sum          = 0
+                  , wait_latency_max          = 0
+                  , agent_waits               = 0
+                  , agent_wait_sleeps         = 0
+                  , agent_wait_latency_sum    = 0
+                  , agent_wait_latency_max    = 0;
+        // Cycles the process spent preparing submissions between flushes
+        // and how many of them overlapped with the agent executing the
+        // preceding batch, flushes that found it still executing
+        std::size_t fill_cycles        = 0
+                  , overlap_cycles     = 0
+                  , overlapped_flushes = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+        std::size_t clflushes = 0
+                  , wbinvds   = 0;
+#elif defined(__aarch64__) || defined(_M_ARM64)
+        std::size_t csws  = 0
+                  , isws  = 0
+                  , cisws = 0;
+#endif
+    };
+
+private:
+    static constexpr std::size_t reserved_upper_bits = 8 * sizeof(std::uintptr_t) - CH_OP_SHIFT;
+
+    ch_channel* active_channel() const;
+    void switch_channel(std::size_t channel) noexcept;
+    void internal_access(std::uint64_t entry);
+    void enqueue_access(std::uintptr_t address, bool classified);
+    void expect_results(bool classified, std::size_t count, bool skipped = false);
+    void skip_results(bool classified, std::size_t count);
+    std::uint64_t ring_skip(std::uint64_t position) const noexcept;
+    void place_entry(std::uint64_t entry) noexcept;
+    void wait_for_completion() noexcept;
+    void collect_results();
+    bool valid_address(std::uintptr_t address);
+    bool channel_collides(std::size_t channel, std::span<const std::uintptr_t> addresses) const;
+    void update_area_collisions(std::span<const std::uintptr_t> addresses);
+
+    std::size_t active_channel_ = 0;
+    std::size_t channel_count_ = 0;
+    std::uint64_t head_ = 0;
+
+    std::uint64_t results_head_ = 0
+                , results_tail_ = 0;
+    std::uint64_t levels_head_ = 0
+                , levels_tail_ = 0;
+    // Submission order of full and classified results that are yet to be
+    // collected, as runs of the same kind
+    struct pending_results {
+        bool classified;
+        std::size_t count;
+        // Slots passed over by the agent (see skip_results())
+        bool skipped = false;
+    };
+    std::vector<pending_results> pending_;
+    std::vector<unsigned> levels_;
+    std::vector<unsigned> collected_levels_;
+    std::vector<ch_result> raw_results_;
+    std::vector<ch_result> collected_raw_results_;
+    ch_result last_result_{};
+
+    // Entries are buffered in halves of the ring, so that the next half is
+    // filled while the agent executes the previous one. Flushing waits for
+    // the half before that only.
+    std::vector<std::uint64_t> buffer_;
+    std::size_t buffered_ = 0;
+    std::uint64_t fill_start_ = 0;
+    bool agent_busy_ = false;
+
+    stats_type stats_{};
+    wait_policy wait_policy_;
+    ch_wait_stats wait_stats_{};
+    std::uint64_t interrupts_ = 0;
+
+    // Of the static profile passed on construction
+    pmu_decoder* pmu_decoder_;
+    bool classifying_ = false;
+    serialization_profile serialization_ = serialization_profile::strict;
+    std::vector<any_placement_policy> channel_placements_;
+    bool physical_channel_placement_ = false;
+    // Sets of the addresses last passed to avoid_channel_conflicts() as
+    // pairs of placement and set, and the ring, result and level slots on
+    // lines that map to one of them (empty if none does)
+    std::vector<std::pair<std::size_t, std::size_t>> collision_sets_;
+    std::vector<bool> ring_collisions_
+                    , result_collisions_
+                    , level_collisions_;
+
+    bool recording_ = false;
+    std::vector<std::uint64_t> program_buffer_;
+    std::size_t program_instrumented_accesses_ = 0;
+    std::size_t repeat_start_ = 0;
+    std::size_t repeat_instrumented_accesses_ = 0;
+    bool repeating_ = false;
+    std::size_t program_used_ = 0;
+    std::size_t blacklist_entries_ = 0;
+    stats_type recording_stats_{};
+
+    void begin_repeat(std::size_t repetitions);
+    void end_repeat(std::size_t repetitions);
+
+protected:
+    ch_channel* channels_ = nullptr;
+    std::uint64_t* ring_ = nullptr;
+    std::size_t ring_entries_ = 0;
+    const ch_result* results_ = nullptr;
+    std::size_t result_entries_ = 0;
+    std::uint64_t* program_ = nullptr;
+    std::size_t program_entries_ = 0;
+    const std::uint8_t* levels_area_ = nullptr;
+    std::size_t level_entries_ = 0;
+
+    address_checker address_checker_;
+    ch_ioc_cache_info cache_info_{};
+
+    // Addresses through which the agent accesses the channels (defaults to
+    // the channels handed to attach()), the physical one is zero if unknown
+    std::uintptr_t channels_address_ = 0
+                 , channels_physical_address_ = 0;
+
+    // Address through which the agent accesses an area and the physical
+    // addresses of its pages (empty if unknown)
+    struct area_addresses {
+        std::uintptr_t address = 0;
+        std::size_t page_size = 0;
+        std::vector<std::uintptr_t> physical_pages;
+    };
+    // Of the ring, results and levels, the addresses default to the areas
+    // handed to attach()
+    area_addresses ring_addresses_
+                 , results_addresses_
+                 , levels_addresses_;
+
+    // Value of the upper address bits that are replaced by the operation of
+    // a ring entry (all ones for kernel addresses)
+    std::uintptr_t upper_address_bits_ = (1 << reserved_upper_bits) - 1;
+
+    agent_memory_base(pmu_decoder* decoder, wait_policy wait);
+
+    void attach(
+        ch_channel* channels,
+        std::size_t active_channel,
+        std::size_t channel_count,
+        std::uint64_t* ring,
+        std::size_t ring_entries,
+        const ch_result* results,
+        std::size_t result_entries,
+        std::uint64_t* program,
+        std::size_t program_entries,
+        const std::uint8_t* levels,
+        std::size_t level_entries);
+
+    // Submits all buffered entries and waits for the agent to execute them
+    void drain() noexcept;
+    // Drains the ring and instructs the agent to exit
+    void terminate_agent() noexcept;
+
+public:
+    agent_memory_base(const agent_memory_base&) = delete;
+    agent_memory_base& operator=(const agent_memory_base&) = delete;
+
+    [[nodiscard]] unsigned levels() const noexcept;
+
+    std::uint8_t offset_bits() const noexcept;
+    std::uint8_t index_bits(unsigned level) const noexcept;
+    std::size_t ways(unsigned level) const noexcept;
+
+    void access(std::uintptr_t address) noexcept;
+    unsigned instrumented_access(std::uintptr_t address);
+    // Batched forms of access() and instrumented_access(), the levels of the
+    // whole batch are collected by a single wait for the agent
+    void access_many(std::span<const std::uintptr_t> addresses) noexcept;
+    void instrumented_access_many(std::span<const std::uintptr_t> addresses, std::span<unsigned> levels);
+    // Cycles the access took (never classified by the agent), measured in the same pass as the counters
+    // (see last_result())
+    std::uint64_t timed_access(std::uintptr_t address);
+    // Cycles and all counter deltas of the last instrumented_access() or
+    // timed_access()
+    [[nodiscard]] const ch_result& last_result() const noexcept;
+
+    // Queues an instrumented access without waiting for its result. The
+    // levels of all queued instrumented accesses are returned in submission
+    // order by the next call to collect_instrumented_accesses(); the span
+    // remains valid until the call after that.
+    void enqueue_instrumented_access(std::uintptr_t address);
+    std::span<const unsigned> collect_instrumented_accesses();
+    // Cycles and all counter deltas of the accesses returned by the last
+    // collect_instrumented_accesses() that the agent did not classify, in
+    // the same order
+    [[nodiscard]] std::span<const ch_result> collected_results() const noexcept;
+
+    inline void flush() noexcept;
+
+    stats_type stats() const noexcept;
+
+    // Records all subsequent operations into a program instead of submitting
+    // them, up to the matching end_program(). Programs are uploaded to the
+    // program area once and then executed by the agent with a single ring
+    // entry per run_program(). Blocking operations must not be recorded and
+    // recorded operations do not count towards stats().
+    void begin_program();
+    program_type end_program();
+    // Queues a run of the program, see enqueue_instrumented_access()
+    void run_program(const program_type& program);
+    // Invalidates all programs uploaded thus far
+    void clear_programs() noexcept;
+    // Records the operations issued by body repeated times (only while
+    // recording a program, repetitions cannot be nested)
+    void repeat(std::size_t repetitions, std::invocable auto&& body);
+
+    // Reseeds the generator of random_accesses()
+    void seed(std::uint64_t seed) noexcept;
+    // Accesses count pseudo-random lines of the memory regions
+    void random_accesses(std::size_t count) noexcept;
+    // Excludes the lines of the addresses from random_accesses(), replacing
+    // the previous blacklist (stored at the end of the program area)
+    void random_access_blacklist(std::span<const std::uintptr_t> addresses);
+    // Waits for all preceding operations of the agent to complete
+    void barrier() noexcept;
+    // Lets the agent cover the regions added since its start (see grow())
+    // by random accesses and chains
+    void reload_lines() noexcept;
+
+    // Uploads the addresses to the program area and lets the agent link
+    // their lines into a cycle through the first word of each line, which
+    // overwrites it. Chains are invalidated by clear_programs(). Throws
+    // std::invalid_argument for addresses outside the regions.
+    chain_type link_chain(std::span<const std::uintptr_t> addresses);
+    // Accesses hops lines of the chain by dependent loads, starting at its
+    // first address (all of them for hops == chain.length)
+    void chase(const chain_type& chain, std::size_t hops) noexcept;
+
+    // Lets the agent classify subsequent instrumented accesses by the rules
+    // of the profile and report their levels only. The events of the profile
+    // must match the ones the agent was started with, its rules the ones of
+    // the static profile that decodes the results of earlier programs.
+    void set_pmu_profile(const pmu_profile& profile);
+
+    // Lets the agent serialize subsequent operations by the profile, see
+    // calibrate_serialization() for choosing one
+    void set_serialization(serialization_profile profile) noexcept;
+    [[nodiscard]] serialization_profile serialization() const noexcept;
+
+    // Interrupts the agent's CPU took up to the last completion waited for
+    // (see struct ch_channel). Results are contaminated if the count
+    // advanced while they were measured.
+    [[nodiscard]] std::uint64_t interrupts() const noexcept;
+    // Lets the agent count subsequent instrumented accesses that take at
+    // least the given cycles as interrupts (0 disables the heuristic)
+    void set_interrupt_gap(std::uint64_t cycles) noexcept;
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+    void clflush(std::uintptr_t address) noexcept;
+    void wbinvd() noexcept;
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+
+private:
+    void internal_cisw(bool clean, bool invalidate, unsigned level, std::size_t set, std::size_t way);
+    void internal_cisw_sets(bool clean, bool invalidate, unsigned level, std::size_t first_set, std::size_t end_set);
+
+public:
+    void csw(unsigned level, std::size_t set, std::size_t way);
+    void isw(unsigned level, std::size_t set, std::size_t way);
+    void cisw(unsigned level, std::size_t set, std::size_t way);
+    // All ways of the sets [first_set, end_set) of the level, looped by the
+    // agent from a single ring entry
+    void csw_sets(unsigned level, std::size_t first_set, std::size_t end_set);
+    void isw_sets(unsigned level, std::size_t first_set, std::size_t end_set);
+    void cisw_sets(unsigned level, std::size_t first_set, std::size_t end_set);
+    void cisw_level(unsigned level);
+    void reset();
+
+#endif
+
+    void switch_channel() noexcept;
+    // Placement hypotheses (one per level) under which channel lines
+    // collide with addresses, applied to physical addresses of the channels,
+    // ring, results and levels if physical is set
+    void set_channel_placement(std::vector<any_placement_policy> placements, bool physical = false);
+    // Switches away from the active channel if one of its lines maps to a
+    // set of the addresses at any level, to the next channel that does not.
+    // Subsequent submissions pass over ring entries and result or level
+    // slots whose lines map to one of these sets, unless they take up more
+    // than a quarter of the ring or leave no room for a program's results.
+    void avoid_channel_conflicts(std::span<const std::uintptr_t> addresses);
+};
+
+}
+
+#if defined(CACHEHOUND_HEADER_ONLY)
+#include "../impl/agent_memory_base.ipp"
+#endif
+#include "../impl/agent_memory_base.hpp"
+
+#endif /* CACHEHOUND_BACKENDS_DETAIL_AGENT_MEMORY_BASE_HPP */
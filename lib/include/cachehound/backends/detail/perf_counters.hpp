@@ -0,0 +1,40 @@
+#ifndef CACHEHOUND_BACKENDS_DETAIL_PERF_COUNTERS_HPP
+#define CACHEHOUND_BACKENDS_DETAIL_PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "ch_channel.h"
+
+namespace cachehound::detail {
+
+/**
+ * @brief Counts raw PMU events of the calling thread via perf_event_open.
+ * If the events cannot be opened (e.g., due to perf_event_paranoid or a
+ * missing PMU), it acts as a null counter source that always reads zero.
+ */
+class perf_counters {
+    std::array<int, CH_RESULT_COUNTERS> fds_;
+    unsigned count_ = 0;
+
+    void close_all() noexcept;
+
+public:
+    explicit perf_counters(std::span<const std::uint64_t> events) noexcept;
+    ~perf_counters() noexcept;
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    [[nodiscard]] bool available() const noexcept;
+    void read(std::array<std::uint64_t, CH_RESULT_COUNTERS>& values) noexcept;
+};
+
+}
+
+#if defined(CACHEHOUND_HEADER_ONLY)
+#include "../impl/perf_counters.ipp"
+#endif
+
+#endif /* CACHEHOUND_BACKENDS_DETAIL_PERF_COUNTERS_HPP */
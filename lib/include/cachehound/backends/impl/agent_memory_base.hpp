@@ -0,0 +1,15 @@
+#ifndef CACHEHOUND_BACKENDS_IMPL_AGENT_MEMORY_BASE_HPP
+#define CACHEHOUND_BACKENDS_IMPL_AGENT_MEMORY_BASE_HPP
+
+namespace cachehound::detail {
+
+void agent_memory_base::repeat(std::size_t repetitions, std::invocable auto&& body)
+{
+    begin_repeat(repetitions);
+    body();
+    end_repeat(repetitions);
+}
+
+}
+
+#endif /* CACHEHOUND_BACKENDS_IMPL_AGENT_MEMORY_BASE_HPP */
@@ -0,0 +1,868 @@
+#ifndef CACHEHOUND_BACKENDS_IMPL_AGENT_MEMORY_BASE_IPP
+#define CACHEHOUND_BACKENDS_IMPL_AGENT_MEMORY_BASE_IPP
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+#include "../detail/agent_memory_base.hpp"
+
+cachehound::detail::agent_memory_base::agent_memory_base(pmu_decoder* decoder, wait_policy wait)
+    : wait_policy_(wait)
+    , pmu_decoder_(decoder)
+{
+    if (!ch_wait_policy_supported(static_cast<unsigned>(wait))) {
+        throw std::runtime_error("Wait policy " + std::to_string(static_cast<unsigned>(wait)) + " is not supported on this system");
+    }
+}
+
+void cachehound::detail::agent_memory_base::attach(
+    ch_channel* channels,
+    std::size_t active_channel,
+    std::size_t channel_count,
+    std::uint64_t* ring,
+    std::size_t ring_entries,
+    const ch_result* results,
+    std::size_t result_entries,
+    std::uint64_t* program,
+    std::size_t program_entries,
+    const std::uint8_t* levels,
+    std::size_t level_entries)
+{
+    assert(ring_entries > 0 && (ring_entries & (ring_entries - 1)) == 0);
+    assert(result_entries > 0 && (result_entries & (result_entries - 1)) == 0);
+    assert(level_entries > 0 && (level_entries & (level_entries - 1)) == 0);
+
+    channels_ = channels;
+    channels_address_ = reinterpret_cast<std::uintptr_t>(channels);
+    channels_physical_address_ = 0;
+    active_channel_ = active_channel;
+    channel_count_ = channel_count;
+    ring_ = ring;
+    ring_entries_ = ring_entries;
+    head_ = ch_channel_read_head(channels_ + active_channel_);
+    assert(ring_entries >= 2);
+    buffer_.resize(ring_entries_ / 2);
+    fill_start_ = ch_cycles();
+    agent_busy_ = false;
+    results_ = results;
+    result_entries_ = result_entries;
+    results_tail_ = results_head_ = 0;
+    program_ = program;
+    program_entries_ = program_entries;
+    program_used_ = 0;
+    blacklist_entries_ = 0;
+    levels_area_ = levels;
+    level_entries_ = level_entries;
+    levels_tail_ = levels_head_ = 0;
+    pending_.clear();
+
+    ring_addresses_ = {reinterpret_cast<std::uintptr_t>(ring)};
+    results_addresses_ = {reinterpret_cast<std::uintptr_t>(results)};
+    levels_addresses_ = {reinterpret_cast<std::uintptr_t>(levels)};
+    collision_sets_.clear();
+    ring_collisions_.clear();
+    result_collisions_.clear();
+    level_collisions_.clear();
+}
+
+void cachehound::detail::agent_memory_base::drain() noexcept
+{
+    flush();
+    wait_for_completion();
+}
+
+void cachehound::detail::agent_memory_base::terminate_agent() noexcept
+{
+    drain();
+    place_entry(ch_command_entry(CH_COMMAND_EXIT, 0));
+    ch_channel_publish_head(active_channel(), head_);
+    wait_for_completion();
+}
+
+bool cachehound::detail::agent_memory_base::valid_address(std::uintptr_t address)
+{
+    return (address >> (8 * sizeof(address) - reserved_upper_bits)) == upper_address_bits_
+        && address_checker_(address);
+}
+
+ch_channel* cachehound::detail::agent_memory_base::active_channel() const
+{
+    return channels_ + active_channel_;
+}
+
+void cachehound::detail::agent_memory_base::switch_channel(std::size_t channel) noexcept
+{
+    assert(channel < channel_count_);
+    if (channel == active_channel_)
+        return;
+
+    flush();
+    wait_for_completion();
+
+    // The agent continues on the new channel right after the switch command,
+    // its tail is only advanced by the agent once the switch took place
+    place_entry(ch_command_entry(CH_COMMAND_SWITCH_CHANNEL, channel));
+    auto next_channel = channels_ + channel;
+    ch_channel_init(next_channel, head_ - 1);
+    ch_channel_publish_head(next_channel, head_);
+
+    ch_channel_publish_head(active_channel(), head_);
+    active_channel_ = channel;
+    wait_for_completion();
+
+    stats_.channel_switches++;
+}
+
+void cachehound::detail::agent_memory_base::internal_access(std::uint64_t entry)
+{
+    if (recording_) {
+        program_buffer_.push_back(entry);
+        return;
+    }
+
+    buffer_[buffered_++] = entry;
+    if (buffered_ == buffer_.size()) {
+        flush();
+    }
+}
+
+void cachehound::detail::agent_memory_base::wait_for_completion() noexcept
+{
+    ch_channel_wait_for_tail(active_channel(), head_, static_cast<unsigned>(wait_policy_), &wait_stats_);
+    fill_start_ = ch_cycles();
+    agent_busy_ = false;
+    // A channel that was idle since the last switch still holds an older count
+    interrupts_ = std::max(interrupts_, active_channel()->interrupts);
+}
+
+void cachehound::detail::agent_memory_base::collect_results()
+{
+    flush();
+    wait_for_completion();
+
+    // The results were published by the agent before it advanced the tail
+    for (auto& pending : pending_) {
+        if (pending.skipped) {
+            (pending.classified ? levels_tail_ : results_tail_) += pending.count;
+            continue;
+        }
+        if (pending.classified) {
+            for (auto end = levels_tail_ + pending.count; levels_tail_ != end; levels_tail_++) {
+                levels_.push_back(levels_area_[levels_tail_ % level_entries_]);
+            }
+            continue;
+        }
+
+        // Decoded in at most two runs, as the results may wrap around
+        for (auto count = pending.count; count;) {
+            auto start = results_tail_ % result_entries_;
+            std::span<const ch_result> results{results_ + start, std::min(count, result_entries_ - start)};
+            pmu_decoder_(results, levels_);
+            raw_results_.insert(raw_results_.end(), results.begin(), results.end());
+            results_tail_ += results.size();
+            count -= results.size();
+        }
+    }
+    pending_.clear();
+}
+
+void cachehound::detail::agent_memory_base::expect_results(bool classified, std::size_t count, bool skipped)
+{
+    if (classified) {
+        levels_head_ += count;
+    } else {
+        results_head_ += count;
+    }
+
+    if (!pending_.empty() && pending_.back().classified == classified && pending_.back().skipped == skipped) {
+        pending_.back().count += count;
+    } else {
+        pending_.push_back({classified, count, skipped});
+    }
+}
+
+void cachehound::detail::agent_memory_base::skip_results(bool classified, std::size_t count)
+{
+    // Passes over slots until the next count ones lie on lines that do not
+    // collide, collecting first if the skipped slots are still to be read
+    auto& collisions = classified ? level_collisions_ : result_collisions_;
+    if (collisions.empty()) {
+        return;
+    }
+    auto head = classified ? levels_head_ : results_head_;
+    std::size_t skip = 0, free = 0;
+    while (free < count && skip + free < collisions.size()) {
+        if (collisions[(head + skip + free) % collisions.size()]) {
+            skip += free + 1;
+            free = 0;
+        } else {
+            free++;
+        }
+    }
+    if (!skip || free < count) {
+        return;
+    }
+
+    auto tail = classified ? levels_tail_ : results_tail_;
+    if (head - tail + skip + count > collisions.size()) {
+        collect_results();
+    }
+    internal_access(ch_command_entry(CH_COMMAND_SKIP_RESULTS, classified ? ch_command_fields(0, skip) : ch_command_fields(skip, 0)));
+    expect_results(classified, skip, true);
+    stats_.skipped_results += skip;
+}
+
+[[nodiscard]] unsigned cachehound::detail::agent_memory_base::levels() const noexcept
+{
+    return cache_info_.levels;
+}
+
+void cachehound::detail::agent_memory_base::access(std::uintptr_t address) noexcept
+{
+    assert(valid_address(address));
+    internal_access(ch_entry(CH_OP_ACCESS, address));
+    stats_.accesses++;
+}
+
+unsigned cachehound::detail::agent_memory_base::instrumented_access(std::uintptr_t address)
+{
+    assert(!recording_);
+    auto classified = classifying_;
+    enqueue_access(address, classified);
+    collect_results();
+
+    auto level = levels_.back();
+    levels_.pop_back();
+    if (!classified) {
+        last_result_ = raw_results_.back();
+        raw_results_.pop_back();
+    }
+    return level;
+}
+
+void cachehound::detail::agent_memory_base::access_many(std::span<const std::uintptr_t> addresses) noexcept
+{
+    for (auto address : addresses) {
+        assert(valid_address(address));
+        internal_access(ch_entry(CH_OP_ACCESS, address));
+    }
+    stats_.accesses += addresses.size();
+}
+
+void cachehound::detail::agent_memory_base::instrumented_access_many(std::span<const std::uintptr_t> addresses, std::span<unsigned> levels)
+{
+    assert(!recording_);
+    assert(addresses.size() == levels.size());
+    if (addresses.empty())
+        return;
+
+    auto classified = classifying_;
+    for (auto address : addresses) {
+        enqueue_access(address, classified);
+    }
+    collect_results();
+
+    // The batch was enqueued last, so its results are the last ones collected
+    auto first = levels_.end() - addresses.size();
+    std::copy(first, levels_.end(), levels.begin());
+    levels_.erase(first, levels_.end());
+    if (!classified) {
+        last_result_ = raw_results_.back();
+        raw_results_.erase(raw_results_.end() - addresses.size(), raw_results_.end());
+    }
+}
+
+std::uint64_t cachehound::detail::agent_memory_base::timed_access(std::uintptr_t address)
+{
+    assert(!recording_);
+    enqueue_access(address, false);
+    collect_results();
+
+    levels_.pop_back();
+    last_result_ = raw_results_.back();
+    raw_results_.pop_back();
+    return last_result_.cycles;
+}
+
+[[nodiscard]] const ch_result& cachehound::detail::agent_memory_base::last_result() const noexcept
+{
+    return last_result_;
+}
+
+void cachehound::detail::agent_memory_base::enqueue_instrumented_access(std::uintptr_t address)
+{
+    enqueue_access(address, classifying_);
+}
+
+void cachehound::detail::agent_memory_base::enqueue_access(std::uintptr_t address, bool classified)
+{
+    assert(valid_address(address));
+    auto op = classified ? CH_OP_CLASSIFIED_ACCESS : CH_OP_INSTRUMENTED_ACCESS;
+
+    if (recording_) {
+        internal_access(ch_entry(op, address));
+        program_instrumented_accesses_++;
+        return;
+    }
+
+    // Results of earlier instrumented accesses must be read before the agent
+    // reuses their slots
+    skip_results(classified, 1);
+    if (classified ? levels_head_ - levels_tail_ == level_entries_ : results_head_ - results_tail_ == result_entries_) {
+        collect_results();
+    }
+
+    internal_access(ch_entry(op, address));
+    expect_results(classified, 1);
+    stats_.instrumented_accesses++;
+}
+
+std::span<const unsigned> cachehound::detail::agent_memory_base::collect_instrumented_accesses()
+{
+    assert(!recording_);
+    collect_results();
+    std::swap(levels_, collected_levels_);
+    levels_.clear();
+    std::swap(raw_results_, collected_raw_results_);
+    raw_results_.clear();
+    return collected_levels_;
+}
+
+[[nodiscard]] std::span<const ch_result> cachehound::detail::agent_memory_base::collected_results() const noexcept
+{
+    return collected_raw_results_;
+}
+
+std::uint64_t cachehound::detail::agent_memory_base::ring_skip(std::uint64_t position) const noexcept
+{
+    // Entries that follow position up to the next slot on a line that does
+    // not collide, if the entry at position would land on a colliding line
+    // or right before one
+    auto collides = [&](std::uint64_t slot) { return ring_collisions_[slot % ring_entries_]; };
+    auto next = position + 1;
+    if (ring_collisions_.empty() || (!collides(position) && !collides(next))) {
+        return 0;
+    }
+    while (collides(next)) {
+        next++;
+    }
+    return next - position - 1;
+}
+
+void cachehound::detail::agent_memory_base::place_entry(std::uint64_t entry) noexcept
+{
+    // The slot at head_ takes the skip command, unless it collides itself
+    // there is no way around it
+    if (auto skip = ring_skip(head_)) {
+        ring_[head_++ % ring_entries_] = ch_command_entry(CH_COMMAND_SKIP, skip);
+        head_ += skip;
+        stats_.skipped_entries += skip;
+    }
+    ring_[head_++ % ring_entries_] = entry;
+}
+
+inline void cachehound::detail::agent_memory_base::flush() noexcept
+{
+    if (buffered_) {
+        assert(buffered_ <= buffer_.size());
+        auto now = ch_cycles();
+        stats_.fill_cycles += now - fill_start_;
+        if (agent_busy_) {
+            // The agent executed the preceding batch until its tail was published
+            auto tail = ch_channel_read_tail(active_channel());
+            auto busy_until = tail == head_ ? std::min(now, _ch_channel_read_tail_timestamp(active_channel())) : now;
+            stats_.overlap_cycles += busy_until > fill_start_ ? busy_until - fill_start_ : 0;
+            stats_.overlapped_flushes += tail != head_;
+        }
+
+        // Slots are reused once the agent moved past the batch before the
+        // preceding one, which may still be executing. Skipped slots extend
+        // the batch by less than a quarter of the ring.
+        auto end = head_ + buffered_;
+        if (!ring_collisions_.empty()) {
+            end = head_;
+            for (std::size_t i = 0; i < buffered_; i++) {
+                auto skip = ring_skip(end);
+                end += skip + (skip != 0) + 1;
+            }
+        }
+        if (end > ring_entries_) {
+            ch_channel_wait_for_progress(active_channel(), end - ring_entries_, static_cast<unsigned>(wait_policy_), &wait_stats_);
+        }
+        if (ring_collisions_.empty()) {
+            auto first = head_ % ring_entries_;
+            auto contiguous = std::min(buffered_, ring_entries_ - first);
+            std::copy(buffer_.begin(), buffer_.begin() + contiguous, ring_ + first);
+            std::copy(buffer_.begin() + contiguous, buffer_.begin() + buffered_, ring_);
+            head_ = end;
+        } else {
+            for (std::size_t i = 0; i < buffered_; i++) {
+                place_entry(buffer_[i]);
+            }
+        }
+
+        ch_channel_publish_head(active_channel(), head_);
+        buffered_ = 0;
+        stats_.flushes++;
+        fill_start_ = ch_cycles();
+        agent_busy_ = true;
+    }
+}
+
+cachehound::detail::agent_memory_base::stats_type cachehound::detail::agent_memory_base::stats() const noexcept {
+    auto stats = stats_;
+    stats.waits = wait_stats_.waits;
+    stats.wait_sleeps = wait_stats_.sleeps;
+    stats.wait_latency_sum = wait_stats_.latency_sum;
+    stats.wait_latency_max = wait_stats_.latency_max;
+
+    // Published by the agent together with its latest tail
+    auto agent_wait = active_channel()->agent_wait;
+    stats.agent_waits = agent_wait.waits;
+    stats.agent_wait_sleeps = agent_wait.sleeps;
+    stats.agent_wait_latency_sum = agent_wait.latency_sum;
+    stats.agent_wait_latency_max = agent_wait.latency_max;
+    return stats;
+}
+
+void cachehound::detail::agent_memory_base::begin_program()
+{
+    assert(!recording_);
+    recording_ = true;
+    program_buffer_.clear();
+    program_instrumented_accesses_ = 0;
+    recording_stats_ = stats_;
+}
+
+cachehound::detail::agent_memory_base::program_type cachehound::detail::agent_memory_base::end_program()
+{
+    assert(recording_ && !repeating_);
+    recording_ = false;
+    stats_ = recording_stats_;
+
+    auto available = program_entries_ - blacklist_entries_ - program_used_;
+    if (program_buffer_.size() > available) {
+        throw std::length_error("Program of " + std::to_string(program_buffer_.size()) + " entries exceeds the remaining "
+            + std::to_string(available) + " entries of the program area");
+    }
+    auto slots = classifying_ ? level_entries_ : result_entries_;
+    if (program_instrumented_accesses_ > slots) {
+        throw std::length_error("Program of " + std::to_string(program_instrumented_accesses_) + " instrumented accesses exceeds the "
+            + std::to_string(slots) + " result slots");
+    }
+
+    // The agent only reads the program once a run was submitted, which
+    // publishes these writes
+    program_type program{program_used_, program_buffer_.size(), program_instrumented_accesses_, classifying_};
+    std::copy(program_buffer_.begin(), program_buffer_.end(), program_ + program_used_);
+    program_used_ += program_buffer_.size();
+    return program;
+}
+
+void cachehound::detail::agent_memory_base::run_program(const program_type& program)
+{
+    assert(!recording_);
+    assert(program.offset + program.length <= program_used_);
+
+    skip_results(program.classified, program.instrumented_accesses);
+    if (program.classified ? levels_head_ - levels_tail_ + program.instrumented_accesses > level_entries_
+                           : results_head_ - results_tail_ + program.instrumented_accesses > result_entries_) {
+        collect_results();
+    }
+
+    internal_access(ch_command_entry(CH_COMMAND_RUN_PROGRAM, ch_command_fields(program.offset, program.length)));
+    if (program.instrumented_accesses) {
+        expect_results(program.classified, program.instrumented_accesses);
+    }
+    stats_.program_runs++;
+}
+
+void cachehound::detail::agent_memory_base::clear_programs() noexcept
+{
+    assert(!recording_);
+    // Runs already submitted must not observe the programs being overwritten
+    drain();
+    program_used_ = 0;
+}
+
+void cachehound::detail::agent_memory_base::begin_repeat(std::size_t repetitions)
+{
+    assert(recording_ && !repeating_);
+    if (repetitions > CH_REPEAT_MAX) {
+        throw std::length_error(std::to_string(repetitions) + " repetitions exceed the maximum of "
+            + std::to_string(CH_REPEAT_MAX));
+    }
+    repeating_ = true;
+    repeat_start_ = program_buffer_.size();
+    repeat_instrumented_accesses_ = program_instrumented_accesses_;
+    // Placeholder for the repeat command, see end_repeat()
+    program_buffer_.push_back(0);
+}
+
+void cachehound::detail::agent_memory_base::end_repeat(std::size_t repetitions)
+{
+    assert(repeating_);
+    repeating_ = false;
+
+    auto body_length = program_buffer_.size() - repeat_start_ - 1;
+    assert(body_length <= CH_COMMAND_FIELD_MASK);
+    program_buffer_[repeat_start_] = ch_command_entry(CH_COMMAND_REPEAT, ch_command_fields(body_length, repetitions));
+
+    auto body_instrumented_accesses = program_instrumented_accesses_ - repeat_instrumented_accesses_;
+    program_instrumented_accesses_ = repeat_instrumented_accesses_ + repetitions * body_instrumented_accesses;
+}
+
+void cachehound::detail::agent_memory_base::seed(std::uint64_t seed) noexcept
+{
+    internal_access(ch_command_entry(CH_COMMAND_SEED, seed));
+}
+
+void cachehound::detail::agent_memory_base::random_accesses(std::size_t count) noexcept
+{
+    // The agent performs at most CH_RANDOM_ACCESS_MAX per command
+    for (auto remaining = count; remaining;) {
+        auto accesses = std::min<std::size_t>(remaining, CH_RANDOM_ACCESS_MAX);
+        internal_access(ch_command_entry(CH_COMMAND_RANDOM_ACCESS, accesses));
+        remaining -= accesses;
+    }
+    stats_.accesses += count;
+}
+
+void cachehound::detail::agent_memory_base::reload_lines() noexcept
+{
+    assert(!recording_);
+    internal_access(ch_command_entry(CH_COMMAND_RELOAD_LINES, 0));
+}
+
+void cachehound::detail::agent_memory_base::random_access_blacklist(std::span<const std::uintptr_t> addresses)
+{
+    assert(!recording_);
+    if (addresses.size() > program_entries_ - program_used_) {
+        throw std::length_error("Blacklist of " + std::to_string(addresses.size()) + " addresses exceeds the remaining "
+            + std::to_string(program_entries_ - program_used_) + " entries of the program area");
+    }
+
+    // Random accesses submitted thus far must not observe the new blacklist
+    drain();
+
+    auto offset = program_entries_ - addresses.size();
+    auto line_mask = ~((std::uintptr_t{1} << offset_bits()) - 1);
+    std::transform(addresses.begin(), addresses.end(), program_ + offset, [line_mask](auto address) {
+        return address & line_mask;
+    });
+    // The agent rejects blacklists that do not strictly ascend
+    std::sort(program_ + offset, program_ + program_entries_);
+    auto length = static_cast<std::size_t>(std::unique(program_ + offset, program_ + program_entries_) - (program_ + offset));
+    blacklist_entries_ = addresses.size();
+
+    internal_access(ch_command_entry(CH_COMMAND_BLACKLIST, ch_command_fields(offset, length)));
+}
+
+void cachehound::detail::agent_memory_base::barrier() noexcept
+{
+    internal_access(ch_command_entry(CH_COMMAND_BARRIER, 0));
+}
+
+void cachehound::detail::agent_memory_base::set_serialization(serialization_profile profile) noexcept
+{
+    assert(!recording_);
+    internal_access(ch_command_entry(CH_COMMAND_SERIALIZATION, static_cast<unsigned>(profile)));
+    serialization_ = profile;
+}
+
+cachehound::detail::agent_memory_base::serialization_profile cachehound::detail::agent_memory_base::serialization() const noexcept
+{
+    return serialization_;
+}
+
+std::uint64_t cachehound::detail::agent_memory_base::interrupts() const noexcept
+{
+    return interrupts_;
+}
+
+void cachehound::detail::agent_memory_base::set_interrupt_gap(std::uint64_t cycles) noexcept
+{
+    assert(!recording_);
+    assert(cycles <= CH_COMMAND_FIELD_MASK);
+    internal_access(ch_command_entry(CH_COMMAND_INTERRUPT_GAP, cycles));
+}
+
+cachehound::detail::agent_memory_base::chain_type cachehound::detail::agent_memory_base::link_chain(std::span<const std::uintptr_t> addresses)
+{
+    assert(!recording_);
+    assert(!addresses.empty() && addresses.size() <= CH_COMMAND_FIELD_MASK);
+    // The agent skips chains with lines it does not own
+    for (auto address : addresses) {
+        if (!valid_address(address)) {
+            throw std::invalid_argument("Address " + std::to_string(address) + " of the chain lies outside the regions");
+        }
+    }
+
+    auto available = program_entries_ - blacklist_entries_ - program_used_;
+    if (addresses.size() > available) {
+        throw std::length_error("Chain of " + std::to_string(addresses.size()) + " addresses exceeds the remaining "
+            + std::to_string(available) + " entries of the program area");
+    }
+
+    // Published by the submission of the link command like programs
+    chain_type chain{program_used_, addresses.size()};
+    std::copy(addresses.begin(), addresses.end(), program_ + program_used_);
+    program_used_ += addresses.size();
+
+    internal_access(ch_command_entry(CH_COMMAND_LINK, ch_command_fields(chain.offset, chain.length)));
+    return chain;
+}
+
+void cachehound::detail::agent_memory_base::chase(const chain_type& chain, std::size_t hops) noexcept
+{
+    assert(chain.offset + chain.length <= program_used_);
+    assert(hops < (std::uint64_t{1} << (CH_OP_SHIFT - CH_COMMAND_SHIFT - CH_COMMAND_FIELD_BITS)));
+    internal_access(ch_command_entry(CH_COMMAND_CHASE, ch_command_fields(chain.offset, hops)));
+    stats_.accesses += hops;
+}
+
+void cachehound::detail::agent_memory_base::set_pmu_profile(const pmu_profile& profile)
+{
+    assert(!recording_);
+    if (profile.rules.size() > CH_PMU_MAX_RULES) {
+        throw std::length_error("PMU profile of " + std::to_string(profile.rules.size()) + " rules exceeds "
+            + std::to_string(CH_PMU_MAX_RULES) + " rules");
+    }
+    for (auto& rule : profile.rules) {
+        if (rule.counter >= CH_RESULT_COUNTERS || rule.level >= CH_LEVEL_UNCLASSIFIED) {
+            throw std::invalid_argument("Invalid rule of PMU profile for counter " + std::to_string(rule.counter)
+                + " and level " + std::to_string(rule.level));
+        }
+    }
+
+    internal_access(ch_command_entry(CH_COMMAND_PMU_PROFILE, profile.rules.size()));
+    for (auto& rule : profile.rules) {
+        internal_access(ch_command_entry(CH_COMMAND_PMU_RULE,
+            ch_pmu_rule_fields(rule.counter, static_cast<unsigned>(rule.when), rule.level)));
+    }
+    classifying_ = !profile.rules.empty();
+}
+
+std::uint8_t cachehound::detail::agent_memory_base::offset_bits() const noexcept
+{
+    return cache_info_.offset_bits;
+}
+
+std::uint8_t cachehound::detail::agent_memory_base::index_bits(unsigned level) const noexcept
+{
+    assert(level < 3);
+    auto sets = cache_info_.sets[level];
+    assert(sets != 0);
+    if((sets & (sets - 1)) != 0) {
+        // Adjust for power-of-two for now
+        // TODO: Rename index_bits(level) -> sets(level) to allow for non-power-of-two sets.
+        --sets;
+        sets |= (sets >> 1);
+        sets |= (sets >> 2);
+        sets |= (sets >> 4);
+        sets |= (sets >> 8);
+        sets |= (sets >> 16);
+        // sets |= (sets >> 32);
+        ++sets;
+    }
+    return std::countr_zero(sets);
+}
+
+std::size_t cachehound::detail::agent_memory_base::ways(unsigned level) const noexcept
+{
+    assert(level < 3);
+    return cache_info_.ways[level];
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+void cachehound::detail::agent_memory_base::clflush(std::uintptr_t address) noexcept
+{
+    internal_access(ch_entry(CH_OP_CLFLUSH, address));
+    stats_.clflushes++;
+}
+
+void cachehound::detail::agent_memory_base::wbinvd() noexcept
+{
+    internal_access(ch_command_entry(CH_COMMAND_WBINVD, 0));
+    stats_.wbinvds++;
+}
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+void cachehound::detail::agent_memory_base::internal_cisw(bool clean, bool invalidate, unsigned level, std::size_t set, std::size_t way)
+{
+    assert(clean || invalidate);
+    assert(level < levels());
+
+    auto way_bits = std::countr_zero(std::bit_ceil(ways(level)));
+
+    std::uint64_t set_way = static_cast<std::uint32_t>(level) << 1;
+    set_way |= (static_cast<std::uint32_t>(way) << (32 - way_bits));
+    set_way |= (static_cast<std::uint32_t>(set) << offset_bits());
+
+    auto op = clean ? (invalidate ? CH_OP_CISW : CH_OP_CSW) : CH_OP_ISW;
+    internal_access(ch_entry(op, set_way));
+}
+
+void cachehound::detail::agent_memory_base::csw(unsigned level, std::size_t set, std::size_t way)
+{
+    internal_cisw(true, false, level, set, way);
+    stats_.csws++;
+}
+
+void cachehound::detail::agent_memory_base::isw(unsigned level, std::size_t set, std::size_t way)
+{
+    internal_cisw(false, true, level, set, way);
+    stats_.isws++;
+}
+
+void cachehound::detail::agent_memory_base::cisw(unsigned level, std::size_t set, std::size_t way)
+{
+    internal_cisw(true, true, level, set, way);
+    stats_.cisws++;
+}
+
+void cachehound::detail::agent_memory_base::internal_cisw_sets(bool clean, bool invalidate, unsigned level, std::size_t first_set, std::size_t end_set)
+{
+    assert(clean || invalidate);
+    assert(level < levels());
+    assert(first_set <= end_set && end_set <= (std::size_t{1} << index_bits(level)));
+
+    unsigned flags = (clean ? CH_MAINTAIN_CLEAN : 0) | (invalidate ? CH_MAINTAIN_INVALIDATE : 0);
+    internal_access(ch_command_entry(CH_COMMAND_MAINTAIN_SETS, ch_maintenance_fields(flags, level, first_set, end_set)));
+}
+
+void cachehound::detail::agent_memory_base::csw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+{
+    internal_cisw_sets(true, false, level, first_set, end_set);
+    stats_.csws += (end_set - first_set) * ways(level);
+}
+
+void cachehound::detail::agent_memory_base::isw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+{
+    internal_cisw_sets(false, true, level, first_set, end_set);
+    stats_.isws += (end_set - first_set) * ways(level);
+}
+
+void cachehound::detail::agent_memory_base::cisw_sets(unsigned level, std::size_t first_set, std::size_t end_set)
+{
+    internal_cisw_sets(true, true, level, first_set, end_set);
+    stats_.cisws += (end_set - first_set) * ways(level);
+}
+
+void cachehound::detail::agent_memory_base::cisw_level(unsigned level)
+{
+    assert(level < levels());
+
+    internal_access(ch_command_entry(CH_COMMAND_MAINTAIN_LEVEL, ch_maintenance_fields(CH_MAINTAIN_CLEAN | CH_MAINTAIN_INVALIDATE, level, 0, 0)));
+    stats_.cisws += (std::size_t{1} << index_bits(level)) * ways(level);
+}
+
+void cachehound::detail::agent_memory_base::reset()
+{
+    for (unsigned level = 0; level < levels(); level++) {
+        cisw_level(level);
+    }
+    flush();
+}
+#endif
+
+void cachehound::detail::agent_memory_base::switch_channel() noexcept
+{
+    switch_channel((active_channel_ + 5) % channel_count_);
+}
+
+void cachehound::detail::agent_memory_base::set_channel_placement(std::vector<any_placement_policy> placements, bool physical)
+{
+    if (physical && (!channels_physical_address_ || ring_addresses_.physical_pages.empty()
+            || results_addresses_.physical_pages.empty() || levels_addresses_.physical_pages.empty())) {
+        throw std::invalid_argument("Physical addresses of the channels, ring, results or levels are unknown");
+    }
+    channel_placements_ = std::move(placements);
+    physical_channel_placement_ = physical;
+    collision_sets_.clear();
+    ring_collisions_.clear();
+    result_collisions_.clear();
+    level_collisions_.clear();
+}
+
+bool cachehound::detail::agent_memory_base::channel_collides(std::size_t channel, std::span<const std::uintptr_t> addresses) const
+{
+    auto base = (physical_channel_placement_ ? channels_physical_address_ : channels_address_) + channel * sizeof(ch_channel);
+    for (auto& placement : channel_placements_) {
+        for (auto line = base; line < base + sizeof(ch_channel); line += CH_CACHE_LINE_SIZE) {
+            auto set = placement(line);
+            if (std::ranges::any_of(addresses, [&](auto address) { return placement(address) == set; })) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void cachehound::detail::agent_memory_base::update_area_collisions(std::span<const std::uintptr_t> addresses)
+{
+    std::vector<std::pair<std::size_t, std::size_t>> sets;
+    for (std::size_t i = 0; i < channel_placements_.size(); i++) {
+        for (auto address : addresses) {
+            sets.emplace_back(i, channel_placements_[i](address));
+        }
+    }
+    std::ranges::sort(sets);
+    sets.erase(std::unique(sets.begin(), sets.end()), sets.end());
+    if (sets == collision_sets_) {
+        return;
+    }
+    collision_sets_ = std::move(sets);
+
+    auto collisions = [&](const area_addresses& area, std::size_t slots, std::size_t slot_size) {
+        std::vector<bool> slot_collides(slots);
+        bool any = false;
+        for (std::size_t offset = 0; offset < slots * slot_size; offset += CH_CACHE_LINE_SIZE) {
+            auto line = physical_channel_placement_
+                ? area.physical_pages[offset / area.page_size] + offset % area.page_size
+                : area.address + offset;
+            for (std::size_t i = 0; i < channel_placements_.size(); i++) {
+                if (std::ranges::binary_search(collision_sets_, std::pair{i, channel_placements_[i](line)})) {
+                    std::fill(slot_collides.begin() + offset / slot_size, slot_collides.begin() + (offset + CH_CACHE_LINE_SIZE - 1) / slot_size + 1, true);
+                    any = true;
+                    break;
+                }
+            }
+        }
+        return any ? slot_collides : std::vector<bool>{};
+    };
+    ring_collisions_ = collisions(ring_addresses_, ring_entries_, sizeof(std::uint64_t));
+    result_collisions_ = collisions(results_addresses_, result_entries_, sizeof(ch_result));
+    level_collisions_ = collisions(levels_addresses_, level_entries_, sizeof(std::uint8_t));
+
+    // Beyond a quarter of the ring, skipping could make a batch overrun the
+    // entries the agent still has to execute
+    if (static_cast<std::size_t>(std::ranges::count(ring_collisions_, true)) > ring_entries_ / 4) {
+        ring_collisions_.clear();
+    }
+}
+
+void cachehound::detail::agent_memory_base::avoid_channel_conflicts(std::span<const std::uintptr_t> addresses)
+{
+    update_area_collisions(addresses);
+    if (!channel_collides(active_channel_, addresses)) {
+        return;
+    }
+    stats_.channel_collisions++;
+
+    // Probe the channels in the order of switch_channel()
+    auto channel = active_channel_;
+    for (std::size_t i = 1; i < channel_count_; i++) {
+        channel = (channel + 5) % channel_count_;
+        if (!channel_collides(channel, addresses)) {
+            switch_channel(channel);
+            return;
+        }
+    }
+    stats_.unavoidable_channel_collisions++;
+}
+
+#endif /* CACHEHOUND_BACKENDS_IMPL_AGENT_MEMORY_BASE_IPP */
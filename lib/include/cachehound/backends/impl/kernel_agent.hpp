@@ -0,0 +1,25 @@
+#ifndef CACHEHOUND_BACKENDS_IMPL_KERNEL_AGENT_HPP
+#define CACHEHOUND_BACKENDS_IMPL_KERNEL_AGENT_HPP
+
+namespace cachehound {
+
+cachehound::kernel_agent::kernel_agent(
+    const kernel_agent& sibling,
+    unsigned cpu,
+    static_pmu_profile auto profile,
+    isolation_level isolation,
+    wait_policy agent_wait,
+    wait_policy wait) : kernel_agent(duplicate_fd(sibling.fd_), &decltype(profile)::decode, wait)
+{
+    using profile_type = decltype(profile);
+    static_assert(profile_type::events.size() <= CH_RESULT_COUNTERS);
+
+    regions_ = sibling.regions_;
+    address_checker_ = sibling.address_checker_;
+    cache_info_ = sibling.cache_info_;
+    start(cpu, profile_type::events, isolation, agent_wait);
+}
+
+}
+
+#endif
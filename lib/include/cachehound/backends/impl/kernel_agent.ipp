@@ -0,0 +1,195 @@
+#ifndef CACHEHOUND_BACKENDS_IMPL_KERNEL_AGENT_IPP
+#define CACHEHOUND_BACKENDS_IMPL_KERNEL_AGENT_IPP
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+#include "../kernel_agent.hpp"
+
+cachehound::kernel_agent::kernel_agent(int fd, pmu_decoder* decoder, wait_policy wait)
+    : agent_memory_base(decoder, wait)
+    , fd_(fd)
+{
+}
+
+int cachehound::kernel_agent::duplicate_fd(int fd)
+{
+    int duplicate = dup(fd);
+    if (duplicate < 0) {
+        std::string msg = "Failed to duplicate file descriptor of /dev/" CH_DEVICE_NAME ": ";
+        msg += strerror(errno);
+        throw std::runtime_error(msg);
+    }
+    return duplicate;
+}
+
+ch_channel* cachehound::kernel_agent::mmap_channels(int fd, int page_size, unsigned agent)
+{
+    auto channels_ptr = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, CH_MMAP_AGENT_PGOFF(agent) * page_size);
+    if (channels_ptr == MAP_FAILED) {
+        throw std::runtime_error("mmap of channels failed");
+    }
+    return reinterpret_cast<ch_channel*>(channels_ptr);
+}
+
+std::uint64_t* cachehound::kernel_agent::mmap_ring(int fd, int page_size, unsigned agent, std::size_t ring_entries)
+{
+    assert(ring_entries > 0 && (ring_entries & (ring_entries - 1)) == 0);
+    auto ring_ptr = mmap(NULL, ring_entries * sizeof(std::uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, (CH_MMAP_AGENT_PGOFF(agent) + CH_MMAP_RING_PGOFF) * page_size);
+    if (ring_ptr == MAP_FAILED) {
+        throw std::runtime_error("mmap of submission ring failed");
+    }
+    return reinterpret_cast<std::uint64_t*>(ring_ptr);
+}
+
+const ch_result* cachehound::kernel_agent::mmap_results(int fd, int page_size, unsigned agent, std::size_t result_entries)
+{
+    assert(result_entries > 0 && (result_entries & (result_entries - 1)) == 0);
+    auto results_ptr = mmap(NULL, result_entries * sizeof(ch_result), PROT_READ, MAP_SHARED, fd, (CH_MMAP_AGENT_PGOFF(agent) + CH_MMAP_RESULTS_PGOFF) * page_size);
+    if (results_ptr == MAP_FAILED) {
+        throw std::runtime_error("mmap of results failed");
+    }
+    return reinterpret_cast<const ch_result*>(results_ptr);
+}
+
+std::uint64_t* cachehound::kernel_agent::mmap_program(int fd, int page_size, unsigned agent, std::size_t program_entries)
+{
+    auto program_ptr = mmap(NULL, program_entries * sizeof(std::uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, (CH_MMAP_AGENT_PGOFF(agent) + CH_MMAP_PROGRAM_PGOFF) * page_size);
+    if (program_ptr == MAP_FAILED) {
+        throw std::runtime_error("mmap of program area failed");
+    }
+    return reinterpret_cast<std::uint64_t*>(program_ptr);
+}
+
+const std::uint8_t* cachehound::kernel_agent::mmap_levels(int fd, int page_size, unsigned agent, std::size_t level_entries)
+{
+    auto levels_ptr = mmap(NULL, level_entries, PROT_READ, MAP_SHARED, fd, (CH_MMAP_AGENT_PGOFF(agent) + CH_MMAP_LEVELS_PGOFF) * page_size);
+    if (levels_ptr == MAP_FAILED) {
+        throw std::runtime_error("mmap of levels area failed");
+    }
+    return reinterpret_cast<const std::uint8_t*>(levels_ptr);
+}
+
+void cachehound::kernel_agent::start_agent(int fd, ch_ioc_start_config& config)
+{
+    int ret = ioctl(fd, CH_IOC_START_AGENT, &config);
+    if (ret < 0) {
+        std::string msg = "Failed to start agent: ";
+        msg += strerror(errno);
+        throw std::runtime_error(msg);
+    }
+}
+
+void cachehound::kernel_agent::start(unsigned cpu, std::span<const std::uint64_t> pmu_events, isolation_level isolation, wait_policy agent_wait)
+{
+    auto page_size = sysconf(_SC_PAGE_SIZE);
+
+    ch_ioc_start_config config {
+        .cpu = cpu,
+        .isolation_level = static_cast<std::underlying_type_t<isolation_level>>(isolation),
+        .wait_policy = static_cast<unsigned>(agent_wait)
+    };
+    std::copy(pmu_events.begin(), pmu_events.end(), config.evts);
+    start_agent(fd_, config);
+
+    agent_ = config.agent;
+    counters_ = config.counters;
+    fixed_counters_ = config.fixed_counters;
+    node_ = config.node;
+    attach(
+        mmap_channels(fd_, page_size, agent_), config.active_channel, config.channel_count,
+        mmap_ring(fd_, page_size, agent_, config.ring_entries), config.ring_entries,
+        mmap_results(fd_, page_size, agent_, config.result_entries), config.result_entries,
+        mmap_program(fd_, page_size, agent_, config.program_entries), config.program_entries,
+        mmap_levels(fd_, page_size, agent_, config.level_entries), config.level_entries);
+    // The agent accesses the channels, ring, results and levels through the
+    // kernel mapping, each of them is physically contiguous
+    channels_address_ = config.channels_base;
+    channels_physical_address_ = config.channels_physical_base;
+    auto contiguous = [&](std::uintptr_t address, std::uintptr_t physical_address, std::size_t size) {
+        area_addresses area{address, static_cast<std::size_t>(page_size)};
+        for (std::size_t offset = 0; offset < size; offset += page_size) {
+            area.physical_pages.push_back(physical_address + offset);
+        }
+        return area;
+    };
+    ring_addresses_ = contiguous(config.ring_base, config.ring_physical_base, ring_entries_ * sizeof(std::uint64_t));
+    results_addresses_ = contiguous(config.results_base, config.results_physical_base, result_entries_ * sizeof(ch_result));
+    levels_addresses_ = contiguous(config.levels_base, config.levels_physical_base, level_entries_);
+}
+
+cachehound::kernel_agent::~kernel_agent() noexcept
+{
+    // The agents terminate once the device is released
+    if (channels_) {
+        drain();
+        munmap(const_cast<std::uint8_t*>(levels_area_), level_entries_);
+        munmap(program_, program_entries_ * sizeof(std::uint64_t));
+        munmap(const_cast<ch_result*>(results_), result_entries_ * sizeof(ch_result));
+        munmap(ring_, ring_entries_ * sizeof(std::uint64_t));
+        munmap(channels_, sysconf(_SC_PAGE_SIZE));
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+[[nodiscard]] const std::vector<cachehound::kernel_agent::region_type>& cachehound::kernel_agent::regions() const noexcept
+{
+    return regions_;
+}
+
+[[nodiscard]] unsigned cachehound::kernel_agent::agent() const noexcept
+{
+    return agent_;
+}
+
+[[nodiscard]] unsigned cachehound::kernel_agent::counters() const noexcept
+{
+    return counters_;
+}
+
+[[nodiscard]] unsigned cachehound::kernel_agent::fixed_counters() const noexcept
+{
+    return fixed_counters_;
+}
+
+unsigned cachehound::kernel_agent::quiesce_siblings(bool enable)
+{
+    drain();
+
+    ch_ioc_quiesce_config config {
+        .agent = agent_,
+        .enable = enable
+    };
+    if (ioctl(fd_, CH_IOC_QUIESCE_SIBLINGS, &config) < 0) {
+        std::string msg = "Failed to quiesce SMT siblings: ";
+        msg += strerror(errno);
+        throw std::runtime_error(msg);
+    }
+    return config.parked;
+}
+
+[[nodiscard]] int cachehound::kernel_agent::node() const noexcept
+{
+    return node_;
+}
+
+ch_agent_stats cachehound::kernel_agent::agent_stats()
+{
+    drain();
+    ch_ioc_agent_stats query{};
+    query.agent = agent_;
+    if (ioctl(fd_, CH_IOC_AGENT_STATS, &query) < 0) {
+        std::string msg = "Failed to query stats of agent: ";
+        msg += strerror(errno);
+        throw std::runtime_error(msg);
+    }
+    return query.stats;
+}
+
+#endif /* CACHEHOUND_BACKENDS_IMPL_KERNEL_AGENT_IPP */
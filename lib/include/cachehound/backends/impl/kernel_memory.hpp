@@ -6,68 +6,54 @@ namespace cachehound {
 cachehound::kernel_memory::kernel_memory(
     std::size_t min_size,
     unsigned cpu,
-    auto&& pmu_events,
-    std::function<pmu_handler_type> pmu_handler,
+    static_pmu_profile auto profile,
     isolation_level isolation,
-    unsigned max_order) : pmu_handler_(pmu_handler)
+    wait_policy agent_wait,
+    wait_policy wait,
+    unsigned max_order) : kernel_agent(obtain_ch_fd(), &decltype(profile)::decode, wait)
+    , cpu_(cpu)
+    , max_order_(max_order)
 {
     assert(min_size > 0);
 
-    std::vector<std::uint64_t> pmu_events_vec(std::forward<decltype(pmu_events)>(pmu_events));
-    assert(pmu_events_vec.size() <= 3);
+    using profile_type = decltype(profile);
+    static_assert(profile_type::events.size() <= CH_RESULT_COUNTERS);
 
-    auto page_size = sysconf(_SC_PAGE_SIZE);
+    alloc_regions(min_size);
+    defragment_regions();
 
-    auto fd = obtain_ch_fd();
-    try {
-        unsigned order = max_order;
-
-        while (min_size) {
-            // auto pages_required = (min_size + page_size - 1) / page_size;
-            // unsigned order = std::countr_zero(std::bit_ceil(pages_required));
+    for(auto& region : regions_) {
+        address_checker_.add_region(region);
+    }
 
-            ch_ioc_alloc_config config {
-                .order = order
-            };
-            if(!alloc_region(fd, config)){
-                // failed to allocate 2^order pages
-                // Try to decrement order
-                if(order == 0) {
-                    throw std::runtime_error("Failed to allocate memory");
-                }
-                order--;
-                continue;
-            }
+    read_cache_info(fd_, cache_info_);
+    start(cpu, profile_type::events, isolation, agent_wait);
+}
 
-            std::size_t size = (1 << order) * page_size;
-            regions_.emplace_back(config.virtual_base, config.physical_base, size);
-            min_size -= std::min(min_size, size);
-        }
-        defragment_regions();
+cachehound::kernel_memory::kernel_memory(
+    std::span<std::byte> buffer,
+    unsigned cpu,
+    static_pmu_profile auto profile,
+    isolation_level isolation,
+    wait_policy agent_wait,
+    wait_policy wait) : kernel_agent(obtain_ch_fd(), &decltype(profile)::decode, wait)
+    , cpu_(cpu)
+{
+    assert(!buffer.empty());
 
-        for(auto& region : regions_) {
-            address_checker_.add_region(region);
-        }
+    using profile_type = decltype(profile);
+    static_assert(profile_type::events.size() <= CH_RESULT_COUNTERS);
 
-        read_cache_info(fd, cache_info_);
+    pin_buffer(buffer);
+    defragment_regions();
 
-        ch_ioc_start_config config {
-            .cpu = cpu,
-            .isolation_level = static_cast<std::underlying_type_t<isolation_level>>(isolation)
-        };
-        std::copy(pmu_events.begin(), pmu_events.end(), config.evts);
-        start_agent(fd, config);
-        channels_ = mmap_channels(fd, page_size);
-        active_channel_ = config.active_channel;
-        channel_count_ = config.channel_count;
-        close(fd);
-    } catch (std::exception& ex) {
-        close(fd);
-        throw ex;
+    for(auto& region : regions_) {
+        address_checker_.add_region(region);
     }
-}
-
 
+    read_cache_info(fd_, cache_info_);
+    start(cpu, profile_type::events, isolation, agent_wait);
+}
 
 }
 
@@ -0,0 +1,78 @@
+#ifndef CACHEHOUND_BACKENDS_IMPL_PERF_COUNTERS_IPP
+#define CACHEHOUND_BACKENDS_IMPL_PERF_COUNTERS_IPP
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+#include "../detail/perf_counters.hpp"
+
+cachehound::detail::perf_counters::perf_counters(std::span<const std::uint64_t> events) noexcept
+{
+    fds_.fill(-1);
+
+    for (auto event : events) {
+        if (event == 0 || count_ == fds_.size())
+            break;
+
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_RAW;
+#if defined(__x86_64__) || defined(_M_X64)
+        // Events are given as IA32_PERFEVTSELx values, perf manages the
+        // USR, OS, INT and EN bits itself
+        attr.config = event & ~((1ULL << 16) | (1ULL << 17) | (1ULL << 20) | (1ULL << 22));
+#else
+        attr.config = event;
+#endif
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        int group_fd = count_ ? fds_[0] : -1;
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+        if (fd < 0) {
+            // Fall back to the null counter source
+            close_all();
+            return;
+        }
+        fds_[count_++] = fd;
+    }
+}
+
+void cachehound::detail::perf_counters::close_all() noexcept
+{
+    for (unsigned i = 0; i < count_; i++) {
+        close(fds_[i]);
+    }
+    fds_.fill(-1);
+    count_ = 0;
+}
+
+cachehound::detail::perf_counters::~perf_counters() noexcept
+{
+    close_all();
+}
+
+bool cachehound::detail::perf_counters::available() const noexcept
+{
+    return count_ > 0;
+}
+
+void cachehound::detail::perf_counters::read(std::array<std::uint64_t, CH_RESULT_COUNTERS>& values) noexcept
+{
+    values.fill(0);
+    if (!count_)
+        return;
+
+    // Layout of PERF_FORMAT_GROUP: number of events followed by their values
+    std::array<std::uint64_t, 1 + CH_RESULT_COUNTERS> buffer;
+    if (::read(fds_[0], buffer.data(), (1 + count_) * sizeof(std::uint64_t)) < 0)
+        return;
+    std::copy(buffer.begin() + 1, buffer.begin() + 1 + count_, values.begin());
+}
+
+#endif /* CACHEHOUND_BACKENDS_IMPL_PERF_COUNTERS_IPP */
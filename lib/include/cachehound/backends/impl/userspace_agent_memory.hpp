@@ -0,0 +1,44 @@
+#ifndef CACHEHOUND_BACKENDS_IMPL_USERSPACE_AGENT_MEMORY_HPP
+#define CACHEHOUND_BACKENDS_IMPL_USERSPACE_AGENT_MEMORY_HPP
+
+namespace cachehound {
+
+cachehound::userspace_agent_memory::userspace_agent_memory(
+    std::size_t min_size,
+    unsigned cpu,
+    static_pmu_profile auto profile,
+    wait_policy agent_wait,
+    wait_policy wait,
+    std::size_t hugetlb_page_size)
+    : agent_memory_base(&decltype(profile)::decode, wait)
+    , cpu_(cpu)
+    , hugetlb_page_size_(hugetlb_page_size)
+    , agent_wait_policy_(agent_wait)
+    , pmu_events_(decltype(profile)::events.begin(), decltype(profile)::events.end())
+{
+    assert(min_size > 0);
+    static_assert(decltype(profile)::events.size() <= CH_RESULT_COUNTERS);
+    assert((hugetlb_page_size_ & (hugetlb_page_size_ - 1)) == 0);
+
+    if (!ch_wait_policy_supported(static_cast<unsigned>(agent_wait_policy_))) {
+        throw std::runtime_error("Wait policy " + std::to_string(static_cast<unsigned>(agent_wait_policy_)) + " is not supported on this system");
+    }
+
+    // User space addresses have their upper bits cleared
+    upper_address_bits_ = 0;
+
+    read_cache_info(cpu_, cache_info_);
+
+    try {
+        map_regions(min_size);
+    } catch (...) {
+        unmap();
+        throw;
+    }
+
+    start_agent();
+}
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef CACHEHOUND_BACKENDS_IMPL_USERSPACE_AGENT_MEMORY_IPP
+#define CACHEHOUND_BACKENDS_IMPL_USERSPACE_AGENT_MEMORY_IPP
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "ch_agent.h"
+
+#include "../userspace_agent_memory.hpp"
+#include "../detail/perf_counters.hpp"
+
+std::size_t cachehound::userspace_agent_memory::page_size()
+{
+    return sysconf(_SC_PAGE_SIZE);
+}
+
+void* cachehound::userspace_agent_memory::map_anonymous(std::size_t size, std::size_t huge_page_size, bool* locked)
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (huge_page_size) {
+        flags |= MAP_HUGETLB | (std::countr_zero(huge_page_size) << MAP_HUGE_SHIFT);
+    }
+    auto ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (ptr == MAP_FAILED) {
+        if (huge_page_size) {
+            throw std::runtime_error("Failed to map " + std::to_string(size) + " bytes of huge pages (are enough of them reserved?)");
+        }
+        throw std::runtime_error("Failed to map " + std::to_string(size) + " bytes of anonymous memory");
+    }
+
+    // Keeps the frames reported by the pagemap: khugepaged would collapse
+    // small pages into transparent huge pages and reclaim would swap them
+    // out. Locking populates the pages, which are touched instead if the
+    // locked memory exceeds RLIMIT_MEMLOCK.
+    if (!huge_page_size) {
+        madvise(ptr, size, MADV_NOHUGEPAGE);
+    }
+    bool mapping_locked = mlock(ptr, size) == 0;
+    if (!mapping_locked) {
+        for (std::size_t offset = 0, step = page_size(); offset < size; offset += step) {
+            static_cast<volatile std::byte*>(ptr)[offset] = std::byte{0};
+        }
+    }
+    if (locked) {
+        *locked = mapping_locked;
+    }
+    return ptr;
+}
+
+std::vector<std::uint64_t> cachehound::userspace_agent_memory::physical_frames(std::uintptr_t base, std::size_t size)
+{
+    // Entries are 64 bits per page: bit 63 is set if the page is present and
+    // bits 0-54 hold its frame number (see Documentation/admin-guide/mm/pagemap.rst)
+    constexpr std::uint64_t present = std::uint64_t{1} << 63
+                          , frame_mask = (std::uint64_t{1} << 55) - 1;
+
+    std::vector<std::uint64_t> frames(size / page_size());
+    int fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::vector<std::uint64_t>(frames.size());
+    }
+    auto bytes = frames.size() * sizeof(std::uint64_t);
+    auto read = pread(fd, frames.data(), bytes, base / page_size() * sizeof(std::uint64_t));
+    close(fd);
+    if (read != static_cast<ssize_t>(bytes)) {
+        return std::vector<std::uint64_t>(frames.size());
+    }
+
+    for (auto& frame : frames) {
+        frame = (frame & present) ? frame & frame_mask : 0;
+    }
+    return frames;
+}
+
+std::size_t cachehound::userspace_agent_memory::map_regions(std::size_t min_size)
+{
+    auto granule = std::max(hugetlb_page_size_, page_size());
+    auto size = (min_size + granule - 1) & ~(granule - 1);
+    bool locked = false;
+    auto base = reinterpret_cast<std::uintptr_t>(map_anonymous(size, hugetlb_page_size_, &locked));
+    mappings_.emplace_back(base, size);
+
+    // Each physically contiguous run becomes one region, the whole mapping
+    // if the frames are unknown (e.g., without CAP_SYS_ADMIN) or may change
+    // since the mapping is not locked
+    auto frames = locked ? physical_frames(base, size) : std::vector<std::uint64_t>(size / page_size());
+    if (std::ranges::find(frames, 0) != frames.end()) {
+        physical_addresses_available_ = false;
+        regions_.emplace_back(base, 0, size);
+        address_checker_.add_region(regions_.back());
+        return size;
+    }
+
+    std::size_t run = 0;
+    for (std::size_t page = 1; page <= frames.size(); page++) {
+        if (page == frames.size() || frames[page] != frames[page - 1] + 1) {
+            regions_.emplace_back(base + run * page_size(), frames[run] * page_size(), (page - run) * page_size());
+            address_checker_.add_region(regions_.back());
+            run = page;
+        }
+    }
+    return size;
+}
+
+void cachehound::userspace_agent_memory::read_cache_info(unsigned cpu, ch_ioc_cache_info& cache_info)
+{
+    cache_info = {};
+
+    auto cache_path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+    for (unsigned index = 0;; index++) {
+        auto path = cache_path + std::to_string(index) + "/";
+        std::ifstream level_file{path + "level"};
+        if (!level_file)
+            break;
+
+        std::string type;
+        unsigned level = 0, sets = 0, ways = 0, line_size = 0;
+        level_file >> level;
+        std::ifstream{path + "type"} >> type;
+        std::ifstream{path + "number_of_sets"} >> sets;
+        std::ifstream{path + "ways_of_associativity"} >> ways;
+        std::ifstream{path + "coherency_line_size"} >> line_size;
+
+        if (type == "Instruction" || level == 0 || level > 3)
+            continue;
+
+        cache_info.levels = std::max(cache_info.levels, level);
+        cache_info.sets[level - 1] = sets;
+        cache_info.ways[level - 1] = ways;
+        if (level == 1) {
+            cache_info.offset_bits = std::countr_zero(line_size);
+        }
+    }
+
+    if (cache_info.levels == 0 || cache_info.offset_bits == 0) {
+        throw std::runtime_error("Failed to read cache information of CPU " + std::to_string(cpu) + " from sysfs");
+    }
+}
+
+/*
+ * Counterpart of agent() in kernel/cachehound.c, both execute ch_agent_run().
+ */
+void cachehound::userspace_agent_memory::agent(std::promise<bool>& started) noexcept
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu_, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+        started.set_exception(std::make_exception_ptr(
+            std::runtime_error("Failed to pin agent to CPU " + std::to_string(cpu_))));
+        return;
+    }
+
+    // Counters must be opened by the agent thread itself
+    detail::perf_counters counters{pmu_events_};
+    started.set_value(counters.available());
+
+    ch_agent agent{};
+    agent.channels = channels_;
+    agent.channel_count = page_size() / sizeof(ch_channel);
+    agent.active_channel = &active_channel_;
+    agent.ring = ring_;
+    agent.ring_mask = ring_entries_ - 1;
+    agent.results = results_area_;
+    agent.results_mask = result_entries_ - 1;
+    agent.program = program_;
+    agent.program_entries = program_entries_;
+    agent.levels = levels_;
+    agent.levels_mask = level_entries_ - 1;
+    agent.published_lines = &published_lines_;
+    agent.offset_bits = offset_bits();
+    agent.prng_state = CH_PRNG_DEFAULT_SEED;
+    agent.wait_policy = static_cast<unsigned>(agent_wait_policy_);
+    agent.stats = &agent_stats_;
+    agent.read_counters = [](void* context, std::uint64_t* values) {
+        std::array<std::uint64_t, CH_RESULT_COUNTERS> read;
+        static_cast<detail::perf_counters*>(context)->read(read);
+        std::copy(read.begin(), read.end(), values);
+    };
+    agent.counters_context = &counters;
+
+    ch_agent_reload_lines(&agent);
+    ch_agent_run(&agent);
+}
+
+void cachehound::userspace_agent_memory::publish_lines()
+{
+    auto& ranges = line_ranges_.emplace_back();
+    std::uint64_t lines = 0;
+    for (auto& region : regions_) {
+        ranges.push_back({region.base(), lines});
+        lines += region.size() >> offset_bits();
+    }
+
+    auto& line_set = line_sets_.emplace_back(ch_line_set{ranges.data(), ranges.size(), lines});
+    __atomic_store_n(&published_lines_, &line_set, __ATOMIC_RELEASE);
+}
+
+void cachehound::userspace_agent_memory::start_agent()
+{
+    try {
+        // Physical addresses of the areas are only reported if all are locked
+        bool locked = true;
+        auto map_area = [&](std::size_t size) {
+            bool area_locked = false;
+            auto area = map_anonymous(size, 0, &area_locked);
+            locked = locked && area_locked;
+            return area;
+        };
+        auto channels = static_cast<ch_channel*>(map_area(page_size()));
+        channels_ = channels;
+        auto ring = static_cast<std::uint64_t*>(map_area(page_size() << CH_RING_ORDER));
+        ring_ = ring;
+        results_area_ = static_cast<ch_result*>(map_area(page_size() << CH_RESULTS_ORDER));
+        results_ = results_area_;
+        auto program = static_cast<std::uint64_t*>(map_area(page_size() << CH_PROGRAM_ORDER));
+        program_ = program;
+        levels_ = static_cast<std::uint8_t*>(map_area(page_size() << CH_LEVELS_ORDER));
+
+        attach(
+            channels, 0, page_size() / sizeof(ch_channel),
+            ring, (page_size() << CH_RING_ORDER) / sizeof(std::uint64_t),
+            results_area_, (page_size() << CH_RESULTS_ORDER) / sizeof(ch_result),
+            program, (page_size() << CH_PROGRAM_ORDER) / sizeof(std::uint64_t),
+            levels_, page_size() << CH_LEVELS_ORDER);
+        if (locked) {
+            channels_physical_address_ = physical_frames(reinterpret_cast<std::uintptr_t>(channels), page_size()).front() * page_size();
+        }
+        // Physical addresses of an area remain unknown unless all its pages are present
+        auto find_physical_pages = [&](area_addresses& area, std::size_t size) {
+            area.page_size = page_size();
+            if (!locked) {
+                return;
+            }
+            auto frames = physical_frames(area.address, size);
+            if (std::ranges::find(frames, 0) == frames.end()) {
+                for (auto frame : frames) {
+                    area.physical_pages.push_back(frame * page_size());
+                }
+            }
+        };
+        find_physical_pages(ring_addresses_, page_size() << CH_RING_ORDER);
+        find_physical_pages(results_addresses_, page_size() << CH_RESULTS_ORDER);
+        find_physical_pages(levels_addresses_, page_size() << CH_LEVELS_ORDER);
+
+        publish_lines();
+
+        std::promise<bool> started;
+        auto started_future = started.get_future();
+        agent_ = std::thread{&userspace_agent_memory::agent, this, std::ref(started)};
+        try {
+            counters_available_ = started_future.get();
+        } catch (...) {
+            agent_.join();
+            throw;
+        }
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+void cachehound::userspace_agent_memory::unmap() noexcept
+{
+    for (auto& mapping : mappings_) {
+        munmap(reinterpret_cast<void*>(mapping.base()), mapping.size());
+    }
+    mappings_.clear();
+    regions_.clear();
+    if (levels_)
+        munmap(levels_, page_size() << CH_LEVELS_ORDER);
+    if (program_)
+        munmap(program_, page_size() << CH_PROGRAM_ORDER);
+    if (results_area_)
+        munmap(results_area_, page_size() << CH_RESULTS_ORDER);
+    if (ring_)
+        munmap(ring_, page_size() << CH_RING_ORDER);
+    if (channels_)
+        munmap(channels_, page_size());
+}
+
+cachehound::userspace_agent_memory::~userspace_agent_memory() noexcept
+{
+    terminate_agent();
+    agent_.join();
+    unmap();
+}
+
+[[nodiscard]] const std::vector<cachehound::userspace_agent_memory::region_type>& cachehound::userspace_agent_memory::regions() const noexcept
+{
+    return regions_;
+}
+
+std::size_t cachehound::userspace_agent_memory::grow(std::size_t min_size)
+{
+    assert(min_size > 0);
+
+    auto grown = map_regions(min_size);
+    publish_lines();
+    reload_lines();
+    return grown;
+}
+
+[[nodiscard]] bool cachehound::userspace_agent_memory::counters_available() const noexcept
+{
+    return counters_available_;
+}
+
+[[nodiscard]] bool cachehound::userspace_agent_memory::physical_addresses_available() const noexcept
+{
+    return physical_addresses_available_;
+}
+
+ch_agent_stats cachehound::userspace_agent_memory::agent_stats() noexcept
+{
+    // The agent updates its stats before completing a batch
+    drain();
+    return agent_stats_;
+}
+
+#endif /* CACHEHOUND_BACKENDS_IMPL_USERSPACE_AGENT_MEMORY_IPP */
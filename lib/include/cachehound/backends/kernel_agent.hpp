@@ -0,0 +1,122 @@
+#ifndef CACHEHOUND_BACKENDS_KERNEL_AGENT_HPP
+#define CACHEHOUND_BACKENDS_KERNEL_AGENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ch_channel.h"
+#include "ch_ioc.h"
+
+#include "./detail/agent_memory_base.hpp"
+#include "../util/basic_extended_memory_region.hpp"
+#include "../concepts/batched_memory.hpp"
+#include "../concepts/channel_placement_memory.hpp"
+#include "../concepts/chase_memory.hpp"
+#include "../concepts/interrupt_aware_memory.hpp"
+#include "../concepts/memory.hpp"
+#include "../concepts/prng_memory.hpp"
+#include "../concepts/programmable_memory.hpp"
+#include "../concepts/queued_instrumented_memory.hpp"
+#include "../concepts/serialization_memory.hpp"
+#include "../concepts/static_pmu_profile.hpp"
+#include "../concepts/stats_memory.hpp"
+#include "../concepts/timed_memory.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief A kthread of the kernel module pinned to a CPU that executes the
+ * accesses submitted through its own channels, ring and results. All agents
+ * of an open device share the regions allocated by kernel_memory (which is
+ * the first agent itself). Distinct agents can be driven from distinct
+ * threads concurrently.
+ */
+class kernel_agent : public detail::agent_memory_base {
+public:
+    enum class isolation_level : decltype(ch_ioc_start_config::isolation_level) {
+        off = CH_ISOLATION_OFF,
+        no_preempt = CH_ISOLATION_NO_PREEMPT,
+        disable_irq = CH_ISOLATION_DISABLE_IRQ
+    };
+
+    using region_type = basic_extended_memory_region;
+
+private:
+    static ch_channel* mmap_channels(int fd, int page_size, unsigned agent);
+    static std::uint64_t* mmap_ring(int fd, int page_size, unsigned agent, std::size_t ring_entries);
+    static const ch_result* mmap_results(int fd, int page_size, unsigned agent, std::size_t result_entries);
+    static std::uint64_t* mmap_program(int fd, int page_size, unsigned agent, std::size_t program_entries);
+    static const std::uint8_t* mmap_levels(int fd, int page_size, unsigned agent, std::size_t level_entries);
+    static void start_agent(int fd, ch_ioc_start_config& config);
+    static int duplicate_fd(int fd);
+
+    unsigned agent_ = 0;
+    unsigned counters_ = 0
+           , fixed_counters_ = 0;
+    int node_ = -1;
+
+protected:
+    int fd_ = -1;
+    std::vector<region_type> regions_;
+
+    // Takes ownership of the file descriptor
+    kernel_agent(int fd, pmu_decoder* decoder, wait_policy wait);
+
+    // Starts the agent on all regions allocated thus far
+    void start(unsigned cpu, std::span<const std::uint64_t> pmu_events, isolation_level isolation, wait_policy agent_wait);
+
+public:
+    // Starts another agent on the device of the given agent, on a CPU that
+    // runs no agent of the device yet
+    kernel_agent(
+        const kernel_agent& sibling,
+        unsigned cpu,
+        static_pmu_profile auto profile,
+        isolation_level isolation = isolation_level::no_preempt,
+        wait_policy agent_wait = wait_policy::spin,
+        wait_policy wait = wait_policy::sleep);
+
+    ~kernel_agent() noexcept;
+    [[nodiscard]] const std::vector<region_type>& regions() const noexcept;
+
+    // Index of the agent among all agents of the device
+    [[nodiscard]] unsigned agent() const noexcept;
+    // Programmable and fixed counters whose deltas the agent reports in
+    // ch_result (see last_result())
+    [[nodiscard]] unsigned counters() const noexcept;
+    [[nodiscard]] unsigned fixed_counters() const noexcept;
+    // NUMA node of the agent's CPU (negative if unknown); see
+    // basic_extended_memory_region::node() for the node of each region
+    [[nodiscard]] int node() const noexcept;
+    // Where the agent spent its time thus far, after draining all buffered
+    // operations
+    ch_agent_stats agent_stats();
+    // Parks the SMT siblings of the agent's CPU in a spin loop that neither
+    // accesses memory nor lets other tasks run, or releases them again. Takes
+    // effect after all buffered operations. Returns the number of siblings
+    // parked (zero without SMT or if agents run on all siblings)
+    unsigned quiesce_siblings(bool enable);
+};
+
+static_assert(memory<kernel_agent>);
+static_assert(batched_memory<kernel_agent>);
+static_assert(channel_placement_memory<kernel_agent>);
+static_assert(chase_memory<kernel_agent>);
+static_assert(stats_memory<kernel_agent>);
+static_assert(queued_instrumented_memory<kernel_agent>);
+static_assert(interrupt_aware_memory<kernel_agent>);
+static_assert(serialization_memory<kernel_agent>);
+static_assert(programmable_memory<kernel_agent>);
+static_assert(prng_memory<kernel_agent>);
+static_assert(timed_memory<kernel_agent>);
+
+}
+
+#if defined(CACHEHOUND_HEADER_ONLY)
+#include "./impl/kernel_agent.ipp"
+#endif
+#include "./impl/kernel_agent.hpp"
+
+#endif /* CACHEHOUND_BACKENDS_KERNEL_AGENT_HPP */
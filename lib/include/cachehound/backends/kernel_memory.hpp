@@ -3,121 +3,94 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <span>
 #include <vector>
 
-#include "ch_channel.h"
 #include "ch_ioc.h"
 
-#include "../util/address_checker.hpp"
-#include "../util/basic_extended_memory_region.hpp"
+#include "./kernel_agent.hpp"
+#include "../concepts/batched_memory.hpp"
+#include "../concepts/channel_placement_memory.hpp"
+#include "../concepts/chase_memory.hpp"
+#include "../concepts/growable_memory.hpp"
+#include "../concepts/interrupt_aware_memory.hpp"
 #include "../concepts/memory.hpp"
+#include "../concepts/prng_memory.hpp"
+#include "../concepts/programmable_memory.hpp"
+#include "../concepts/queued_instrumented_memory.hpp"
+#include "../concepts/serialization_memory.hpp"
+#include "../concepts/static_pmu_profile.hpp"
 #include "../concepts/stats_memory.hpp"
+#include "../concepts/timed_memory.hpp"
 
 namespace cachehound {
 
-class kernel_memory {
-public:
-    enum class isolation_level : decltype(ch_ioc_start_config::isolation_level) {
-        off = CH_ISOLATION_OFF,
-        no_preempt = CH_ISOLATION_NO_PREEMPT,
-        disable_irq = CH_ISOLATION_DISABLE_IRQ
-    };
-
-    using region_type = basic_extended_memory_region;
-
-    using pmu_handler_type = unsigned(std::uint64_t, std::uint64_t, std::uint64_t
-                               , std::uint64_t, std::uint64_t, std::uint64_t);
-
-    struct stats_type {
-        std::size_t accesses              = 0
-                  , instrumented_accesses = 0
-                  , flushes               = 0
-                  , channel_switches      = 0;
-#if defined(__x86_64__) || defined(_M_X64)
-        std::size_t clflushes = 0
-                  , wbinvds   = 0;
-#elif defined(__aarch64__) || defined(_M_ARM64)
-        std::size_t csws  = 0
-                  , isws  = 0
-                  , cisws = 0;
-#endif
-    };
-
+/**
+ * @brief Memory allocated by the kernel module together with the first agent
+ * of the device. Further agents sharing the memory are started by
+ * constructing a kernel_agent from it.
+ */
+class kernel_memory : public kernel_agent {
 private:
-    static constexpr std::size_t reserved_upper_bits = 2;
+    // Regions returned per allocation request
+    static constexpr std::size_t alloc_batch_size = 256;
 
     static int obtain_ch_fd();
-    static ch_channel* mmap_channels(int fd, int page_size);
-    static bool alloc_region(int fd, ch_ioc_alloc_config& config);
+    static void alloc_regions(int fd, ch_ioc_bulk_alloc_config& config);
     static void read_cache_info(int fd, ch_ioc_cache_info& cache_info);
-    static void start_agent(int fd, ch_ioc_start_config& config);
-    ch_channel* active_channel() const;
-    void switch_channel(std::size_t channel) noexcept;
-    void internal_access(std::uintptr_t address);
+    void alloc_regions(std::size_t min_size);
+    void pin_buffer(std::span<std::byte> buffer);
     void defragment_regions();
 
-    ch_channel* channels_;
-    std::size_t active_channel_;
-    std::size_t channel_count_;
-
-    std::vector<region_type> regions_;
-    std::array<std::uintptr_t, 7> buffer_ {};
-    std::size_t buffered_ = 0;
-    address_checker address_checker_;
-
-    stats_type stats_{};
-
-    std::function<pmu_handler_type> pmu_handler_;
-    ch_ioc_cache_info cache_info_;
+    unsigned cpu_;
+    unsigned max_order_ = CH_ALLOC_MAX_ORDER;
 
 public:
-    // TODO: Wrap handler and events in a common class
+    // Starts the agent with the events of the profile, which also decodes
+    // the results the agent does not classify itself (see set_pmu_profile())
     kernel_memory(
         std::size_t min_size,
         unsigned cpu,
-        auto&& pmu_events,
-        std::function<pmu_handler_type> pmu_handler,
+        static_pmu_profile auto profile,
         isolation_level isolation = isolation_level::no_preempt,
-        unsigned max_order = 6);
-
-    ~kernel_memory() noexcept;
-    [[nodiscard]] const std::vector<region_type>& regions() const noexcept;
-    [[nodiscard]] unsigned levels() const noexcept;
-
-    std::uint8_t offset_bits() const noexcept;
-    std::uint8_t index_bits(unsigned level) const noexcept;
-    std::size_t ways(unsigned level) const noexcept;
-
-    void access(std::uintptr_t address) noexcept;
-    unsigned instrumented_access(std::uintptr_t address);
-    inline void flush() noexcept;
-
-    stats_type stats() const noexcept;
-
-
-#if defined(__x86_64__) || defined(_M_X64)
-
-    void clflush(std::uintptr_t address) noexcept;
-    void wbinvd() noexcept;
-
-#elif defined(__aarch64__) || defined(_M_ARM64)
-
-private:
-    void internal_cisw(bool clean, bool invalidate, unsigned level, std::size_t set, std::size_t way);
-
-public:
-    void csw(unsigned level, std::size_t set, std::size_t way);
-    void isw(unsigned level, std::size_t set, std::size_t way);
-    void cisw(unsigned level, std::size_t set, std::size_t way);
-    void reset();
-
-#endif
-
-    void switch_channel() noexcept;
+        wait_policy agent_wait = wait_policy::spin,
+        wait_policy wait = wait_policy::sleep,
+        unsigned max_order = CH_ALLOC_MAX_ORDER);
+
+    // Pins the page aligned buffer of the process (e.g., a 1 GiB hugetlbfs
+    // page or a THP region) instead of allocating memory in the kernel, so
+    // that each physically contiguous run becomes one region. The pages stay
+    // pinned until the device is closed and the buffer may be unmapped
+    // meanwhile. The process must not access the buffer, its accesses would
+    // alias with the measured ones, and chains (see link_chain()) whose
+    // lines it overwrites end at the first line outside the regions.
+    kernel_memory(
+        std::span<std::byte> buffer,
+        unsigned cpu,
+        static_pmu_profile auto profile,
+        isolation_level isolation = isolation_level::no_preempt,
+        wait_policy agent_wait = wait_policy::spin,
+        wait_policy wait = wait_policy::sleep);
+
+    // Allocates further regions on the node of the agent's CPU, so that the
+    // memory can start small and grow once algorithms run short of lines.
+    // The agent covers them by random accesses and chains right away, agents
+    // started from this memory before once they reload_lines().
+    std::size_t grow(std::size_t min_size);
 };
 
 static_assert(memory<kernel_memory>);
+static_assert(batched_memory<kernel_memory>);
+static_assert(channel_placement_memory<kernel_memory>);
+static_assert(chase_memory<kernel_memory>);
+static_assert(growable_memory<kernel_memory>);
 static_assert(stats_memory<kernel_memory>);
+static_assert(queued_instrumented_memory<kernel_memory>);
+static_assert(interrupt_aware_memory<kernel_memory>);
+static_assert(serialization_memory<kernel_memory>);
+static_assert(programmable_memory<kernel_memory>);
+static_assert(prng_memory<kernel_memory>);
+static_assert(timed_memory<kernel_memory>);
 
 }
 
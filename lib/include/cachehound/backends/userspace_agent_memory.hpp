@@ -0,0 +1,134 @@
+#ifndef CACHEHOUND_BACKENDS_USERSPACE_AGENT_MEMORY_HPP
+#define CACHEHOUND_BACKENDS_USERSPACE_AGENT_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "ch_agent.h"
+#include "ch_channel.h"
+
+#include "./detail/agent_memory_base.hpp"
+#include "../util/basic_extended_memory_region.hpp"
+#include "../util/basic_memory_region.hpp"
+#include "../concepts/batched_memory.hpp"
+#include "../concepts/channel_placement_memory.hpp"
+#include "../concepts/chase_memory.hpp"
+#include "../concepts/growable_memory.hpp"
+#include "../concepts/interrupt_aware_memory.hpp"
+#include "../concepts/memory.hpp"
+#include "../concepts/physically_indexable_memory.hpp"
+#include "../concepts/prng_memory.hpp"
+#include "../concepts/programmable_memory.hpp"
+#include "../concepts/queued_instrumented_memory.hpp"
+#include "../concepts/serialization_memory.hpp"
+#include "../concepts/static_pmu_profile.hpp"
+#include "../concepts/stats_memory.hpp"
+#include "../concepts/timed_memory.hpp"
+#include "../concepts/x86_memory.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief Stand-in for kernel_memory that requires neither the kernel module
+ * nor root privileges. The memory is mapped into the user process and the
+ * agent is a thread pinned to the given CPU that executes the same channel
+ * protocol as the kernel agent. Counters are read through perf_event_open
+ * where available and access latencies with the TSC (x86) or the generic
+ * timer (arm64). Privileged operations (wbinvd, DC CISW/CSW/ISW) are
+ * skipped. Physical addresses are read from /proc/self/pagemap, which
+ * reports them to processes with CAP_SYS_ADMIN only, and only if the memory
+ * could be locked (see RLIMIT_MEMLOCK).
+ */
+class userspace_agent_memory : public detail::agent_memory_base {
+public:
+    using region_type = basic_extended_memory_region;
+
+private:
+    static std::size_t page_size();
+    // Maps locked memory, locked is cleared if it exceeds RLIMIT_MEMLOCK
+    static void* map_anonymous(std::size_t size, std::size_t huge_page_size = 0, bool* locked = nullptr);
+    // Frame numbers of the pages in [base, base + size), zero where unknown
+    static std::vector<std::uint64_t> physical_frames(std::uintptr_t base, std::size_t size);
+    static void read_cache_info(unsigned cpu, ch_ioc_cache_info& cache_info);
+
+    void agent(std::promise<bool>& started) noexcept;
+    void start_agent();
+    void unmap() noexcept;
+    std::size_t map_regions(std::size_t min_size);
+    // Publishes the line ranges of all regions to the agent
+    void publish_lines();
+
+    unsigned cpu_;
+    std::size_t hugetlb_page_size_;
+    wait_policy agent_wait_policy_;
+    std::vector<std::uint64_t> pmu_events_;
+    std::vector<region_type> regions_;
+    std::vector<basic_memory_region> mappings_;
+    // Sets are only appended, the agent may use any of them until it adopts
+    // the newest (see CH_COMMAND_RELOAD_LINES)
+    std::deque<std::vector<ch_line_range>> line_ranges_;
+    std::deque<ch_line_set> line_sets_;
+    const ch_line_set* published_lines_ = nullptr;
+    bool physical_addresses_available_ = true;
+    ch_result* results_area_ = nullptr;
+    std::uint8_t* levels_ = nullptr;
+    std::size_t active_channel_ = 0;
+    std::thread agent_;
+    bool counters_available_ = false;
+    ch_agent_stats agent_stats_{};
+
+public:
+    userspace_agent_memory(
+        std::size_t min_size,
+        unsigned cpu,
+        static_pmu_profile auto profile,
+        wait_policy agent_wait = wait_policy::spin,
+        wait_policy wait = wait_policy::sleep,
+        std::size_t hugetlb_page_size = 0);
+
+    ~userspace_agent_memory() noexcept;
+    [[nodiscard]] const std::vector<region_type>& regions() const noexcept;
+
+    // Whether the agent obtained its counters from perf_event_open (false
+    // implies that all counter deltas are zero)
+    [[nodiscard]] bool counters_available() const noexcept;
+    // Whether the physical bases of all regions are known (false implies
+    // that each mapping is one region with a physical base of zero)
+    [[nodiscard]] bool physical_addresses_available() const noexcept;
+    // Where the agent spent its time thus far, after draining all buffered
+    // operations
+    ch_agent_stats agent_stats() noexcept;
+    // Maps a further region, which the agent covers by random accesses and
+    // chains right away
+    std::size_t grow(std::size_t min_size);
+};
+
+static_assert(memory<userspace_agent_memory>);
+static_assert(batched_memory<userspace_agent_memory>);
+static_assert(channel_placement_memory<userspace_agent_memory>);
+static_assert(chase_memory<userspace_agent_memory>);
+static_assert(growable_memory<userspace_agent_memory>);
+static_assert(stats_memory<userspace_agent_memory>);
+static_assert(queued_instrumented_memory<userspace_agent_memory>);
+static_assert(interrupt_aware_memory<userspace_agent_memory>);
+static_assert(serialization_memory<userspace_agent_memory>);
+static_assert(programmable_memory<userspace_agent_memory>);
+static_assert(prng_memory<userspace_agent_memory>);
+static_assert(timed_memory<userspace_agent_memory>);
+static_assert(physically_indexable_memory<userspace_agent_memory>);
+#if defined(__x86_64__) || defined(_M_X64)
+static_assert(x86_memory<userspace_agent_memory>);
+#endif
+
+}
+
+#if defined(CACHEHOUND_HEADER_ONLY)
+#include "./impl/userspace_agent_memory.ipp"
+#endif
+#include "./impl/userspace_agent_memory.hpp"
+
+#endif /* CACHEHOUND_BACKENDS_USERSPACE_AGENT_MEMORY_HPP */
@@ -3,34 +3,51 @@
 
 #include "./adapters/armv8_bypass_adapter.hpp"
 #include "./adapters/bypass_adapter.hpp"
+#include "./adapters/latency_adapter.hpp"
 #include "./adapters/physical_adapter.hpp"
 
+#include "./algo/calibrate_latency.hpp"
+#include "./algo/calibrate_serialization.hpp"
 #include "./algo/find_eviction_set.hpp"
 #include "./algo/is_eviction_set.hpp"
 #include "./algo/locate_eviction_set.hpp"
+#include "./algo/measure_eviction_noise.hpp"
 #include "./algo/measure_sequence.hpp"
 #include "./algo/minimize_eviction_set.hpp"
 #include "./algo/reduce_eviction_set.hpp"
 #include "./algo/simulate_sequence.hpp"
 
+#include "./backends/kernel_agent.hpp"
 #include "./backends/kernel_memory.hpp"
+#include "./backends/userspace_agent_memory.hpp"
 
 #include "./concepts/address_distribution.hpp"
 #include "./concepts/address_range.hpp"
 #include "./concepts/armv8_memory.hpp"
+#include "./concepts/armv8_range_memory.hpp"
+#include "./concepts/channel_placement_memory.hpp"
+#include "./concepts/batched_memory.hpp"
+#include "./concepts/chase_memory.hpp"
 #include "./concepts/eviction_strategy.hpp"
 #include "./concepts/extended_memory_region.hpp"
 #include "./concepts/extended_memory_region_range.hpp"
 #include "./concepts/flushable_memory.hpp"
+#include "./concepts/growable_memory.hpp"
 #include "./concepts/instrumented_memory.hpp"
+#include "./concepts/interrupt_aware_memory.hpp"
 #include "./concepts/memory.hpp"
 #include "./concepts/memory_region.hpp"
 #include "./concepts/memory_region_range.hpp"
 #include "./concepts/physically_indexable_memory.hpp"
 #include "./concepts/placement_policy.hpp"
+#include "./concepts/prng_memory.hpp"
+#include "./concepts/programmable_memory.hpp"
+#include "./concepts/queued_instrumented_memory.hpp"
 #include "./concepts/replacement_policy.hpp"
 #include "./concepts/resettable_memory.hpp"
 #include "./concepts/sequence.hpp"
+#include "./concepts/serialization_memory.hpp"
+#include "./concepts/static_pmu_profile.hpp"
 #include "./concepts/stats_memory.hpp"
 #include "./concepts/switch_channel_memory.hpp"
 #include "./concepts/timed_memory.hpp"
@@ -50,6 +67,13 @@
 #include "./policies/replacement/qlru_replacement_policy.hpp"
 #include "./policies/replacement/srrip_replacement_policy.hpp"
 
+#include "./profiles/a64fx_pmu_profile.hpp"
+#include "./profiles/amd_zen2_pmu_profile.hpp"
+#include "./profiles/intel_pmu_profile.hpp"
+#include "./profiles/no_pmu_profile.hpp"
+#include "./profiles/pmu_profiles.hpp"
+#include "./profiles/rpi5_pmu_profile.hpp"
+
 #include "./strategies/cisw_eviction_strategy.hpp"
 #include "./strategies/eviction_set_strategy.hpp"
 
@@ -60,8 +84,10 @@
 #include "./util/basic_memory_region.hpp"
 #include "./util/blacklisted_address_distribution.hpp"
 #include "./util/concatenated_address_distribution.hpp"
+#include "./util/latency_classifier.hpp"
 #include "./util/locate_set.hpp"
 #include "./util/memory_size.hpp"
+#include "./util/pmu_profile.hpp"
 #include "./util/replacement_policy.hpp"
 #include "./util/sequence.hpp"
 #include "./util/set_cycling_address_distribution.hpp"
@@ -0,0 +1,22 @@
+#ifndef CACHEHOUND_CONCEPTS_ARMV8_RANGE_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_ARMV8_RANGE_MEMORY_HPP
+
+#include <concepts>
+
+#include "./armv8_memory.hpp"
+
+namespace cachehound {
+
+// Set/way maintenance of all ways of the sets [first_set, end_set) of a level
+// or of an entire level at once
+template<typename M>
+concept armv8_range_memory = armv8_memory<M> and requires(M& memory, unsigned level, std::size_t first_set, std::size_t end_set) {
+    { memory.cisw_sets(level, first_set, end_set) } -> std::same_as<void>;
+    { memory.csw_sets(level, first_set, end_set) } -> std::same_as<void>;
+    { memory.isw_sets(level, first_set, end_set) } -> std::same_as<void>;
+    { memory.cisw_level(level) } -> std::same_as<void>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_ARMV8_RANGE_MEMORY_HPP */
@@ -0,0 +1,24 @@
+#ifndef CACHEHOUND_CONCEPTS_BATCHED_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_BATCHED_MEMORY_HPP
+
+#include <concepts>
+#include <cstdint>
+#include <span>
+
+#include "./instrumented_memory.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept batched_memory = instrumented_memory<M>
+    and requires(M& memory, std::span<const std::uintptr_t> addresses, std::span<unsigned> levels) {
+    // Equivalent to access() and instrumented_access() of each address in
+    // order, instrumented_access_many() stores the level of addresses[i] in
+    // levels[i] (both spans have the same size)
+    { memory.access_many(addresses) } -> std::same_as<void>;
+    { memory.instrumented_access_many(addresses, levels) } -> std::same_as<void>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_BATCHED_MEMORY_HPP */
@@ -0,0 +1,27 @@
+#ifndef CACHEHOUND_CONCEPTS_CHANNEL_PLACEMENT_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_CHANNEL_PLACEMENT_MEMORY_HPP
+
+#include <concepts>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "./switch_channel_memory.hpp"
+#include "../util/any_placement_policy.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept channel_placement_memory = switch_channel_memory<M>
+    and requires(M& memory, std::vector<any_placement_policy> placements, std::span<const std::uintptr_t> addresses) {
+    // Placement hypotheses per level of the addresses passed to
+    // avoid_channel_conflicts()
+    { memory.set_channel_placement(placements) } -> std::same_as<void>;
+    // Moves the traffic of the memory to a channel that does not share a
+    // set with any of the addresses
+    { memory.avoid_channel_conflicts(addresses) } -> std::same_as<void>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_CHANNEL_PLACEMENT_MEMORY_HPP */
@@ -0,0 +1,25 @@
+#ifndef CACHEHOUND_CONCEPTS_CHASE_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_CHASE_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+#include <span>
+
+#include "./memory.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept chase_memory = memory<M>
+    and requires(M& memory, std::span<const std::uintptr_t> addresses, const typename M::chain_type& chain, std::size_t hops) {
+    // The lines of the addresses are linked into a chain through pointers
+    // stored in the lines themselves. Chasing it accesses them in order by
+    // dependent loads, as if by access() but with a single request.
+    { memory.link_chain(addresses) } -> std::same_as<typename M::chain_type>;
+    { memory.chase(chain, hops) } -> std::same_as<void>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_CHASE_MEMORY_HPP */
@@ -0,0 +1,21 @@
+#ifndef CACHEHOUND_CONCEPTS_GROWABLE_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_GROWABLE_MEMORY_HPP
+
+#include <concepts>
+#include <cstddef>
+
+#include "./memory.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept growable_memory = memory<M>
+    and requires(M& memory, std::size_t size) {
+    // Appends regions of at least size bytes in total and returns the bytes
+    // added, the preceding regions remain unchanged and in their order
+    { memory.grow(size) } -> std::same_as<std::size_t>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_GROWABLE_MEMORY_HPP */
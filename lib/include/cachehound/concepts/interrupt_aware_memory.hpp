@@ -0,0 +1,23 @@
+#ifndef CACHEHOUND_CONCEPTS_INTERRUPT_AWARE_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_INTERRUPT_AWARE_MEMORY_HPP
+
+#include <concepts>
+#include <cstdint>
+
+#include "./memory.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept interrupt_aware_memory = memory<M>
+    and requires(M& memory, const M& const_memory, std::uint64_t cycles) {
+    // Monotonic count of interrupts that struck while accesses were
+    // executed, a measurement is contaminated if it advanced meanwhile
+    { const_memory.interrupts() } -> std::convertible_to<std::uint64_t>;
+    // Accesses taking at least cycles count as interrupts (0 disables)
+    { memory.set_interrupt_gap(cycles) } -> std::same_as<void>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_INTERRUPT_AWARE_MEMORY_HPP */
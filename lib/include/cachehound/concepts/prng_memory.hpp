@@ -0,0 +1,26 @@
+#ifndef CACHEHOUND_CONCEPTS_PRNG_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_PRNG_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+#include <span>
+
+#include "./memory.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept prng_memory = memory<M>
+    and requires(M& memory, std::uint64_t seed, std::size_t count, std::span<const std::uintptr_t> addresses) {
+    // Accesses to pseudo-random lines of the memory that the memory generates
+    // itself, reproducible for the same seed. Lines of blacklisted addresses
+    // are never accessed, each call replaces the previous blacklist.
+    { memory.seed(seed) } -> std::same_as<void>;
+    { memory.random_accesses(count) } -> std::same_as<void>;
+    { memory.random_access_blacklist(addresses) } -> std::same_as<void>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_PRNG_MEMORY_HPP */
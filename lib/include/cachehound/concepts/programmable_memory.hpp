@@ -0,0 +1,27 @@
+#ifndef CACHEHOUND_CONCEPTS_PROGRAMMABLE_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_PROGRAMMABLE_MEMORY_HPP
+
+#include <cstddef>
+#include <concepts>
+
+#include "./queued_instrumented_memory.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept programmable_memory = queued_instrumented_memory<M>
+    and requires(M& memory, const typename M::program_type& program, std::size_t count) {
+    // Operations issued between begin_program() and end_program() are
+    // recorded into a program instead of being executed. Running a program
+    // queues its instrumented accesses like enqueue_instrumented_access().
+    { memory.begin_program() } -> std::same_as<void>;
+    { memory.end_program() } -> std::same_as<typename M::program_type>;
+    { memory.run_program(program) } -> std::same_as<void>;
+    { memory.clear_programs() } -> std::same_as<void>;
+    { memory.repeat(count, [] {}) } -> std::same_as<void>;
+    { memory.barrier() } -> std::same_as<void>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_PROGRAMMABLE_MEMORY_HPP */
@@ -0,0 +1,24 @@
+#ifndef CACHEHOUND_CONCEPTS_QUEUED_INSTRUMENTED_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_QUEUED_INSTRUMENTED_MEMORY_HPP
+
+#include <cstdint>
+#include <concepts>
+#include <span>
+
+#include "./instrumented_memory.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept queued_instrumented_memory = instrumented_memory<M>
+    and requires(M& memory, std::uintptr_t address) {
+    // Instrumented accesses can be queued together with regular accesses.
+    // collect_instrumented_accesses() returns the levels of all queued
+    // instrumented accesses in submission order.
+    { memory.enqueue_instrumented_access(address) } -> std::same_as<void>;
+    { memory.collect_instrumented_accesses() } -> std::same_as<std::span<const unsigned>>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_QUEUED_INSTRUMENTED_MEMORY_HPP */
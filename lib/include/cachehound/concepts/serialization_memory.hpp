@@ -0,0 +1,21 @@
+#ifndef CACHEHOUND_CONCEPTS_SERIALIZATION_MEMORY_HPP
+#define CACHEHOUND_CONCEPTS_SERIALIZATION_MEMORY_HPP
+
+#include <concepts>
+
+#include "./memory.hpp"
+
+namespace cachehound {
+
+template<typename M>
+concept serialization_memory = memory<M>
+    and requires(M& memory, const M& const_memory, typename M::serialization_profile profile) {
+    // How strictly accesses are serialized, trading the stability of
+    // measurements for throughput
+    { memory.set_serialization(profile) } -> std::same_as<void>;
+    { const_memory.serialization() } -> std::same_as<typename M::serialization_profile>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_SERIALIZATION_MEMORY_HPP */
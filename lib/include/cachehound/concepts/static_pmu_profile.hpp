@@ -0,0 +1,31 @@
+#ifndef CACHEHOUND_CONCEPTS_STATIC_PMU_PROFILE_HPP
+#define CACHEHOUND_CONCEPTS_STATIC_PMU_PROFILE_HPP
+
+#include <concepts>
+#include <cstdint>
+#include <ranges>
+#include <string_view>
+
+#include "../util/pmu_profile.hpp"
+
+namespace cachehound {
+
+template<typename P>
+concept static_pmu_profile = requires {
+    // Identifies the profile, e.g. on the command line
+    { P::name } -> std::convertible_to<std::string_view>;
+    // The events to program, known at compile time
+    requires std::ranges::contiguous_range<decltype(P::events)>;
+    requires std::same_as<std::ranges::range_value_t<decltype(P::events)>, std::uint64_t>;
+    // The rules that map the deltas of the events to levels
+    requires std::ranges::range<decltype(P::rules)>;
+    requires std::same_as<std::ranges::range_value_t<decltype(P::rules)>, pmu_profile::rule>;
+    // The same events and rules for uploading them to an agent
+    { P::profile() } -> std::same_as<pmu_profile>;
+    // Classifies the results the agent did not classify itself
+    { &P::decode } -> std::convertible_to<pmu_decoder*>;
+};
+
+}
+
+#endif /* CACHEHOUND_CONCEPTS_STATIC_PMU_PROFILE_HPP */
@@ -7,7 +7,13 @@
 #error CacheHound library must not be compiled with CACHEHOUND_HEADER_ONLY defined
 #endif
 
+#include "../backends/impl/agent_memory_base.ipp"
+#include "../backends/impl/kernel_agent.ipp"
 #include "../backends/impl/kernel_memory.ipp"
+#include "../backends/impl/perf_counters.ipp"
+#include "../backends/impl/userspace_agent_memory.ipp"
+#include "../util/impl/latency_classifier.ipp"
+#include "../util/impl/pmu_profile.ipp"
 #include "../util/impl/uniform_address_distribution.ipp"
 
 #endif /* CACHEHOUND_IMPL_SRC_HPP */
@@ -0,0 +1,43 @@
+#ifndef CACHEHOUND_PROFILES_A64FX_PMU_PROFILE_HPP
+#define CACHEHOUND_PROFILES_A64FX_PMU_PROFILE_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "./detail/static_pmu_profile_base.hpp"
+#include "../concepts/static_pmu_profile.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief Refills of the L1D and L2 on the Fujitsu A64FX.
+ */
+struct a64fx_pmu_profile : detail::static_pmu_profile_base<a64fx_pmu_profile> {
+    static constexpr std::string_view name = "a64fx";
+
+    // NOTE: A64FX PMU Events Errata
+    // 0x0017, L2D_CACHE_REFILL
+    // 0x0059, L2D_CACHE_REFILL_PRF
+    // 0x0300, L2D_CACHE_REFILL_DM
+    // 0x0309, L2_MISS_COUNT
+    // These events count more than they occur actually when the time distance between the demand request and the prefetch request is close.
+    //
+    // They can be corrected as follows:
+    // L2D_CACHE_REFILL := L2D_CACHE_REFILL – L2D_SWAP_DM – L2D_CACHE_MIBMCH_PRF
+    // L2D_CACHE_REFILL_DM := L2D_CACHE_REFILL_DM - L2D_SWAP_DM
+    // L2D_CACHE_REFILL_PRF := L2D_CACHE_REFILL_PRF - L2D_CACHE_MIBMCH_PRF
+    // L2_MISS_COUNT := L2_MISS_COUNT - L2D_CACHE_SWAP_LOCAL - L2_PIPE_COMP_PF_L2MIB_MCH
+    static constexpr std::array<std::uint64_t, 2> events{
+        0x0003, // L1D_CACHE_REFILL
+        0x0017  // L2D_CACHE_REFILL (or L2_MISS_COUNT 0x0309 ??)
+    };
+
+    static constexpr auto rules = detail::miss_counting_rules<events.size()>();
+};
+
+static_assert(static_pmu_profile<a64fx_pmu_profile>);
+
+}
+
+#endif /* CACHEHOUND_PROFILES_A64FX_PMU_PROFILE_HPP */
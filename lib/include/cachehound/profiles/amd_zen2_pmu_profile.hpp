@@ -0,0 +1,37 @@
+#ifndef CACHEHOUND_PROFILES_AMD_ZEN2_PMU_PROFILE_HPP
+#define CACHEHOUND_PROFILES_AMD_ZEN2_PMU_PROFILE_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "./detail/static_pmu_profile_base.hpp"
+#include "./detail/x86_pmu_event.hpp"
+#include "../concepts/static_pmu_profile.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief L1D misses and L2 hits on AMD Zen 2. Accesses that missed the L1D
+ * without hitting the L2 were served from beyond it.
+ */
+struct amd_zen2_pmu_profile : detail::static_pmu_profile_base<amd_zen2_pmu_profile> {
+    static constexpr std::string_view name = "amd-zen2";
+
+    static constexpr std::array<std::uint64_t, 2> events{
+        detail::x86_pmu_event(0x60, 0xC8, 0x00, false), // l2_cache_accesses_from_dc_misses -> L1D Misses
+        detail::x86_pmu_event(0x64, 0x40, 0x00, false)  // l2_cache_req_stat.ls_rd_blk_l_hit_x -> L2 Hit
+    };
+
+    static constexpr std::array<pmu_profile::rule, 3> rules{{
+        {0, pmu_profile::condition::zero, 0},
+        {1, pmu_profile::condition::nonzero, 1},
+        {0, pmu_profile::condition::always, 2} // memory response
+    }};
+};
+
+static_assert(static_pmu_profile<amd_zen2_pmu_profile>);
+
+}
+
+#endif /* CACHEHOUND_PROFILES_AMD_ZEN2_PMU_PROFILE_HPP */
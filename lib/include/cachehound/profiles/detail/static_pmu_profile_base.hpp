@@ -0,0 +1,68 @@
+#ifndef CACHEHOUND_PROFILES_DETAIL_STATIC_PMU_PROFILE_BASE_HPP
+#define CACHEHOUND_PROFILES_DETAIL_STATIC_PMU_PROFILE_BASE_HPP
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "../../util/pmu_profile.hpp"
+
+namespace cachehound::detail {
+
+// Rules of pmu_profile::hit_counting() for Events events
+template<std::size_t Events>
+constexpr std::array<pmu_profile::rule, Events + 1> hit_counting_rules() noexcept
+{
+    constexpr auto levels = static_cast<unsigned>(Events);
+    std::array<pmu_profile::rule, Events + 1> rules{};
+    for (unsigned i = 0; i < levels; i++) {
+        rules[i] = {i, pmu_profile::condition::nonzero, i};
+    }
+    rules[levels] = {0, pmu_profile::condition::always, levels};
+    return rules;
+}
+
+// Rules of pmu_profile::miss_counting() for Events events
+template<std::size_t Events>
+constexpr std::array<pmu_profile::rule, Events + 1> miss_counting_rules() noexcept
+{
+    constexpr auto levels = static_cast<unsigned>(Events);
+    // A miss in a lower level implies misses in all levels above it
+    std::array<pmu_profile::rule, Events + 1> rules{};
+    for (unsigned i = 0; i < levels; i++) {
+        rules[i] = {levels - 1 - i, pmu_profile::condition::nonzero, levels - i};
+    }
+    rules[levels] = {0, pmu_profile::condition::always, 0};
+    return rules;
+}
+
+/**
+ * @brief Derives profile() and decode() of a static_pmu_profile from the
+ * events and rules of Profile. Accesses are classified by the agent once the
+ * profile was uploaded, otherwise the agent backends decode the counter
+ * deltas of their results by decode().
+ */
+template<typename Profile>
+struct static_pmu_profile_base {
+    static pmu_profile profile()
+    {
+        return {
+            {Profile::events.begin(), Profile::events.end()},
+            {Profile::rules.begin(), Profile::rules.end()}
+        };
+    }
+
+    // The rules are constant, so classifying each result neither loops over
+    // them nor calls through a pointer
+    static void decode(std::span<const ch_result> results, std::vector<unsigned>& levels)
+    {
+        for (auto& result : results) {
+            levels.push_back(classify_deltas(Profile::rules, result.deltas));
+        }
+    }
+};
+
+}
+
+#endif /* CACHEHOUND_PROFILES_DETAIL_STATIC_PMU_PROFILE_BASE_HPP */
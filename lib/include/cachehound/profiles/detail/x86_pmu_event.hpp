@@ -0,0 +1,34 @@
+#ifndef CACHEHOUND_PROFILES_DETAIL_X86_PMU_EVENT_HPP
+#define CACHEHOUND_PROFILES_DETAIL_X86_PMU_EVENT_HPP
+
+#include <cstdint>
+
+namespace cachehound::detail {
+
+// Value of an IA32_PERFEVTSELx / PERF_CTLx register that counts the event in
+// user and kernel mode
+constexpr std::uint64_t x86_pmu_event(
+    std::uint8_t event_select,
+    std::uint8_t unit_mask,
+    std::uint8_t counter_mask,
+    bool edge_detect
+) noexcept {
+    std::uint64_t value = 0;
+
+    value |= std::uint64_t{event_select};
+    value |= std::uint64_t{unit_mask} << 8;
+    // user mode = 1
+    value |= std::uint64_t{1} << 16;
+    // os mode = 1
+    value |= std::uint64_t{1} << 17;
+    value |= std::uint64_t{edge_detect} << 18;
+    // enable = 1
+    value |= std::uint64_t{1} << 22;
+    value |= std::uint64_t{counter_mask} << 24;
+
+    return value;
+}
+
+}
+
+#endif /* CACHEHOUND_PROFILES_DETAIL_X86_PMU_EVENT_HPP */
@@ -0,0 +1,36 @@
+#ifndef CACHEHOUND_PROFILES_INTEL_PMU_PROFILE_HPP
+#define CACHEHOUND_PROFILES_INTEL_PMU_PROFILE_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "./detail/static_pmu_profile_base.hpp"
+#include "./detail/x86_pmu_event.hpp"
+#include "../concepts/static_pmu_profile.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief L1, L2 and L3 hits of retired loads
+ * (MEM_LOAD_RETIRED.L1_HIT/L2_HIT/L3_HIT). Any inconsistencies in the hit
+ * counters can probably be explained by interrupts during execution, thus,
+ * try setting a higher isolation level.
+ */
+struct intel_pmu_profile : detail::static_pmu_profile_base<intel_pmu_profile> {
+    static constexpr std::string_view name = "intel";
+
+    static constexpr std::array<std::uint64_t, 3> events{
+        detail::x86_pmu_event(0xD1, 0x01, 0x00, true),
+        detail::x86_pmu_event(0xD1, 0x02, 0x00, true),
+        detail::x86_pmu_event(0xD1, 0x04, 0x00, true)
+    };
+
+    static constexpr auto rules = detail::hit_counting_rules<events.size()>();
+};
+
+static_assert(static_pmu_profile<intel_pmu_profile>);
+
+}
+
+#endif /* CACHEHOUND_PROFILES_INTEL_PMU_PROFILE_HPP */
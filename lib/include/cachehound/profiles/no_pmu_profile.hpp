@@ -0,0 +1,30 @@
+#ifndef CACHEHOUND_PROFILES_NO_PMU_PROFILE_HPP
+#define CACHEHOUND_PROFILES_NO_PMU_PROFILE_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "./detail/static_pmu_profile_base.hpp"
+#include "../concepts/static_pmu_profile.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief Programs no events, so that accesses remain unclassified
+ * (CH_LEVEL_UNCLASSIFIED) unless another profile is uploaded by
+ * set_pmu_profile(), e.g., when classifying by latencies instead.
+ */
+struct no_pmu_profile : detail::static_pmu_profile_base<no_pmu_profile> {
+    static constexpr std::string_view name = "none";
+
+    static constexpr std::array<std::uint64_t, 0> events{};
+
+    static constexpr std::array<pmu_profile::rule, 0> rules{};
+};
+
+static_assert(static_pmu_profile<no_pmu_profile>);
+
+}
+
+#endif /* CACHEHOUND_PROFILES_NO_PMU_PROFILE_HPP */
@@ -0,0 +1,56 @@
+#ifndef CACHEHOUND_PROFILES_PMU_PROFILES_HPP
+#define CACHEHOUND_PROFILES_PMU_PROFILES_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "./a64fx_pmu_profile.hpp"
+#include "./amd_zen2_pmu_profile.hpp"
+#include "./intel_pmu_profile.hpp"
+#include "./rpi5_pmu_profile.hpp"
+#include "../util/pmu_profile.hpp"
+
+namespace cachehound {
+
+// The profiles known by name, a profile for a further CPU only has to be
+// added here
+using pmu_profiles = std::tuple<
+    intel_pmu_profile,
+    amd_zen2_pmu_profile,
+    rpi5_pmu_profile,
+    a64fx_pmu_profile
+>;
+
+// Calls func.template operator()<P>() for each profile P in pmu_profiles
+template<typename Func>
+constexpr void for_each_pmu_profile(Func&& func) {
+    [&]<typename... Profiles>(std::type_identity<std::tuple<Profiles...>>) {
+        (func.template operator()<Profiles>(), ...);
+    }(std::type_identity<pmu_profiles>{});
+}
+
+inline std::vector<std::string> get_pmu_profiles() {
+    std::vector<std::string> names;
+    for_each_pmu_profile([&]<static_pmu_profile P>() {
+        names.emplace_back(P::name);
+    });
+    return names;
+}
+
+inline std::optional<pmu_profile> make_pmu_profile(std::string_view name) {
+    std::optional<pmu_profile> profile;
+    for_each_pmu_profile([&]<static_pmu_profile P>() {
+        if(!profile && P::name == name) {
+            profile = P::profile();
+        }
+    });
+    return profile;
+}
+
+}
+
+#endif /* CACHEHOUND_PROFILES_PMU_PROFILES_HPP */
@@ -0,0 +1,35 @@
+#ifndef CACHEHOUND_PROFILES_RPI5_PMU_PROFILE_HPP
+#define CACHEHOUND_PROFILES_RPI5_PMU_PROFILE_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "./detail/static_pmu_profile_base.hpp"
+#include "../concepts/static_pmu_profile.hpp"
+
+namespace cachehound {
+
+/**
+ * @brief Refills of the L1D, L2 and L3 on the Raspberry Pi 5 (Cortex-A76),
+ * counted by arm64 architectural standard events.
+ */
+struct rpi5_pmu_profile : detail::static_pmu_profile_base<rpi5_pmu_profile> {
+    static constexpr std::string_view name = "rpi5";
+
+    static constexpr std::array<std::uint64_t, 3> events{
+        0x42, // L1D_CACHE_REFILL_RD
+        0x52, // L2D_CACHE_REFILL_RD
+        0x2A  // L3D_CACHE_REFILL
+        // 0xA2, // L3D_CACHE_REFILL_RD (only on DynamIQ Shared Unit)
+        // 0x37, // LL_CACHE_MISS_RD
+    };
+
+    static constexpr auto rules = detail::miss_counting_rules<events.size()>();
+};
+
+static_assert(static_pmu_profile<rpi5_pmu_profile>);
+
+}
+
+#endif /* CACHEHOUND_PROFILES_RPI5_PMU_PROFILE_HPP */
@@ -2,6 +2,7 @@
 #define CACHEHOUND_STRATEGIES_CISW_EVICTION_STRATEGY_HPP
 
 #include "../concepts/armv8_memory.hpp"
+#include "../concepts/armv8_range_memory.hpp"
 #include "../concepts/instrumented_memory.hpp"
 #include "../concepts/eviction_strategy.hpp"
 #include "../algo/is_eviction_set.hpp"
@@ -26,10 +27,28 @@ public:
         requires std::convertible_to<std::ranges::range_value_t<decltype(set_range)>, std::size_t>
     {
         memory_.access(target);
-        for(std::size_t set : std::forward<decltype(set_range)>(set_range)) {
-            assert(set < (1 << memory_.index_bits(0)));
-            for(std::size_t way = 0; way < memory_.ways(0); way++) {
-                memory_.cisw(0, set, way);
+        if constexpr(armv8_range_memory<Memory>) {
+            // Coalesce runs of consecutive sets into a single range each
+            std::size_t first_set = 0, end_set = 0;
+            for(std::size_t set : std::forward<decltype(set_range)>(set_range)) {
+                assert(set < (1 << memory_.index_bits(0)));
+                if(set != end_set) {
+                    if(first_set != end_set) {
+                        memory_.cisw_sets(0, first_set, end_set);
+                    }
+                    first_set = set;
+                }
+                end_set = set + 1;
+            }
+            if(first_set != end_set) {
+                memory_.cisw_sets(0, first_set, end_set);
+            }
+        } else {
+            for(std::size_t set : std::forward<decltype(set_range)>(set_range)) {
+                assert(set < (1 << memory_.index_bits(0)));
+                for(std::size_t way = 0; way < memory_.ways(0); way++) {
+                    memory_.cisw(0, set, way);
+                }
             }
         }
         return memory_.instrumented_access(target) > 0;
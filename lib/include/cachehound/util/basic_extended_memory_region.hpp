@@ -11,15 +11,22 @@ namespace cachehound {
 
 class basic_extended_memory_region : public basic_memory_region {
     std::uintptr_t physical_base_;
+    int node_;
 
 public:
-    basic_extended_memory_region(std::uintptr_t virtual_base, std::uintptr_t physical_base, std::size_t size)
+    basic_extended_memory_region(std::uintptr_t virtual_base, std::uintptr_t physical_base, std::size_t size, int node = -1)
         : basic_memory_region(virtual_base, size)
-        , physical_base_(physical_base) {}
+        , physical_base_(physical_base)
+        , node_(node) {}
 
     constexpr std::uintptr_t physical_base() const noexcept {
         return physical_base_;
     }
+
+    // NUMA node the region resides on, negative if unknown
+    constexpr int node() const noexcept {
+        return node_;
+    }
 };
 static_assert(extended_memory_region<basic_extended_memory_region>);
 
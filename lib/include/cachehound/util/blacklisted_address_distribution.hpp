@@ -36,6 +36,13 @@ public:
         return address;
     }
 
+    // Extends the base distribution by the regions a growable memory appended
+    void update(const auto& memory)
+        requires requires(BaseDistribution& distribution) { distribution.update(memory); }
+    {
+        distribution_.update(memory);
+    }
+
     void reset() {
         distribution_.reset();
     }
@@ -2,6 +2,7 @@
 #define CACHEHOUND_UTIL_CONCATENATED_ADDRESS_DISTRIBUTION_HPP
 
 #include "../concepts/address_distribution.hpp"
+#include "../concepts/memory.hpp"
 #include "./uniform_address_distribution.hpp"
 
 #include <random>
@@ -22,6 +23,10 @@ public:
     template<std::uniform_random_bit_generator URBG>
     std::uintptr_t operator()(URBG&);
 
+    // Extends both distributions by the regions a growable memory appended
+    void update(const memory auto& memory)
+        requires requires(D1& d1, D2& d2) { d1.update(memory); d2.update(memory); };
+
     void reset();
 };
 static_assert(address_distribution<concatenated_address_distribution<uniform_address_distribution>>);
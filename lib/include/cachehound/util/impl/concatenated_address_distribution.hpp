@@ -22,6 +22,14 @@ std::uintptr_t cachehound::concatenated_address_distribution<D1, D2>::operator()
     return d1_(urbg);
 }
 
+template<cachehound::address_distribution D1, cachehound::address_distribution D2>
+void cachehound::concatenated_address_distribution<D1, D2>::update(const memory auto& memory)
+    requires requires(D1& d1, D2& d2) { d1.update(memory); d2.update(memory); }
+{
+    d1_.update(memory);
+    d2_.update(memory);
+}
+
 template<cachehound::address_distribution D1, cachehound::address_distribution D2>
 void cachehound::concatenated_address_distribution<D1, D2>::reset() {
     if(current_draws_ == draws_) {
@@ -0,0 +1,138 @@
+#ifndef CACHEHOUND_UTIL_IMPL_LATENCY_CLASSIFIER_IPP
+#define CACHEHOUND_UTIL_IMPL_LATENCY_CLASSIFIER_IPP
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "../latency_classifier.hpp"
+
+bool cachehound::latency_classifier::fit(std::vector<double>& modes, std::span<const std::uint64_t> latencies, std::size_t min_size)
+{
+    static constexpr std::size_t max_iterations = 64;
+
+    // Clusters are contiguous ranges of the sorted latencies, bounded by the
+    // midpoints between adjacent modes
+    std::vector<std::uint64_t> sorted(latencies.begin(), latencies.end());
+    std::ranges::sort(sorted);
+    for (std::size_t iteration = 0; iteration < max_iterations; iteration++) {
+        bool moved = false;
+        auto first = sorted.begin();
+        for (std::size_t i = 0; i < modes.size(); i++) {
+            auto last = sorted.end();
+            if (i + 1 < modes.size()) {
+                last = std::lower_bound(first, sorted.end(), (modes[i] + modes[i + 1]) / 2,
+                    [](std::uint64_t latency, double bound) { return latency < bound; });
+            }
+            auto size = static_cast<std::size_t>(last - first);
+            if (size > 0 && size >= min_size) {
+                auto mode = static_cast<double>(first[size / 2]);
+                moved |= mode != modes[i];
+                modes[i] = mode;
+            }
+            first = last;
+        }
+        // A cluster that kept its mode may have been overtaken by a neighbour
+        if (!std::ranges::is_sorted(modes))
+            return false;
+        if (!moved)
+            break;
+    }
+    return true;
+}
+
+void cachehound::latency_classifier::derive_thresholds()
+{
+    thresholds_.resize(modes_.size() - 1);
+    for (std::size_t i = 0; i < thresholds_.size(); i++) {
+        thresholds_[i] = static_cast<std::uint64_t>(std::ceil((modes_[i] + modes_[i + 1]) / 2));
+    }
+}
+
+cachehound::latency_classifier::latency_classifier(
+    std::span<const std::vector<std::uint64_t>> latencies,
+    std::size_t window_size,
+    double drift_tolerance)
+    : window_size_(window_size)
+    , drift_tolerance_(drift_tolerance)
+{
+    assert(latencies.size() >= 2);
+
+    std::vector<std::uint64_t> all;
+    for (auto& level : latencies) {
+        assert(!level.empty());
+        auto sorted = level;
+        auto median = sorted.begin() + sorted.size() / 2;
+        std::ranges::nth_element(sorted, median);
+        modes_.push_back(*median);
+        all.insert(all.end(), level.begin(), level.end());
+    }
+
+    if (!std::ranges::is_sorted(modes_) || !fit(modes_, all, 0)) {
+        throw std::invalid_argument("Latencies of the levels do not ascend with the level");
+    }
+    derive_thresholds();
+    window_.reserve(window_size_);
+}
+
+[[nodiscard]] unsigned cachehound::latency_classifier::classify(std::uint64_t cycles) const noexcept
+{
+    return std::ranges::upper_bound(thresholds_, cycles) - thresholds_.begin();
+}
+
+bool cachehound::latency_classifier::observe(std::uint64_t cycles)
+{
+    if (window_size_ == 0)
+        return false;
+
+    window_.push_back(cycles);
+    if (window_.size() < window_size_)
+        return false;
+
+    auto modes = modes_;
+    auto ordered = fit(modes, window_, min_cluster_size);
+    window_.clear();
+    if (!ordered)
+        return false;
+
+    bool drifted = false;
+    for (std::size_t i = 0; i < modes_.size(); i++) {
+        auto gap = std::numeric_limits<double>::infinity();
+        if (i > 0)
+            gap = std::min(gap, modes_[i] - modes_[i - 1]);
+        if (i + 1 < modes_.size())
+            gap = std::min(gap, modes_[i + 1] - modes_[i]);
+        drifted |= std::abs(modes[i] - modes_[i]) > drift_tolerance_ * gap;
+    }
+    if (!drifted)
+        return false;
+
+    modes_ = std::move(modes);
+    derive_thresholds();
+    recalibrations_++;
+    return true;
+}
+
+[[nodiscard]] unsigned cachehound::latency_classifier::levels() const noexcept
+{
+    return thresholds_.size();
+}
+
+[[nodiscard]] std::span<const double> cachehound::latency_classifier::modes() const noexcept
+{
+    return modes_;
+}
+
+[[nodiscard]] std::span<const std::uint64_t> cachehound::latency_classifier::thresholds() const noexcept
+{
+    return thresholds_;
+}
+
+[[nodiscard]] std::size_t cachehound::latency_classifier::recalibrations() const noexcept
+{
+    return recalibrations_;
+}
+
+#endif /* CACHEHOUND_UTIL_IMPL_LATENCY_CLASSIFIER_IPP */
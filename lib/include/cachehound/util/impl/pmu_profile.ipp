@@ -0,0 +1,34 @@
+#ifndef CACHEHOUND_UTIL_IMPL_PMU_PROFILE_IPP
+#define CACHEHOUND_UTIL_IMPL_PMU_PROFILE_IPP
+
+#include "../pmu_profile.hpp"
+
+cachehound::pmu_profile cachehound::pmu_profile::hit_counting(std::vector<std::uint64_t> events)
+{
+    pmu_profile profile{std::move(events), {}};
+    unsigned levels = profile.events.size();
+    for (unsigned i = 0; i < levels; i++) {
+        profile.rules.push_back({i, condition::nonzero, i});
+    }
+    profile.rules.push_back({0, condition::always, levels});
+    return profile;
+}
+
+cachehound::pmu_profile cachehound::pmu_profile::miss_counting(std::vector<std::uint64_t> events)
+{
+    pmu_profile profile{std::move(events), {}};
+    unsigned levels = profile.events.size();
+    // A miss in a lower level implies misses in all levels above it
+    for (unsigned i = levels; i-- > 0;) {
+        profile.rules.push_back({i, condition::nonzero, i + 1});
+    }
+    profile.rules.push_back({0, condition::always, 0});
+    return profile;
+}
+
+[[nodiscard]] unsigned cachehound::pmu_profile::classify(std::span<const std::uint64_t> deltas) const noexcept
+{
+    return detail::classify_deltas(rules, deltas);
+}
+
+#endif /* CACHEHOUND_UTIL_IMPL_PMU_PROFILE_IPP */
@@ -38,6 +38,11 @@ std::uintptr_t cachehound::set_cycling_address_distribution::operator()(URBG& ur
     return address;
 }
 
+void cachehound::set_cycling_address_distribution::update(const memory auto& memory)
+{
+    base_distribution_.update(memory);
+}
+
 void cachehound::set_cycling_address_distribution::reset()
 {
     base_distribution_.reset();
@@ -4,28 +4,28 @@
 #include "../uniform_address_distribution.hpp"
 #include <cstdint>
 
-cachehound::uniform_address_distribution::distributions cachehound::uniform_address_distribution::derive_distributions(const memory auto& memory, std::uint8_t alignment)
+void cachehound::uniform_address_distribution::extend_distributions(const memory auto& memory, auto&& region_filter)
 {
-    std::vector<std::size_t> sizes;
-    std::vector<std::uniform_int_distribution<std::uintptr_t>> addresses;
-    for (auto& region : memory.regions()) {
-        sizes.emplace_back(region.size());
-        addresses.emplace_back(region.base() >> alignment, ((region.base() + region.size()) >> alignment) - 1);
+    auto&& regions = memory.regions();
+    if (distributions_.regions_seen == std::ranges::size(regions)) return;
+
+    for (auto& region : regions | std::views::drop(distributions_.regions_seen)) {
+        distributions_.regions_seen++;
+        if (!region_filter(region)) continue;
+        distributions_.sizes.emplace_back(region.size());
+        distributions_.addresses.emplace_back(region.base() >> alignment_, ((region.base() + region.size()) >> alignment_) - 1);
     }
 
-    std::discrete_distribution<std::uintptr_t> regions(sizes.begin(), sizes.end());
-    return cachehound::uniform_address_distribution::distributions {
-        .regions = std::move(regions),
-        .addresses = std::move(addresses)
-    };
+    distributions_.regions = std::discrete_distribution<std::uintptr_t>(distributions_.sizes.begin(), distributions_.sizes.end());
 }
 
 cachehound::uniform_address_distribution::uniform_address_distribution(const memory auto& memory, std::uint8_t alignment, std::uintptr_t offset)
     : alignment_(alignment)
-    , distributions_(derive_distributions(memory, alignment))
     , offset_(offset)
 {
     assert(offset < (1 << alignment_));
+    extend_distributions(memory, [](auto&) { return true; });
+    assert(!distributions_.addresses.empty());
 }
 
 cachehound::uniform_address_distribution::uniform_address_distribution(const memory auto& memory)
@@ -33,6 +33,36 @@ cachehound::uniform_address_distribution::uniform_address_distribution(const mem
 {
 }
 
+template<cachehound::memory Memory, typename RegionFilter>
+requires std::predicate<RegionFilter&, const std::ranges::range_value_t<decltype(std::declval<const Memory&>().regions())>&>
+cachehound::uniform_address_distribution::uniform_address_distribution(const Memory& memory, std::uint8_t alignment, std::uintptr_t offset, RegionFilter&& region_filter)
+    : alignment_(alignment)
+    , offset_(offset)
+{
+    assert(offset < (1 << alignment_));
+    extend_distributions(memory, region_filter);
+    assert(!distributions_.addresses.empty());
+}
+
+template<cachehound::memory Memory, typename RegionFilter>
+requires std::predicate<RegionFilter&, const std::ranges::range_value_t<decltype(std::declval<const Memory&>().regions())>&>
+cachehound::uniform_address_distribution::uniform_address_distribution(const Memory& memory, RegionFilter&& region_filter)
+    : uniform_address_distribution(memory, memory.offset_bits(), 0, region_filter)
+{
+}
+
+void cachehound::uniform_address_distribution::update(const memory auto& memory)
+{
+    extend_distributions(memory, [](auto&) { return true; });
+}
+
+template<cachehound::memory Memory, typename RegionFilter>
+requires std::predicate<RegionFilter&, const std::ranges::range_value_t<decltype(std::declval<const Memory&>().regions())>&>
+void cachehound::uniform_address_distribution::update(const Memory& memory, RegionFilter&& region_filter)
+{
+    extend_distributions(memory, region_filter);
+}
+
 std::uintptr_t cachehound::uniform_address_distribution::operator()(std::uniform_random_bit_generator auto& g) noexcept(noexcept(distributions_.regions(g)) && noexcept(distributions_.addresses.front()(g)))
 {
     auto region = distributions_.regions(g);
@@ -0,0 +1,74 @@
+#ifndef CACHEHOUND_UTIL_LATENCY_CLASSIFIER_HPP
+#define CACHEHOUND_UTIL_LATENCY_CLASSIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cachehound {
+
+/**
+ * @brief Maps access latencies to the level that served the access, by
+ * thresholds halfway between the modes of the latencies of each level.
+ * The modes are fitted by one-dimensional k-medians, which outliers (e.g.,
+ * interrupts) hardly affect, seeded with the medians of latencies measured
+ * for lines resident at known levels (see calibrate_latency()). Observed
+ * latencies are collected in a window and refitted once it is full; if a
+ * mode moved by more than the tolerated fraction of the gap to its
+ * neighbours, the thresholds follow it. Modes stay in the order of the
+ * levels, refits that would reorder them are discarded.
+ */
+class latency_classifier {
+    // Latencies a cluster needs in a window to move its mode
+    static constexpr std::size_t min_cluster_size = 16;
+
+    std::vector<double> modes_;
+    std::vector<std::uint64_t> thresholds_;
+    std::vector<std::uint64_t> window_;
+    std::size_t window_size_;
+    double drift_tolerance_;
+    std::size_t recalibrations_ = 0;
+
+    // Lloyd's iterations with medians instead of means, clusters with fewer
+    // than min_size latencies keep their mode. Returns false as soon as the
+    // modes no longer ascend with the level.
+    static bool fit(std::vector<double>& modes, std::span<const std::uint64_t> latencies, std::size_t min_size);
+    void derive_thresholds();
+
+public:
+    /**
+     * @param latencies Latencies of lines resident at each level, the last
+     * one being memory. Empty levels are not supported. Throws
+     * std::invalid_argument if their medians do not ascend with the level.
+     * @param window_size Latencies collected before each refit (0 disables
+     * tracking)
+     * @param drift_tolerance Fraction of the gap to the closest neighbouring
+     * mode that a mode may move before the thresholds are recalibrated
+     */
+    latency_classifier(
+        std::span<const std::vector<std::uint64_t>> latencies,
+        std::size_t window_size = 4096,
+        double drift_tolerance = 0.25);
+
+    // Level of an access with the given latency (levels() for memory)
+    [[nodiscard]] unsigned classify(std::uint64_t cycles) const noexcept;
+    // Records the latency for tracking drift without classifying it, returns
+    // whether the thresholds were recalibrated by this latency
+    bool observe(std::uint64_t cycles);
+
+    [[nodiscard]] unsigned levels() const noexcept;
+    // Fitted mode of each level in cycles
+    [[nodiscard]] std::span<const double> modes() const noexcept;
+    // Latencies below thresholds()[i] are classified as level i at most
+    [[nodiscard]] std::span<const std::uint64_t> thresholds() const noexcept;
+    [[nodiscard]] std::size_t recalibrations() const noexcept;
+};
+
+}
+
+#if defined(CACHEHOUND_HEADER_ONLY)
+#include "./impl/latency_classifier.ipp"
+#endif
+
+#endif /* CACHEHOUND_UTIL_LATENCY_CLASSIFIER_HPP */
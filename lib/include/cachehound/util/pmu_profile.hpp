@@ -0,0 +1,81 @@
+#ifndef CACHEHOUND_UTIL_PMU_PROFILE_HPP
+#define CACHEHOUND_UTIL_PMU_PROFILE_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ch_channel.h"
+
+namespace cachehound {
+
+/**
+ * @brief The PMU events to program together with the rules that map their
+ * deltas to the level that served an access. Agents evaluate the rules
+ * themselves (see ch_pmu_rule), i.e., they report a single byte per
+ * classified access instead of all counter deltas.
+ */
+struct pmu_profile {
+    enum class condition : std::uint8_t {
+        nonzero = CH_PMU_NONZERO,
+        zero = CH_PMU_ZERO,
+        always = CH_PMU_ALWAYS
+    };
+
+    struct rule {
+        unsigned counter;
+        condition when;
+        unsigned level;
+    };
+
+    std::vector<std::uint64_t> events;
+    // Evaluated in order, the first matching rule yields the level
+    std::vector<rule> rules;
+
+    /**
+     * @brief Events that count hits in successive levels, starting at the
+     * first level. Accesses without hits were served by memory.
+     */
+    static pmu_profile hit_counting(std::vector<std::uint64_t> events);
+
+    /**
+     * @brief Events that count misses in successive levels, starting at the
+     * first level. Accesses without misses were served by the first level.
+     */
+    static pmu_profile miss_counting(std::vector<std::uint64_t> events);
+
+    // Level of an access with the given counter deltas, CH_LEVEL_UNCLASSIFIED
+    // if no rule matches
+    [[nodiscard]] unsigned classify(std::span<const std::uint64_t> deltas) const noexcept;
+};
+
+// Appends the level of each result to levels, as the agent backends do for
+// the results the agent did not classify itself
+using pmu_decoder = void(std::span<const ch_result> results, std::vector<unsigned>& levels);
+
+namespace detail {
+
+// Evaluates the rules as ch_agent_classify() does, so that they unroll if
+// known at compile time (see static_pmu_profile_base::decode())
+constexpr unsigned classify_deltas(std::span<const pmu_profile::rule> rules, std::span<const std::uint64_t> deltas) noexcept
+{
+    for (auto& rule : rules) {
+        auto delta = rule.counter < deltas.size() ? deltas[rule.counter] : 0;
+        if (rule.when == pmu_profile::condition::always
+            || (rule.when == pmu_profile::condition::nonzero && delta)
+            || (rule.when == pmu_profile::condition::zero && !delta)) {
+            return rule.level;
+        }
+    }
+    return CH_LEVEL_UNCLASSIFIED;
+}
+
+}
+
+}
+
+#if defined(CACHEHOUND_HEADER_ONLY)
+#include "./impl/pmu_profile.ipp"
+#endif
+
+#endif /* CACHEHOUND_UTIL_PMU_PROFILE_HPP */
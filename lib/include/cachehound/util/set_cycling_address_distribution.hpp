@@ -31,6 +31,9 @@ public:
     template<std::uniform_random_bit_generator URBG>
     std::uintptr_t operator()(URBG& urbg);
 
+    // Extends the distribution by the regions a growable memory appended
+    void update(const memory auto& memory);
+
     void reset();
 };
 
@@ -2,8 +2,10 @@
 #define CACHEHOUND_UTIL_UNIFORM_ADDRESS_DISTRIBUTION_HPP
 
 #include <cassert>
+#include <concepts>
 #include <cstdint>
 #include <random>
+#include <ranges>
 
 #include "../concepts/memory.hpp"
 #include "../concepts/address_distribution.hpp"
@@ -15,15 +17,18 @@ namespace cachehound {
  */
 class uniform_address_distribution {
     struct distributions {
+        std::vector<std::size_t> sizes;
         std::discrete_distribution<std::uintptr_t> regions;
         std::vector<std::uniform_int_distribution<std::uintptr_t>> addresses;
+        // Regions of the memory considered thus far, accepted or not
+        std::size_t regions_seen = 0;
     };
 
     const std::uint8_t alignment_;
     const std::uintptr_t offset_;
     distributions distributions_;
 
-    static distributions derive_distributions(const memory auto& memory, std::uint8_t alignment);
+    void extend_distributions(const memory auto& memory, auto&& region_filter);
 
 public:
     using result_type = std::uintptr_t;
@@ -40,6 +45,32 @@ public:
 
     uniform_address_distribution(const memory auto& memory);
 
+    /**
+     * @brief Construct a new uniform address distribution restricted to some
+     * regions of the memory, e.g. to the regions local to the NUMA node of the
+     * agent: `[&](auto& region) { return region.node() == memory.node(); }`
+     *
+     * @param region_filter Predicate on the regions of the memory, must accept at least one
+     */
+    template<memory Memory, typename RegionFilter>
+    requires std::predicate<RegionFilter&, const std::ranges::range_value_t<decltype(std::declval<const Memory&>().regions())>&>
+    uniform_address_distribution(const Memory& memory, std::uint8_t alignment, std::uintptr_t offset, RegionFilter&& region_filter);
+
+    template<memory Memory, typename RegionFilter>
+    requires std::predicate<RegionFilter&, const std::ranges::range_value_t<decltype(std::declval<const Memory&>().regions())>&>
+    uniform_address_distribution(const Memory& memory, RegionFilter&& region_filter);
+
+    /**
+     * @brief Extends the distribution by the regions a growable memory
+     * appended since construction or the preceding update. Distributions
+     * restricted by a region filter must be updated with the same filter.
+     */
+    void update(const memory auto& memory);
+
+    template<memory Memory, typename RegionFilter>
+    requires std::predicate<RegionFilter&, const std::ranges::range_value_t<decltype(std::declval<const Memory&>().regions())>&>
+    void update(const Memory& memory, RegionFilter&& region_filter);
+
     void reset();
 
     std::uintptr_t operator()(std::uniform_random_bit_generator auto& g) noexcept(noexcept(distributions_.regions(g)) && noexcept(distributions_.addresses.front()(g)));
@@ -1,19 +1,43 @@
 #ifndef CACHEHOUND_UTIL_WARMUP_HPP
 #define CACHEHOUND_UTIL_WARMUP_HPP
 
+#include <algorithm>
+#include <cstdint>
 #include <random>
+#include <type_traits>
+#include <vector>
 
+#include "../concepts/batched_memory.hpp"
 #include "../concepts/memory.hpp"
+#include "../concepts/prng_memory.hpp"
 #include "./uniform_address_distribution.hpp"
 
 namespace cachehound {
 
 void warmup(memory auto& memory, std::size_t accesses, std::uniform_random_bit_generator auto& gen) {
-    uniform_address_distribution distribution(memory, 0);
+    if constexpr(prng_memory<decltype(memory)>) {
+        // Generated by the memory itself instead of one submission per access
+        memory.seed(gen());
+        memory.random_access_blacklist({});
+        memory.random_accesses(accesses);
+    } else if constexpr(batched_memory<std::remove_cvref_t<decltype(memory)>>) {
+        static constexpr std::size_t batch_size = 256;
 
-    while(accesses-- > 0) {
-        auto address = distribution(gen);
-        memory.access(address);
+        uniform_address_distribution distribution(memory, 0);
+        std::vector<std::uintptr_t> batch;
+        while(accesses > 0) {
+            batch.resize(std::min(accesses, batch_size));
+            std::ranges::generate(batch, [&]() { return distribution(gen); });
+            memory.access_many(batch);
+            accesses -= batch.size();
+        }
+    } else {
+        uniform_address_distribution distribution(memory, 0);
+
+        while(accesses-- > 0) {
+            auto address = distribution(gen);
+            memory.access(address);
+        }
     }
 }
 
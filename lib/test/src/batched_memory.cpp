@@ -0,0 +1,136 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <cachehound/cachehound.hpp>
+#include <cachehound/sim/sim.hpp>
+
+using namespace cachehound;
+
+namespace {
+
+sim::simulated_memory<> make_memory() {
+    return sim::simulated_memory<> {
+        0x0, std::size_t{1} << 22, 6,
+        sim::set_associative_cache { sim::basic_set_associative_policy { 6, modular_placement_policy{6, 64}, lru_replacement_policy{4} } },
+        sim::set_associative_cache { sim::basic_set_associative_policy { 7, modular_placement_policy{6, 128}, lru_replacement_policy{8} } }
+    };
+}
+
+// Hides the batched accesses of the memory, so that algorithms fall back to
+// single accesses
+template<instrumented_memory Memory>
+struct sequential_memory {
+    using region_type = typename Memory::region_type;
+
+    Memory& memory;
+
+    void access(std::uintptr_t address) { memory.access(address); }
+    unsigned instrumented_access(std::uintptr_t address) { return memory.instrumented_access(address); }
+    unsigned levels() const noexcept { return memory.levels(); }
+    std::uint8_t offset_bits() const noexcept { return memory.offset_bits(); }
+    std::uint8_t index_bits(unsigned level) const noexcept { return memory.index_bits(level); }
+    std::size_t ways(unsigned level) const noexcept { return memory.ways(level); }
+    decltype(auto) regions() const noexcept { return memory.regions(); }
+};
+
+// Lines of the first region, drawn from few enough sets to produce hits,
+// misses and evictions at both levels
+std::vector<std::uintptr_t> random_lines(std::size_t count, std::mt19937_64& gen) {
+    std::vector<std::uintptr_t> lines(count);
+    for(auto& line : lines) {
+        line = (gen() % 1024) << 6;
+    }
+    return lines;
+}
+
+}
+
+TEST_CASE("Distinct set runs") {
+    modular_placement_policy placement{6, 64};
+    auto line = [](std::size_t set, std::size_t tag) -> std::uintptr_t { return (tag * 64 + set) << 6; };
+
+    SECTION("split at repeated sets") {
+        std::vector<std::uintptr_t> addresses{line(0, 0), line(1, 0), line(2, 1), line(0, 1), line(3, 0), line(3, 0), line(4, 2)};
+        std::vector<std::size_t> offsets, sizes;
+        detail::for_each_distinct_set_run(addresses, placement, 64, [&](std::span<const std::uintptr_t> run, std::size_t offset) {
+            CHECK(run.data() == addresses.data() + offset);
+            offsets.push_back(offset);
+            sizes.push_back(run.size());
+        });
+        CHECK(offsets == std::vector<std::size_t>{0, 3, 5});
+        CHECK(sizes == std::vector<std::size_t>{3, 2, 2});
+    }
+
+    SECTION("empty") {
+        std::size_t calls = 0;
+        detail::for_each_distinct_set_run(std::span<const std::uintptr_t>{}, placement, 64, [&](auto, std::size_t) { calls++; });
+        CHECK(calls == 0);
+    }
+
+    SECTION("random addresses") {
+        std::mt19937_64 gen{5};
+        for(std::size_t round = 0; round < 100; round++) {
+            auto addresses = random_lines(1 + gen() % 200, gen);
+            std::size_t next = 0;
+            detail::for_each_distinct_set_run(addresses, placement, 64, [&](std::span<const std::uintptr_t> run, std::size_t offset) {
+                // Runs are non-empty, consecutive and cover all addresses
+                REQUIRE(!run.empty());
+                CHECK(offset == next);
+                next = offset + run.size();
+
+                std::vector<bool> used(64);
+                for(auto address : run) {
+                    CHECK(!used[placement(address)]);
+                    used[placement(address)] = true;
+                }
+                // Maximal, i.e., the next address repeats a set of the run
+                if(next < addresses.size()) {
+                    CHECK(used[placement(addresses[next])]);
+                }
+            });
+            CHECK(next == addresses.size());
+        }
+    }
+}
+
+TEST_CASE("Batched and sequential accesses") {
+    auto batched = make_memory(), sequential = make_memory();
+    sequential_memory<decltype(sequential)> fallback{sequential};
+    static_assert(batched_memory<decltype(batched)>);
+    static_assert(!batched_memory<decltype(fallback)>);
+    std::mt19937_64 gen{3};
+
+    SECTION("accesses") {
+        for(std::size_t round = 0; round < 200; round++) {
+            auto addresses = random_lines(1 + gen() % 100, gen);
+            if(round % 3 == 0) {
+                batched.access_many(addresses);
+                for(auto address : addresses) {
+                    sequential.access(address);
+                }
+                continue;
+            }
+
+            std::vector<unsigned> levels(addresses.size());
+            batched.instrumented_access_many(addresses, levels);
+            for(std::size_t i = 0; i < addresses.size(); i++) {
+                CHECK(levels[i] == sequential.instrumented_access(addresses[i]));
+            }
+        }
+    }
+
+    SECTION("measured sequences") {
+        auto lines = random_lines(12, gen);
+        for(std::size_t round = 0; round < 20; round++) {
+            std::vector<std::size_t> sequence(200);
+            for(auto& index : sequence) {
+                index = gen() % lines.size();
+            }
+            CHECK(unsafe_measure_sequence(batched, sequence, lines) == unsafe_measure_sequence(fallback, sequence, lines));
+            CHECK(safe_measure_sequence(batched, sequence, lines) == safe_measure_sequence(fallback, sequence, lines));
+        }
+    }
+}
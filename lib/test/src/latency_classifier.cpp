@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <cachehound/cachehound.hpp>
+
+using namespace cachehound;
+
+namespace {
+
+// Latencies around the given mode of each level, with occasional outliers as
+// caused by interrupts
+std::vector<std::vector<std::uint64_t>> make_latencies(std::span<const std::uint64_t> modes, std::size_t count, std::mt19937_64& gen) {
+    std::vector<std::vector<std::uint64_t>> latencies(modes.size());
+    for(std::size_t level = 0; level < modes.size(); level++) {
+        for(std::size_t i = 0; i < count; i++) {
+            latencies[level].push_back(modes[level] + gen() % 3 + (i % 97 == 0 ? 5000 : 0));
+        }
+    }
+    return latencies;
+}
+
+}
+
+TEST_CASE("Latency classifier") {
+    std::mt19937_64 gen{7};
+    constexpr std::array<std::uint64_t, 4> modes{4, 14, 40, 200};
+    auto latencies = make_latencies(modes, 300, gen);
+
+    SECTION("fit") {
+        latency_classifier classifier{latencies, 512};
+        REQUIRE(classifier.levels() == 3);
+        REQUIRE(classifier.modes().size() == modes.size());
+        for(std::size_t level = 0; level < modes.size(); level++) {
+            // Outliers do not pull the modes away from the bulk of a level
+            CHECK(classifier.modes()[level] >= modes[level]);
+            CHECK(classifier.modes()[level] <= modes[level] + 2);
+        }
+        CHECK(std::ranges::is_sorted(classifier.thresholds()));
+        for(std::size_t level = 0; level < modes.size(); level++) {
+            CHECK(classifier.classify(modes[level] + 1) == level);
+        }
+        CHECK(classifier.classify(0) == 0);
+        CHECK(classifier.classify(100000) == 3);
+    }
+
+    SECTION("levels out of order") {
+        // Levels are never reordered to fit the latencies
+        std::swap(latencies[1], latencies[2]);
+        CHECK_THROWS_AS(latency_classifier{latencies}, std::invalid_argument);
+    }
+
+    SECTION("drift") {
+        latency_classifier classifier{latencies, 512, 0.25};
+
+        // Jitter within the tolerance keeps the thresholds
+        auto thresholds = std::vector(classifier.thresholds().begin(), classifier.thresholds().end());
+        bool recalibrated = false;
+        for(std::size_t i = 0; i < 2048; i++) {
+            recalibrated |= classifier.observe(modes[i % modes.size()] + 1 + gen() % 3);
+        }
+        CHECK(!recalibrated);
+        CHECK(classifier.recalibrations() == 0);
+        CHECK(std::ranges::equal(classifier.thresholds(), thresholds));
+
+        // The deeper levels slow down, the thresholds follow once a window
+        // is full
+        constexpr std::array<std::uint64_t, 4> drifted{4, 20, 60, 260};
+        for(std::size_t i = 0; i < 4096; i++) {
+            recalibrated |= classifier.observe(drifted[i % drifted.size()] + gen() % 3);
+        }
+        CHECK(recalibrated);
+        CHECK(classifier.recalibrations() > 0);
+        CHECK(std::ranges::is_sorted(classifier.modes()));
+        for(std::size_t level = 0; level < drifted.size(); level++) {
+            CHECK(classifier.classify(drifted[level] + 1) == level);
+        }
+    }
+
+    SECTION("tracking disabled") {
+        latency_classifier classifier{latencies, 0};
+        bool recalibrated = false;
+        for(std::size_t i = 0; i < 4096; i++) {
+            recalibrated |= classifier.observe(1000);
+        }
+        CHECK(!recalibrated);
+        CHECK(classifier.recalibrations() == 0);
+    }
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <fmt/format.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <cachehound/cachehound.hpp>
+
+using namespace cachehound;
+
+namespace {
+
+using deltas_type = std::array<std::uint64_t, 3>;
+
+// Handlers of the reverse command before the rules were evaluated by the
+// agent, taking the counter deltas
+unsigned intel_handler(const deltas_type& deltas) {
+    auto [l1_hits, l2_hits, l3_hits] = deltas;
+    if(l1_hits) return 0;
+    if(l2_hits) return 1;
+    if(l3_hits) return 2;
+    return 3;
+}
+
+unsigned amd_zen2_handler(const deltas_type& deltas) {
+    auto [l1_misses, l2_hits, unused] = deltas;
+    if(l1_misses == 0) return 0;
+    if(l2_hits) return 1;
+    return 2;
+}
+
+unsigned rpi5_handler(const deltas_type& deltas) {
+    auto [l1_misses, l2_misses, l3_misses] = deltas;
+    if(l3_misses) return 3;
+    if(l2_misses) return 2;
+    if(l1_misses) return 1;
+    return 0;
+}
+
+unsigned a64fx_handler(const deltas_type& deltas) {
+    auto [l1_misses, l2_misses, unused] = deltas;
+    if(l2_misses) return 2;
+    if(l1_misses) return 1;
+    return 0;
+}
+
+// Deltas of 0, 1 and a count distorted by interrupts for every counter
+std::vector<deltas_type> all_deltas() {
+    constexpr std::array<std::uint64_t, 3> values{0, 1, 37};
+    std::vector<deltas_type> deltas;
+    for(auto first : values) {
+        for(auto second : values) {
+            for(auto third : values) {
+                deltas.push_back({first, second, third});
+            }
+        }
+    }
+    return deltas;
+}
+
+void check_profile(const pmu_profile& profile, const std::function<unsigned(const deltas_type&)>& expected) {
+    for(auto& deltas : all_deltas()) {
+        INFO("Deltas: " << fmt::format("{}", fmt::join(deltas, ", ")));
+        CHECK(profile.classify(deltas) == expected(deltas));
+    }
+}
+
+// Decodes results with all_deltas() as the backends do
+template<static_pmu_profile P>
+void check_decode(const std::function<unsigned(const deltas_type&)>& expected) {
+    std::vector<ch_result> results;
+    for(auto& deltas : all_deltas()) {
+        ch_result result{};
+        std::copy(deltas.begin(), deltas.end(), result.deltas);
+        results.push_back(result);
+    }
+
+    std::vector<unsigned> levels{42};
+    P::decode(results, levels);
+    REQUIRE(levels.size() == results.size() + 1);
+    // Appended to the levels decoded before
+    CHECK(levels[0] == 42);
+    for(std::size_t i = 0; i < results.size(); i++) {
+        CHECK(levels[i + 1] == expected(all_deltas()[i]));
+    }
+}
+
+}
+
+TEST_CASE("PMU profile rules") {
+    SECTION("hit counting") {
+        auto profile = pmu_profile::hit_counting({0x1, 0x2, 0x3});
+        CHECK(profile.events.size() == 3);
+        check_profile(profile, intel_handler);
+    }
+
+    SECTION("miss counting") {
+        check_profile(pmu_profile::miss_counting({0x42, 0x52, 0x2A}), rpi5_handler);
+        check_profile(pmu_profile::miss_counting({0x0003, 0x0017}), a64fx_handler);
+    }
+
+    SECTION("explicit rules") {
+        pmu_profile profile{{0x1, 0x2}, {
+            {0, pmu_profile::condition::zero, 0},
+            {1, pmu_profile::condition::nonzero, 1},
+            {0, pmu_profile::condition::always, 2}
+        }};
+        check_profile(profile, amd_zen2_handler);
+    }
+
+    SECTION("no matching rule") {
+        pmu_profile profile{{0x1}, {{0, pmu_profile::condition::nonzero, 0}}};
+        CHECK(profile.classify(deltas_type{0, 0, 0}) == CH_LEVEL_UNCLASSIFIED);
+        // Counters beyond the deltas read as zero
+        CHECK(profile.classify(std::array<std::uint64_t, 0>{}) == CH_LEVEL_UNCLASSIFIED);
+    }
+
+    SECTION("named profiles") {
+        const std::vector<std::pair<std::string, std::function<unsigned(const deltas_type&)>>> handlers{
+            {"intel", intel_handler},
+            {"amd-zen2", amd_zen2_handler},
+            {"rpi5", rpi5_handler},
+            {"a64fx", a64fx_handler}
+        };
+        CHECK(get_pmu_profiles().size() == handlers.size());
+        for(auto& [name, handler] : handlers) {
+            INFO("Profile: " << name);
+            auto profile = make_pmu_profile(name);
+            REQUIRE(profile);
+            check_profile(*profile, handler);
+        }
+        CHECK(!make_pmu_profile("unknown"));
+
+        std::size_t decoded = 0;
+        for_each_pmu_profile([&]<static_pmu_profile P>() {
+            for(auto& [name, handler] : handlers) {
+                if(P::name == name) {
+                    INFO("Profile: " << name);
+                    check_decode<P>(handler);
+                    decoded++;
+                }
+            }
+        });
+        CHECK(decoded == handlers.size());
+    }
+
+    SECTION("no profile") {
+        check_decode<no_pmu_profile>([](const deltas_type&) { return unsigned{CH_LEVEL_UNCLASSIFIED}; });
+        CHECK(no_pmu_profile::profile().events.empty());
+    }
+}
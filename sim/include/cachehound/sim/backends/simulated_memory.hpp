@@ -3,6 +3,7 @@
 
 #include <cachehound/cachehound.hpp>
 #include <bit>
+#include <span>
 #include <type_traits>
 
 #include "../concepts/cache.hpp"
@@ -146,11 +147,25 @@ public:
         return do_access(address);
     }
 
+    void access_many(std::span<const std::uintptr_t> addresses) noexcept {
+        for(auto address : addresses) {
+            do_access(address);
+        }
+    }
+
+    void instrumented_access_many(std::span<const std::uintptr_t> addresses, std::span<unsigned> levels) noexcept {
+        assert(addresses.size() == levels.size());
+        for(std::size_t i = 0; i < addresses.size(); i++) {
+            levels[i] = do_access(addresses[i]);
+        }
+    }
+
     const std::vector<region_type>& regions() const noexcept {
         return regions_;
     }
 };
 static_assert(instrumented_memory<simulated_memory<>>);
+static_assert(batched_memory<simulated_memory<>>);
 
 }
 